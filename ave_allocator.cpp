@@ -0,0 +1,287 @@
+#include "ave_allocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ave {
+
+    struct AveMemoryBlock {
+        struct Range {
+            VkDeviceSize offset;
+            VkDeviceSize size;
+        };
+
+        VkDeviceMemory memory;
+        VkDeviceSize size;
+        char* mapped; // whole block, nullptr unless host visible
+        uint32_t pool;
+        uint32_t allocationCount = 0;
+        std::vector<Range> freeRanges; // sorted by offset, never adjacent
+    };
+
+    namespace {
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // Best fit over the block's free ranges, returns false when nothing fits
+        bool allocateFromBlock(AveMemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+            size_t best = block.freeRanges.size();
+            VkDeviceSize bestWaste = ~VkDeviceSize{0};
+            for (size_t i = 0; i < block.freeRanges.size(); i++) {
+                const AveMemoryBlock::Range& range = block.freeRanges[i];
+                VkDeviceSize aligned = alignUp(range.offset, alignment);
+                if (aligned + size > range.offset + range.size) {
+                    continue;
+                }
+                VkDeviceSize waste = range.size - size;
+                if (waste < bestWaste) {
+                    bestWaste = waste;
+                    best = i;
+                }
+            }
+            if (best == block.freeRanges.size()) {
+                return false;
+            }
+
+            // Alignment padding in front stays free, so nothing leaks when this range is returned
+            AveMemoryBlock::Range range = block.freeRanges[best];
+            offset = alignUp(range.offset, alignment);
+            AveMemoryBlock::Range front{range.offset, offset - range.offset};
+            AveMemoryBlock::Range back{offset + size, range.offset + range.size - (offset + size)};
+
+            block.freeRanges.erase(block.freeRanges.begin() + best);
+            if (back.size > 0) block.freeRanges.insert(block.freeRanges.begin() + best, back);
+            if (front.size > 0) block.freeRanges.insert(block.freeRanges.begin() + best, front);
+            block.allocationCount++;
+            return true;
+        }
+
+        void freeToBlock(AveMemoryBlock& block, VkDeviceSize offset, VkDeviceSize size) {
+            auto next = std::lower_bound(block.freeRanges.begin(), block.freeRanges.end(), offset,
+                [](const AveMemoryBlock::Range& range, VkDeviceSize value) { return range.offset < value; });
+            next = block.freeRanges.insert(next, {offset, size});
+
+            // Merge with the following range, then with the preceding one
+            if (next + 1 != block.freeRanges.end() && next->offset + next->size == (next + 1)->offset) {
+                next->size += (next + 1)->size;
+                block.freeRanges.erase(next + 1);
+            }
+            if (next != block.freeRanges.begin() && (next - 1)->offset + (next - 1)->size == next->offset) {
+                (next - 1)->size += next->size;
+                block.freeRanges.erase(next);
+            }
+            block.allocationCount--;
+        }
+    }
+
+    AveAllocator::AveAllocator(VkPhysicalDevice physicalDevice, VkDevice device) : device_{device} {
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties_);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        nonCoherentAtomSize_ = std::max<VkDeviceSize>(1, properties.limits.nonCoherentAtomSize);
+
+        pools_.resize(memoryProperties_.memoryTypeCount * POOLS_PER_TYPE);
+        for (uint32_t type = 0; type < memoryProperties_.memoryTypeCount; type++) {
+            // Small heaps (BAR / resizable BAR windows are often 256MB) get proportionally smaller blocks
+            VkDeviceSize heapSize = memoryProperties_.memoryHeaps[memoryProperties_.memoryTypes[type].heapIndex].size;
+            VkDeviceSize largeBlockSize = std::min(LARGE_BLOCK_SIZE, std::max(SMALL_BLOCK_SIZE, heapSize / 8));
+            for (uint32_t pool = 0; pool < POOLS_PER_TYPE; pool++) {
+                pools_[type * POOLS_PER_TYPE + pool].blockSize = pool < 2 ? SMALL_BLOCK_SIZE : largeBlockSize;
+            }
+        }
+    }
+
+    AveAllocator::~AveAllocator() {
+        for (Pool& pool : pools_) {
+            for (auto& block : pool.blocks) {
+                vkFreeMemory(device_, block->memory, nullptr); // also unmaps
+            }
+        }
+    }
+
+    AveAllocation AveAllocator::allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties) {
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(device_, buffer, &requirements);
+
+        AveAllocation allocation = allocate(requirements, properties, ResourceKind::Linear);
+        if (vkBindBufferMemory(device_, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            free(allocation);
+            throw std::runtime_error("failed to bind buffer memory!");
+        }
+        return allocation;
+    }
+
+    AveAllocation AveAllocator::allocateForImage(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties) {
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(device_, image, &requirements);
+
+        ResourceKind kind = tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceKind::Optimal : ResourceKind::Linear;
+        AveAllocation allocation = allocate(requirements, properties, kind);
+        if (vkBindImageMemory(device_, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            free(allocation);
+            throw std::runtime_error("failed to bind image memory!");
+        }
+        return allocation;
+    }
+
+    AveAllocation AveAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind) {
+        try {
+            return tryAllocate(requirements, properties, kind);
+        } catch (const AveOutOfDeviceMemory& error) {
+            if (!outOfMemoryHandler_ || !outOfMemoryHandler_(error.size)) {
+                throw;
+            }
+        }
+        return tryAllocate(requirements, properties, kind);
+    }
+
+    AveAllocation AveAllocator::tryAllocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind) {
+        uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+
+        // Host writes to non coherent memory are flushed in whole atoms, keep neighbours out of ours
+        VkDeviceSize alignment = requirements.alignment;
+        VkDeviceSize size = requirements.size;
+        bool coherent = memoryProperties_.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        if (isHostVisible(memoryType) && !coherent) {
+            alignment = std::max(alignment, nonCoherentAtomSize_);
+            size = alignUp(size, nonCoherentAtomSize_);
+        }
+
+        uint32_t poolIndex = memoryType * POOLS_PER_TYPE
+            + (size > SMALL_ALLOCATION_LIMIT ? 2 : 0)
+            + (kind == ResourceKind::Optimal ? 1 : 0);
+
+        std::lock_guard<std::mutex> lock{mutex_};
+        Pool& pool = pools_[poolIndex];
+        if (size >= pool.blockSize / 2) {
+            return allocateDedicated(size, memoryType);
+        }
+
+        AveAllocation allocation{};
+        allocation.size = size;
+        for (auto& block : pool.blocks) {
+            if (allocateFromBlock(*block, size, alignment, allocation.offset)) {
+                allocation.block = block.get();
+                break;
+            }
+        }
+
+        if (allocation.block == nullptr) {
+            auto block = std::make_unique<AveMemoryBlock>();
+            void* mapped = nullptr;
+            block->memory = allocateMemory(pool.blockSize, memoryType, &mapped);
+            block->size = pool.blockSize;
+            block->mapped = static_cast<char*>(mapped);
+            block->pool = poolIndex;
+            block->freeRanges.push_back({0, pool.blockSize});
+            allocateFromBlock(*block, size, alignment, allocation.offset);
+            allocation.block = block.get();
+            pool.blocks.push_back(std::move(block));
+        }
+
+        allocation.memory = allocation.block->memory;
+        allocation.mapped = allocation.block->mapped ? allocation.block->mapped + allocation.offset : nullptr;
+        allocationCount_++;
+        return allocation;
+    }
+
+    AveAllocation AveAllocator::allocateDedicated(VkDeviceSize size, uint32_t memoryType) {
+        AveAllocation allocation{};
+        allocation.memory = allocateMemory(size, memoryType, &allocation.mapped);
+        allocation.size = size;
+        dedicatedCount_++;
+        dedicatedBytes_ += size;
+        allocationCount_++;
+        return allocation;
+    }
+
+    void AveAllocator::free(AveAllocation& allocation) {
+        if (allocation.memory == VK_NULL_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (allocation.block == nullptr) {
+            vkFreeMemory(device_, allocation.memory, nullptr);
+            dedicatedCount_--;
+            dedicatedBytes_ -= allocation.size;
+        } else {
+            AveMemoryBlock* block = allocation.block;
+            freeToBlock(*block, allocation.offset, allocation.size);
+
+            // An empty block goes back to the driver unless it is the last one its pool has
+            Pool& pool = pools_[block->pool];
+            if (block->allocationCount == 0 && pool.blocks.size() > 1) {
+                vkFreeMemory(device_, block->memory, nullptr);
+                pool.blocks.erase(std::find_if(pool.blocks.begin(), pool.blocks.end(),
+                    [block](const std::unique_ptr<AveMemoryBlock>& candidate) { return candidate.get() == block; }));
+            }
+        }
+        allocationCount_--;
+        allocation = AveAllocation{};
+    }
+
+    AllocatorStats AveAllocator::getStats() {
+        std::lock_guard<std::mutex> lock{mutex_};
+        AllocatorStats stats{};
+        stats.dedicatedCount = dedicatedCount_;
+        stats.allocationCount = allocationCount_;
+        stats.bytesUsed = dedicatedBytes_;
+        stats.bytesReserved = dedicatedBytes_;
+
+        VkDeviceSize totalFree = 0, largestFree = 0;
+        for (const Pool& pool : pools_) {
+            for (const auto& block : pool.blocks) {
+                VkDeviceSize blockFree = 0;
+                for (const AveMemoryBlock::Range& range : block->freeRanges) {
+                    blockFree += range.size;
+                    largestFree = std::max(largestFree, range.size);
+                }
+                stats.blockCount++;
+                stats.bytesReserved += block->size;
+                stats.bytesUsed += block->size - blockFree;
+                totalFree += blockFree;
+            }
+        }
+        stats.fragmentation = totalFree > 0 ? 1.0f - static_cast<float>(largestFree) / static_cast<float>(totalFree) : 0.0f;
+        return stats;
+    }
+
+    uint32_t AveAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+        for (uint32_t i = 0; i < memoryProperties_.memoryTypeCount; i++) {
+            if ((typeFilter & (1 << i)) && (memoryProperties_.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    VkDeviceMemory AveAllocator::allocateMemory(VkDeviceSize size, uint32_t memoryType, void** mapped) {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        VkDeviceMemory memory;
+        VkResult result = vkAllocateMemory(device_, &allocInfo, nullptr, &memory);
+        if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY) {
+            throw AveOutOfDeviceMemory{size};
+        }
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate device memory!");
+        }
+
+        *mapped = nullptr;
+        if (isHostVisible(memoryType) && vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+            vkFreeMemory(device_, memory, nullptr);
+            throw std::runtime_error("failed to map device memory!");
+        }
+        return memory;
+    }
+
+    bool AveAllocator::isHostVisible(uint32_t memoryType) const {
+        return memoryProperties_.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace ave {
+
+    struct AveMemoryBlock;
+
+    // A range of device memory handed out by AveAllocator. Host visible memory stays mapped for its whole
+    // life, `mapped` points at this allocation's first byte, so callers never vkMapMemory themselves.
+    struct AveAllocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;
+
+        AveMemoryBlock* block = nullptr; // owning block, nullptr for dedicated allocations
+    };
+
+    // Thrown when the driver is out of device memory even after the out of memory handler had its go,
+    // callers that can live without the resource (textures, evictable meshes) catch this one specifically
+    struct AveOutOfDeviceMemory : std::runtime_error {
+        explicit AveOutOfDeviceMemory(VkDeviceSize size)
+            : std::runtime_error{"failed to allocate device memory, out of device memory!"}, size{size} {}
+        VkDeviceSize size;
+    };
+
+    struct AllocatorStats {
+        uint32_t blockCount;        // shared vkAllocateMemory blocks
+        uint32_t dedicatedCount;    // resources with a vkAllocateMemory of their own
+        uint32_t allocationCount;   // live AveAllocations, dedicated ones included
+        VkDeviceSize bytesUsed;     // by live allocations
+        VkDeviceSize bytesReserved; // from the driver, blocks plus dedicated
+        float fragmentation;        // 1 - largest free range / total free bytes across blocks, 0 when compact
+    };
+
+    // Sub-allocates buffers and images out of a few large VkDeviceMemory blocks instead of one
+    // vkAllocateMemory per resource (drivers cap the count at maxMemoryAllocationCount, often 4096, and the
+    // call itself is slow).
+    //
+    // Every memory type has its own pools, split by size class (small resources get small blocks so one
+    // leftover uniform buffer does not pin 64MB) and by resource kind: linear resources (buffers) and
+    // optimal tiling images never share a block, which keeps bufferImageGranularity out of the picture
+    // entirely. Inside a block, free ranges are kept sorted by offset, allocation is best fit and frees
+    // merge with their neighbours. Resources at least half a large block in size get a dedicated allocation.
+    class AveAllocator {
+        public:
+            static constexpr VkDeviceSize LARGE_BLOCK_SIZE = 64 * 1024 * 1024;
+            static constexpr VkDeviceSize SMALL_BLOCK_SIZE = 4 * 1024 * 1024;
+            static constexpr VkDeviceSize SMALL_ALLOCATION_LIMIT = 256 * 1024; // at or below goes to small blocks
+
+            AveAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+            ~AveAllocator();
+
+            AveAllocator(const AveAllocator&) = delete;
+            AveAllocator& operator=(const AveAllocator&) = delete;
+
+            // Allocate and bind, throws when no memory type fits
+            AveAllocation allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties);
+            AveAllocation allocateForImage(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties);
+            void free(AveAllocation& allocation);
+
+            // Called without the allocator lock held when the driver reports out of device memory, with the
+            // size that failed. Returning true means memory was released and the allocation is retried once.
+            void setOutOfMemoryHandler(std::function<bool(VkDeviceSize)> handler) { outOfMemoryHandler_ = std::move(handler); }
+
+            AllocatorStats getStats();
+
+        private:
+            enum class ResourceKind { Linear, Optimal };
+            static constexpr uint32_t POOLS_PER_TYPE = 4; // {small, large} x {linear, optimal}
+
+            struct Pool {
+                VkDeviceSize blockSize = 0;
+                std::vector<std::unique_ptr<AveMemoryBlock>> blocks;
+            };
+
+            AveAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind);
+            AveAllocation tryAllocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind);
+            AveAllocation allocateDedicated(VkDeviceSize size, uint32_t memoryType);
+            uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+            VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryType, void** mapped);
+            bool isHostVisible(uint32_t memoryType) const;
+
+            VkDevice device_;
+            VkPhysicalDeviceMemoryProperties memoryProperties_;
+            VkDeviceSize nonCoherentAtomSize_;
+
+            std::mutex mutex_;
+            std::vector<Pool> pools_; // memoryType * POOLS_PER_TYPE + pool
+            uint32_t dedicatedCount_ = 0;
+            uint32_t allocationCount_ = 0;
+            VkDeviceSize dedicatedBytes_ = 0;
+            std::function<bool(VkDeviceSize)> outOfMemoryHandler_;
+    };
+}
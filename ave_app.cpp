@@ -1,10 +1,9 @@
 #include "ave_app.hpp"
+#include "ave_mapped_file.hpp"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb/stb_image.h>
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tinyobjloader/tiny_obj_loader.h>
+#include <chrono>
+#include <cmath>
+#include <iostream>
 
 namespace ave{
     AveApp::AveApp(){
@@ -12,18 +11,49 @@ namespace ave{
         createPipelineLayout();
         recreateSwapChain();
         createCommandBuffers();
-        createTextureImage();
-        createTextureImageView();
+        parallelRecorder = std::make_unique<AveParallelRecorder>(aveDevice.device(), aveDevice.getGraphicsQueueFamily(), recordingPool);
+
+        // Resource initialization of the loading phase is recorded and submitted once at the end
+        AveUploadBatch startupUploads{aveDevice};
+        // Decodes on the pool while the model loads, the placeholder is bound until the upload lands
+        textureLoader = std::make_unique<AveTextureLoader>(aveDevice, threadPool);
+        if (AveMappedFile::exists(COOKED_TEXTURE_PATH) && aveDevice.getEnabledFeatures().textureCompressionBC) {
+            texture = textureLoader->load(COOKED_TEXTURE_PATH);
+        } else {
+            texture = textureLoader->load(TEXTURE_PATH);
+        }
         createTextureSampler();
         loadModels();
+        createCullingScene();
+        createForest();
+        createWave();
         createDescriptorSets();
+        startupUploads.submit();
+
+        const UploadBatchStats& uploads = startupUploads.getStats();
+        GeometryPoolStats geometry = aveDevice.getGeometryPool().getStats();
+        std::cout << "geometry pool: " << geometry.meshCount << " meshes, " << geometry.vertexBytesUsed / 1024 << " / "
+                  << geometry.vertexCapacity / 1024 << " KiB vertices, " << geometry.indexBytesUsed / 1024 << " / "
+                  << geometry.indexCapacity / 1024 << " KiB indices" << std::endl;
+        std::cout << "startup uploads: " << uploads.operations << " operations in " << uploads.submits << " submits, "
+                  << uploads.milliseconds << " ms, ~" << uploads.savedMilliseconds << " ms of round trips saved" << std::endl;
+
+        AllocatorStats memory = aveDevice.getAllocator().getStats();
+        std::cout << "device memory: " << memory.allocationCount << " allocations in " << memory.blockCount << " blocks + "
+                  << memory.dedicatedCount << " dedicated, " << memory.bytesUsed / (1024 * 1024) << " / "
+                  << memory.bytesReserved / (1024 * 1024) << " MiB used, fragmentation " << memory.fragmentation << std::endl;
+
+        ResidencyStats residency = aveDevice.getResidency().getStats();
+        std::cout << "residency: " << residency.resourceCount << " resources, " << residency.tracked / (1024 * 1024) << " MiB tracked, "
+                  << residency.usage / (1024 * 1024) << " / " << residency.budget / (1024 * 1024) << " MiB of the "
+                  << (residency.driverBudget ? "driver" : "configured") << " budget" << std::endl;
     }
 
     AveApp::~AveApp(){
+        if (gpuCulling) {
+            aveDevice.getGeometryPool().free(cullingGeometry);
+        }
         vkDestroySampler(aveDevice.device(), textureSampler, nullptr);
-        vkDestroyImageView(aveDevice.device(), textureImageView, nullptr);
-        vkDestroyImage(aveDevice.device(), textureImage, nullptr);
-        vkFreeMemory(aveDevice.device(), textureImageMemory, nullptr);
 
         vkDestroyDescriptorSetLayout(aveDevice.device(), descriptorSetLayout, nullptr);
         vkDestroyPipelineLayout(aveDevice.device(), pipelineLayout, nullptr);
@@ -41,20 +71,14 @@ namespace ave{
         {
             VkDescriptorSetLayoutBinding uboLayoutBinding{};
             uboLayoutBinding.binding = 0;
-            uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; // per object offset into the uniform ring
             uboLayoutBinding.descriptorCount = 1;
 
             uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
             uboLayoutBinding.pImmutableSamplers = nullptr; // Optional
 
-            VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-            samplerLayoutBinding.binding = 1;
-            samplerLayoutBinding.descriptorCount = 1;
-            samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            samplerLayoutBinding.pImmutableSamplers = nullptr;
-            samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-            std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
+            // Textures are in the bindless table, set 1
+            std::array<VkDescriptorSetLayoutBinding, 1> bindings = {uboLayoutBinding};
             VkDescriptorSetLayoutCreateInfo layoutInfo{};
             layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
             layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -69,10 +93,18 @@ namespace ave{
     void AveApp::createPipelineLayout(){
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-        pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-        pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+        // Set 0 holds per object uniforms, set 1 every texture. Draws push their material's texture slot.
+        std::array<VkDescriptorSetLayout, 2> setLayouts = {descriptorSetLayout, aveDevice.getBindlessTextures().getLayout()};
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(MaterialPushConstants);
+
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
         if (vkCreatePipelineLayout(aveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
@@ -106,16 +138,30 @@ namespace ave{
         assert(aveSwapChain != nullptr && "Cannot create pipeline before swapchain");
         assert(pipelineLayout != nullptr && "Cannot create pipeline before layout");
 
-        ave::PipelineConfigInfo pipelineConfig{};
-        AvePipeline::defaultPipelineConfigInfo(pipelineConfig);
-        pipelineConfig.multisampleInfo.rasterizationSamples = aveDevice.getMsaaSamples();
-        pipelineConfig.renderPass = aveSwapChain->getRenderPass();
-        pipelineConfig.pipelineLayout = pipelineLayout;
-        avePipeline = std::make_unique<AvePipeline>(
-            aveDevice,
+        // Indexed by VertexFormat, the packed shader decodes octahedral normals
+        static const char* vertShaderPaths[VERTEX_FORMAT_COUNT] = {
             "shaders/shader.vert.spv",
-            "shaders/shader.frag.spv",
-            pipelineConfig);
+            "shaders/shader_packed.vert.spv",
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+            ave::PipelineConfigInfo pipelineConfig{};
+            AvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+            AvePipeline::setVertexLayout(pipelineConfig, static_cast<VertexFormat>(format));
+            pipelineConfig.multisampleInfo.rasterizationSamples = aveDevice.getMsaaSamples();
+            pipelineConfig.renderPass = aveSwapChain->getRenderPass();
+            pipelineConfig.pipelineLayout = pipelineLayout;
+            avePipelines[format] = std::make_unique<AvePipeline>(
+                aveDevice,
+                pipelineCache,
+                vertShaderPaths[format],
+                "shaders/shader.frag.spv",
+                pipelineConfig);
+        }
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "created " << VERTEX_FORMAT_COUNT << " pipelines in " << milliseconds << " ms ("
+                  << (pipelineCache.isWarm() ? "warm" : "cold") << " pipeline cache)" << std::endl;
     };
 
     void AveApp::createCommandBuffers() {
@@ -142,49 +188,14 @@ namespace ave{
     }
 
     void AveApp::createDescriptorSets(){
-        std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
-        VkDescriptorSetAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool = aveDevice.getDescriptorPool();
-        allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-        allocInfo.pSetLayouts = layouts.data();
+        // Every frame reads the same ring buffer through its dynamic offset, so the cache hands all of them one set
+        std::vector<DescriptorBinding> bindings = {
+            DescriptorBinding::forBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, aveDevice.getUniformRing().getBuffer(), 0, sizeof(UniformBufferObject))
+        };
 
         descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-        if (vkAllocateDescriptorSets(aveDevice.device(), &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate descriptor sets!");
-        }
-
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            VkDescriptorBufferInfo bufferInfo{};
-            bufferInfo.buffer = aveModel->getUniformBuffer(i);
-            bufferInfo.offset = 0;
-            bufferInfo.range = sizeof(UniformBufferObject);
-
-            VkDescriptorImageInfo imageInfo{};
-            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfo.imageView = textureImageView;
-            imageInfo.sampler = textureSampler;
-
-
-            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[0].dstSet = descriptorSets[i];
-            descriptorWrites[0].dstBinding = 0;
-            descriptorWrites[0].dstArrayElement = 0;
-            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrites[0].descriptorCount = 1;
-            descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[1].dstSet = descriptorSets[i];
-            descriptorWrites[1].dstBinding = 1;
-            descriptorWrites[1].dstArrayElement = 0;
-            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[1].descriptorCount = 1;
-            descriptorWrites[1].pImageInfo = &imageInfo;
-
-            vkUpdateDescriptorSets(aveDevice.device(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+            descriptorSets[i] = aveDevice.getDescriptorAllocator().getPersistent(descriptorSetLayout, bindings);
         }
    }
 
@@ -219,48 +230,7 @@ namespace ave{
         if (vkCreateSampler(aveDevice.device(), &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
             throw std::runtime_error("failed to create texture sampler!");
         }
-
-    }
-
-    void AveApp::createTextureImageView() {
-        textureImageView = aveSwapChain->createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
-    }
-
-    void AveApp::createTextureImage(){
-        int texWidth, texHeight, texChannels;
-            // stbi_uc* pixels = stbi_load("textures/texture.jpg", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-            stbi_uc* pixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-            mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-
-            VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-            if (!pixels) {
-                throw std::runtime_error("failed to load texture image!");
-            }
-
-            VkBuffer stagingBuffer;
-            VkDeviceMemory stagingBufferMemory;
-
-            aveDevice.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-            void* data;
-            vkMapMemory(aveDevice.device(), stagingBufferMemory, 0, imageSize, 0, &data);
-                memcpy(data, pixels, static_cast<size_t>(imageSize));
-            vkUnmapMemory(aveDevice.device(), stagingBufferMemory);
-
-            stbi_image_free(pixels);
-            aveDevice.createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
-
-            aveDevice.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-            aveDevice.copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1);
-            // aveDevice.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-
-
-            vkDestroyBuffer(aveDevice.device(), stagingBuffer, nullptr);
-            vkFreeMemory(aveDevice.device(), stagingBufferMemory, nullptr);
-
-            generateMipmaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
+        aveDevice.getBindlessTextures().setSampler(textureSampler);
 
     }
 
@@ -383,135 +353,112 @@ namespace ave{
             //     }
             // }
 
-            // tinyobj::attrib_t attrib;
-            // std::vector<tinyobj::shape_t> shapes;
-            // std::vector<tinyobj::material_t> materials;
-            // std::string warn, err;
-
-            // if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str())) {
-            //     throw std::runtime_error(warn + err);
-            // }
-
-
-            // std::unordered_map<ave::Vertex, uint32_t, ave::Vertex_hash> uniqueVertices;
-
-
-            // for (const auto& shape : shapes) {
-            //     for (const auto& index : shape.mesh.indices) {
-            //         Vertex vertex{};
-
-            //         vertex.pos = {
-            //             attrib.vertices[3 * index.vertex_index + 0],
-            //             attrib.vertices[3 * index.vertex_index + 1],
-            //             attrib.vertices[3 * index.vertex_index + 2]
-            //         };
-
-            //         vertex.texCoord = {
-            //             attrib.texcoords[2 * index.texcoord_index + 0],
-            //             1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            //         };
-
-            //         vertex.color = {1.0f, 1.0f, 1.0f};
-
-            //         if (uniqueVertices.count(vertex) == 0) {
-            //             uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-            //             vertices.push_back(vertex);
-            //         }
-
-            //         indices.push_back(uniqueVertices[vertex]);
-            //     }
-            // }
-
             // aveModel = std::make_unique<AveModel>(aveDevice, vertices, indices);
-            aveModel = ave::AveModel::createCubeModel(aveDevice);
+            // aveModel = ave::AveModel::createCubeModel(aveDevice);
+            if (AveMappedFile::exists(COOKED_MODEL_PATH)) {
+                aveModel = ave::AveModel::createModelFromMeshFile(aveDevice, COOKED_MODEL_PATH);
+            } else {
+                aveModel = ave::AveModel::createModelFromObjFile(aveDevice, MODEL_PATH);
+            }
             // aveModel2 = std::make_unique<AveModel>(aveDevice, vertices2, indices2);
+            modelEntity = scene.create();
         }
 
-    void AveApp::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {        // Check if image format supports linear blitting
-            VkFormatProperties formatProperties;
-            vkGetPhysicalDeviceFormatProperties(aveDevice.getPhysicalDevice(), imageFormat, &formatProperties);
+    void AveApp::createCullingScene() {
+        if (!AveGpuCulling::isSupported(aveDevice)) {
+            std::cout << "gpu culling: drawIndirectFirstInstance not supported, skipped" << std::endl;
+            return;
+        }
 
-            if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
-                throw std::runtime_error("texture image format does not support linear blitting!");
+        std::vector<Vertex> vertices;
+        std::vector<u_int32_t> indices;
+        AveModel::getCubeGeometry(vertices, indices);
+        cullingGeometry = aveDevice.getGeometryPool().allocate(vertices.data(), static_cast<uint32_t>(vertices.size()),
+            sizeof(Vertex), indices.data(), static_cast<uint32_t>(indices.size()), cullingUploadToken);
+
+        // A floor of small cubes under the model, the camera only ever sees part of it. Each cube is an entity
+        // under the floor's, moving the floor moves them all.
+        gpuCulling = std::make_unique<AveGpuCulling>(aveDevice, pipelineCache, VertexFormat::Full);
+        CullMeshId cube = gpuCulling->addMesh(cullingGeometry, 0, static_cast<uint32_t>(indices.size()), glm::vec3{0.0f}, 0.8661f);
+        EntityId floor = scene.create(glm::translate(glm::mat4{1.0f}, glm::vec3{0.0f, 0.0f, -1.0f}));
+        for (uint32_t y = 0; y < CULLING_GRID; y++) {
+            for (uint32_t x = 0; x < CULLING_GRID; x++) {
+                glm::vec2 position = (glm::vec2(x, y) / static_cast<float>(CULLING_GRID - 1) - 0.5f) * 8.0f;
+                EntityId entity = scene.create(glm::scale(glm::translate(glm::mat4{1.0f}, glm::vec3{position, 0.0f}), glm::vec3{0.06f}), floor);
+
+                // Placed by the first scene update
+                InstanceData instance{};
+                instance.color = glm::vec4{x / static_cast<float>(CULLING_GRID), y / static_cast<float>(CULLING_GRID), 1.0f, 1.0f};
+                entityCullObjects.resize(std::max<size_t>(entityCullObjects.size(), entity + 1), CULL_OBJECT_EMPTY);
+                entityCullObjects[entity] = gpuCulling->addObject(cube, instance);
             }
+        }
+    }
 
-            VkCommandBuffer commandBuffer = aveDevice.beginSingleTimeCommands();
-
-            VkImageMemoryBarrier barrier{};
-            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-            barrier.image = image;
-            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            barrier.subresourceRange.baseArrayLayer = 0;
-            barrier.subresourceRange.layerCount = 1;
-            barrier.subresourceRange.levelCount = 1;
-
-            int32_t mipWidth = texWidth;
-            int32_t mipHeight = texHeight;
-
-            for (uint32_t i = 1; i < mipLevels; i++) {
-                barrier.subresourceRange.baseMipLevel = i - 1;
-                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-                vkCmdPipelineBarrier(commandBuffer,
-                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-                    0, nullptr,
-                    0, nullptr,
-                    1, &barrier);
-
-                VkImageBlit blit{};
-                blit.srcOffsets[0] = {0, 0, 0};
-                blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
-                blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                blit.srcSubresource.mipLevel = i - 1;
-                blit.srcSubresource.baseArrayLayer = 0;
-                blit.srcSubresource.layerCount = 1;
-                blit.dstOffsets[0] = {0, 0, 0};
-                blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
-                blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                blit.dstSubresource.mipLevel = i;
-                blit.dstSubresource.baseArrayLayer = 0;
-                blit.dstSubresource.layerCount = 1;
-
-                vkCmdBlitImage(commandBuffer,
-                    image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                    image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    1, &blit,
-                    VK_FILTER_LINEAR);
-
-                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-                barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-                vkCmdPipelineBarrier(commandBuffer,
-                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-                    0, nullptr,
-                    0, nullptr,
-                    1, &barrier);
-
-                if (mipWidth > 1) mipWidth /= 2;
-                if (mipHeight > 1) mipHeight /= 2;
+    void AveApp::createForest() {
+        std::vector<Vertex> vertices;
+        std::vector<u_int32_t> indices;
+        AveModel::getCubeGeometry(vertices, indices);
+        forest = std::make_unique<AveModel>(aveDevice, vertices, indices);
+        forest->setLods({{0, static_cast<uint32_t>(indices.size()), 0.0f, 0, 0}}, glm::vec3{-0.5f}, glm::vec3{0.5f});
+        forestEntity = scene.create();
+
+        // Tall boxes standing on the floor between its cubes, placed by their instances rather than entities
+        std::vector<InstanceData> trees(FOREST_GRID * FOREST_GRID);
+        for (uint32_t y = 0; y < FOREST_GRID; y++) {
+            for (uint32_t x = 0; x < FOREST_GRID; x++) {
+                glm::vec2 position = ((glm::vec2(x, y) + 0.5f) / static_cast<float>(FOREST_GRID) - 0.5f) * 8.0f;
+                float height = 0.3f + 0.2f * ((x * 7 + y * 13) % 5) / 4.0f;
+                InstanceData& tree = trees[y * FOREST_GRID + x];
+                tree.transform = glm::scale(glm::translate(glm::mat4{1.0f}, glm::vec3{position, -0.94f + height * 0.5f}),
+                    glm::vec3{0.05f, 0.05f, height});
+                tree.color = glm::vec4{0.2f, 0.5f + 0.5f * x / FOREST_GRID, 0.2f, 1.0f};
             }
+        }
+        forest->enableInstancing(static_cast<uint32_t>(trees.size()));
+        forest->setInstances(0, trees.data(), static_cast<uint32_t>(trees.size()));
+        forest->setInstanceCount(static_cast<uint32_t>(trees.size()));
+    }
 
-            barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    void AveApp::createWave() {
+        // Flat unit sheet facing +z, animateWave displaces it in place
+        std::vector<Vertex> vertices;
+        std::vector<u_int32_t> indices;
+        for (uint32_t y = 0; y < WAVE_GRID; y++) {
+            for (uint32_t x = 0; x < WAVE_GRID; x++) {
+                glm::vec2 uv = glm::vec2(x, y) / static_cast<float>(WAVE_GRID - 1);
+                vertices.push_back({{uv - 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.3f, 0.5f + 0.5f * uv.x, 1.0f}, uv});
+            }
+        }
+        for (uint32_t y = 0; y + 1 < WAVE_GRID; y++) {
+            for (uint32_t x = 0; x + 1 < WAVE_GRID; x++) {
+                u_int32_t corner = y * WAVE_GRID + x;
+                indices.insert(indices.end(), {corner, corner + 1, corner + WAVE_GRID + 1, corner + WAVE_GRID + 1, corner + WAVE_GRID, corner});
+            }
+        }
 
-            vkCmdPipelineBarrier(commandBuffer,
-                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-                0, nullptr,
-                0, nullptr,
-                1, &barrier);
+        wave = std::make_unique<AveModel>(aveDevice, vertices, indices, true);
+        // The bounds cover the highest crest and lowest trough, they are not updated as the sheet moves
+        wave->setLods({{0, static_cast<uint32_t>(indices.size()), 0.0f, 0, 0}}, glm::vec3{-0.5f, -0.5f, -WAVE_AMPLITUDE},
+            glm::vec3{0.5f, 0.5f, WAVE_AMPLITUDE});
+        waveEntity = scene.create(glm::scale(glm::translate(glm::mat4{1.0f}, glm::vec3{-1.5f, 1.5f, -0.8f}), glm::vec3{1.5f}));
+    }
 
-            aveDevice.endSingleTimeCommands(commandBuffer);
+    void AveApp::animateWave(float time) {
+        // Rewrites every vertex in place, height and normal of a travelling ripple
+        Vertex* vertices = wave->getVertices();
+        for (uint32_t i = 0; i < WAVE_GRID * WAVE_GRID; i++) {
+            Vertex& vertex = vertices[i];
+            glm::vec2 flat{vertex.pos.x, vertex.pos.y};
+            float distance = glm::length(flat);
+            float phase = distance * WAVE_FREQUENCY - time * 3.0f;
+            vertex.pos.z = WAVE_AMPLITUDE * std::sin(phase);
+            float slope = WAVE_AMPLITUDE * WAVE_FREQUENCY * std::cos(phase);
+            glm::vec2 radial = distance > 0.0f ? flat / distance : glm::vec2{0.0f};
+            vertex.normal = glm::normalize(glm::vec3{-slope * radial, 1.0f});
         }
+        wave->markVerticesDirty(0, WAVE_GRID * WAVE_GRID);
+    }
 
     // void cleanup() {
     //     vkDestroyPipelineLayout(aveDevice.device(), pipelineLayout, nullptr);
@@ -526,8 +473,81 @@ namespace ave{
         if (vkBeginCommandBuffer(commandBuffers[imageIndex], &beginInfo) != VK_SUCCESS) {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
-        aveModel->updateUniformBuffer(aveSwapChain->getCurrentFrame(), aveSwapChain->getSwapChainExtent());
-        // aveModel->updateModel();
+        // acquireNextImage waited on this frame's fence, so its staging space is free again
+        aveDevice.getStagingRing().beginFrame(aveSwapChain->getCurrentFrame());
+        aveDevice.getUniformRing().beginFrame(aveSwapChain->getCurrentFrame());
+        aveDevice.getGeometryPool().beginFrame(aveSwapChain->getCurrentFrame());
+        aveDevice.getBindlessTextures().beginFrame(aveSwapChain->getCurrentFrame());
+        aveDevice.getDescriptorAllocator().beginFrame(aveSwapChain->getCurrentFrame());
+        parallelRecorder->beginFrame(aveSwapChain->getCurrentFrame());
+        aveDevice.getUploadQueue().beginFrame(aveSwapChain->getCurrentFrame());
+        // Acquires buffers whose uploads finished on the transfer queue and submits newly queued ones
+        aveDevice.getUploadQueue().update(commandBuffers[imageIndex]);
+        // Over the memory budget, evicts or shrinks what was used least recently before this frame touches anything
+        aveDevice.getResidency().update(commandBuffers[imageIndex]);
+        // Unloaded models leave holes in the shared geometry buffers, pack them once enough space is lost
+        if (aveDevice.getGeometryPool().needsCompaction()) {
+            aveDevice.getGeometryPool().compact(commandBuffers[imageIndex]);
+        }
+        // Models reloaded below may grow the pool, that copy has to follow the barriers and compaction above
+        aveDevice.getGeometryPool().setFrameCommandBuffer(commandBuffers[imageIndex]);
+
+        // Animation only writes local transforms, the scene recomputes the world matrices of what changed
+        static auto startTime = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+        scene.setLocal(modelEntity, glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(1.0, 0.0, sin(time))));
+        scene.update();
+        animateWave(time);
+        if (gpuCulling) {
+            for (EntityId entity : scene.getChanged()) {
+                if (entity < entityCullObjects.size() && entityCullObjects[entity] != CULL_OBJECT_EMPTY) {
+                    gpuCulling->setTransform(entityCullObjects[entity], scene.getWorld(entity));
+                }
+            }
+        }
+
+        VkExtent2D extent = aveSwapChain->getSwapChainExtent();
+        glm::mat4 view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        glm::mat4 proj = glm::perspective(glm::radians(45.0f), extent.width / (float) extent.height, 0.1f, 10.0f);
+        proj[1][1] *= -1;
+
+        aveModel->updateUniformBuffer(scene.getWorld(modelEntity), view, proj, extent);
+        forest->updateUniformBuffer(scene.getWorld(forestEntity), view, proj, extent);
+        wave->updateUniformBuffer(scene.getWorld(waveEntity), view, proj, extent);
+        textureLoader->update();
+        aveModel->updateModel(aveSwapChain->getCurrentFrame());
+        forest->updateModel(aveSwapChain->getCurrentFrame());
+        wave->updateModel(aveSwapChain->getCurrentFrame());
+        // Outside the render pass, after compaction moved whatever geometry it moves this frame
+        if (gpuCulling) {
+            gpuCulling->beginFrame(aveSwapChain->getCurrentFrame());
+            gpuCulling->cull(commandBuffers[imageIndex], view, proj);
+        }
+
+        // Everything that touches residency, the upload queue or the rings happens here, recording only reads
+        drawList.clear();
+        frameTextureSlot = textureLoader->getSlot(texture);
+        cullCandidates.clear();
+        candidateBounds.clear();
+        if (aveModel->isReady()) {
+            cullCandidates.push_back(aveModel.get());
+        }
+        if (forest->isReady()) {
+            cullCandidates.push_back(forest.get());
+        }
+        if (wave->isReady()) {
+            cullCandidates.push_back(wave.get());
+        }
+        for (AveModel* model : cullCandidates) {
+            candidateBounds.add(glm::vec3{model->getWorldSphere()}, model->getWorldSphere().w);
+        }
+        candidateBounds.cull(AveFrustum::fromMatrix(proj * view), visibleCandidates);
+        for (uint32_t index : visibleCandidates) {
+            AveModel* model = cullCandidates[index];
+            drawList.push_back({model, model->getUniformOffset(), frameTextureSlot});
+        }
+
+        aveDevice.getGeometryPool().setFrameCommandBuffer(VK_NULL_HANDLE);
 
         // Begin Drawing
 
@@ -545,10 +565,22 @@ namespace ave{
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(commandBuffers[imageIndex], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        // vkCmdBindPipeline(commandBuffers[imageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-        avePipeline->bind(commandBuffers[imageIndex]);
-        aveModel->bind(commandBuffers[imageIndex]);
+        // Large draw lists are split across the thread pool into secondary buffers
+        parallelRecorder->recordRenderPass(commandBuffers[imageIndex], renderPassInfo, static_cast<uint32_t>(drawList.size()),
+            [this](VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount) {
+                recordDraws(commandBuffer, firstDraw, drawCount);
+            });
+
+        if (vkEndCommandBuffer(commandBuffers[imageIndex]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+    }
+
+    void AveApp::recordDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount) {
+        // Secondary buffers inherit no state, every range sets up its own
+        aveDevice.getGeometryPool().bind(commandBuffer);
+        // Every texture of the frame, bound once per range
+        aveDevice.getBindlessTextures().bind(commandBuffer, pipelineLayout, 1);
 
         VkViewport viewport{};
         viewport.x = 0.0f;
@@ -557,28 +589,34 @@ namespace ave{
         viewport.height = static_cast<float>(aveSwapChain->getSwapChainExtent().height);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(commandBuffers[imageIndex], 0, 1, &viewport);
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
         VkRect2D scissor{};
         scissor.offset = {0, 0};
         scissor.extent = aveSwapChain->getSwapChainExtent();
-        vkCmdSetScissor(commandBuffers[imageIndex], 0, 1, &scissor);
-
-        // vkCmdDraw(commandBuffers[imageIndex], 3, 1, 0, 0);
-        vkCmdBindDescriptorSets(commandBuffers[imageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[aveSwapChain->getCurrentFrame()], 0, nullptr);
-        aveModel->draw(commandBuffers[imageIndex]);
-
-        // aveModel2->bind(commandBuffers[imageIndex]);
-
-        // vkCmdDraw(commandBuffers[imageIndex], 3, 1, 0, 0);
-        // vkCmdBindDescriptorSets(commandBuffers[imageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[aveSwapChain->getCurrentFrame()], 0, nullptr);
-        // aveModel2->draw(commandBuffers[imageIndex]);
-
-
-        vkCmdEndRenderPass(commandBuffers[imageIndex]);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        VkDescriptorSet descriptorSet = descriptorSets[aveSwapChain->getCurrentFrame()];
+        uint32_t boundFormat = VERTEX_FORMAT_COUNT;
+        for (uint32_t i = firstDraw; i < firstDraw + drawCount; i++) {
+            const DrawItem& item = drawList[i];
+            uint32_t format = static_cast<uint32_t>(item.model->getVertexFormat());
+            if (format != boundFormat) {
+                avePipelines[format]->bind(commandBuffer);
+                boundFormat = format;
+            }
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &item.uniformOffset);
+            MaterialPushConstants material{item.textureSlot};
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(material), &material);
+            item.model->draw(commandBuffer);
+        }
 
-        if (vkEndCommandBuffer(commandBuffers[imageIndex]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to record command buffer!");
+        // The GPU culled objects are a single indirect draw, recorded with the first range
+        if (gpuCulling && firstDraw == 0 && aveDevice.getUploadQueue().isComplete(cullingUploadToken)) {
+            avePipelines[static_cast<uint32_t>(gpuCulling->getVertexFormat())]->bind(commandBuffer);
+            MaterialPushConstants material{frameTextureSlot};
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(material), &material);
+            gpuCulling->draw(commandBuffer, pipelineLayout, descriptorSet);
         }
     }
 
@@ -7,21 +7,40 @@
 #include "ave_window.hpp"
 #include "ave_device.hpp"
 #include "ave_pipeline.hpp"
+#include "ave_pipeline_cache.hpp"
 #include "ave_swapchain.hpp"
 #include "ave_model.hpp"
+#include "ave_scene.hpp"
+#include "ave_bounds_culler.hpp"
+#include "ave_gpu_culling.hpp"
+#include "ave_parallel_recorder.hpp"
+#include "ave_thread_pool.hpp"
+#include "ave_texture_loader.hpp"
 
 namespace ave {
+
+// Per draw, matches the push constant block of shader.frag
+struct MaterialPushConstants {
+    uint32_t textureSlot; // into the bindless texture table
+};
+
 class AveApp {
 public:
     static constexpr int WIDTH = 800;
     static constexpr int HEIGHT = 600;
+    static constexpr uint32_t CULLING_GRID = 64; // cubes per side of the field drawn through AveGpuCulling
+    static constexpr uint32_t FOREST_GRID = 16;  // trees per side of the instanced forest
+    static constexpr uint32_t WAVE_GRID = 48;    // vertices per side of the rippling sheet, rewritten every frame
+    static constexpr float WAVE_AMPLITUDE = 0.04f;
+    static constexpr float WAVE_FREQUENCY = 25.0f; // radians per unit of distance from the sheet's centre
     int num;
 
 private:
     AveWindow aveWindow{WIDTH, HEIGHT, "Hello Vulkan"};
     AveDevice aveDevice{aveWindow};
+    AvePipelineCache pipelineCache{aveDevice, PIPELINE_CACHE_PATH}; // outlives the pipelines, saved on exit
     std::unique_ptr<AveSwapChain> aveSwapChain; //{aveDevice, aveWindow.getExtent()};
-    std::unique_ptr<AvePipeline> avePipeline;
+    std::array<std::unique_ptr<AvePipeline>, VERTEX_FORMAT_COUNT> avePipelines; // one per VertexFormat
 
 
     // AveCamera aveCamera{aveDevice};
@@ -31,16 +50,48 @@ private:
     std::vector<VkCommandBuffer> commandBuffers;
     std::vector<VkDescriptorSet> descriptorSets;
 
+    // Transforms of everything in the world, models and culled objects read their world matrices from it
+    AveScene scene;
+    EntityId modelEntity;
+
     std::unique_ptr<AveModel> aveModel;
     std::unique_ptr<AveModel> aveModel2;
     std::vector<std::unique_ptr<AveModel>> models;
+    // One instanced model, a draw for all of its trees
+    std::unique_ptr<AveModel> forest;
+    EntityId forestEntity;
+    // Dynamic model whose vertices the CPU moves every frame
+    std::unique_ptr<AveModel> wave;
+    EntityId waveEntity;
+
+
+    AveThreadPool threadPool;
+    // Recording has its own workers, ranges of a frame never queue behind texture decodes on the FIFO
+    AveThreadPool recordingPool;
+    std::unique_ptr<AveTextureLoader> textureLoader;
+    TextureHandle texture;
+    std::unique_ptr<AveParallelRecorder> parallelRecorder;
+
+    // What the frame draws, gathered on the main thread so recording threads only read it
+    struct DrawItem {
+        AveModel* model;
+        uint32_t uniformOffset;
+        uint32_t textureSlot;
+    };
+    std::vector<DrawItem> drawList;
+    TextureSlot frameTextureSlot;
+
+    // Models that could be drawn this frame, only those whose bounds meet the frustum make it into drawList
+    std::vector<AveModel*> cullCandidates;
+    AveBoundsCuller candidateBounds;
+    std::vector<uint32_t> visibleCandidates;
+
+    // Static objects culled and drawn on the GPU, only when the device supports it
+    std::unique_ptr<AveGpuCulling> gpuCulling;
+    GeometryHandle cullingGeometry;
+    UploadToken cullingUploadToken = 0;
+    std::vector<CullObjectId> entityCullObjects; // by EntityId, CULL_OBJECT_EMPTY for entities without one
 
-
-    uint32_t mipLevels;
-    VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
-
-    VkImageView textureImageView;
     VkSampler textureSampler;
 
 
@@ -62,17 +113,19 @@ private:
     void createDescriptorSets();
 
     void createTextureSampler();
-    void createTextureImageView();
-    void createTextureImage();
-    void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
 
     void loadModels();
+    void createCullingScene();
+    void createForest();
+    void createWave();
+    void animateWave(float time);
 
     // void cleanup() {
     //     vkDestroyPipelineLayout(aveDevice.device(), pipelineLayout, nullptr);
     // }
 
     void recordCommandBuffer(uint32_t imageIndex);
+    void recordDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount);
     void drawFrame();
 };
 }
\ No newline at end of file
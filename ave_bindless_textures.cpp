@@ -0,0 +1,145 @@
+#include "ave_bindless_textures.hpp"
+#include "ave_device.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ave {
+
+    AveBindlessTextures::AveBindlessTextures(AveDevice& device) : aveDevice{device} {
+        // Update after bind limits are separate from (and far above) maxPerStageDescriptorSampledImages
+        VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+        indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &indexingProperties;
+        auto getProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(
+            vkGetInstanceProcAddr(aveDevice.getInstance(), "vkGetPhysicalDeviceProperties2KHR"));
+        getProperties2(aveDevice.getPhysicalDevice(), &properties);
+        capacity_ = std::min({MAX_TEXTURES, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages});
+
+        std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        bindings[1].descriptorCount = capacity_;
+        bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        // Slots that were never written or whose texture is gone are fine as long as no draw indexes them
+        std::array<VkDescriptorBindingFlags, 2> bindingFlags = {
+            0,
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT
+                | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
+        };
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = &bindingFlagsInfo;
+        layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+        if (vkCreateDescriptorSetLayout(aveDevice.device(), &layoutInfo, nullptr, &layout_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create bindless texture set layout!");
+        }
+
+        std::array<VkDescriptorPoolSize, 2> poolSizes{};
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+        poolSizes[0].descriptorCount = 1;
+        poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        poolSizes[1].descriptorCount = capacity_;
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        if (vkCreateDescriptorPool(aveDevice.device(), &poolInfo, nullptr, &pool_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create bindless texture pool!");
+        }
+
+        VkDescriptorSetVariableDescriptorCountAllocateInfo countInfo{};
+        countInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+        countInfo.descriptorSetCount = 1;
+        countInfo.pDescriptorCounts = &capacity_;
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.pNext = &countInfo;
+        allocInfo.descriptorPool = pool_;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout_;
+        if (vkAllocateDescriptorSets(aveDevice.device(), &allocInfo, &set_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate bindless texture set!");
+        }
+    }
+
+    AveBindlessTextures::~AveBindlessTextures() {
+        vkDestroyDescriptorPool(aveDevice.device(), pool_, nullptr);
+        vkDestroyDescriptorSetLayout(aveDevice.device(), layout_, nullptr);
+    }
+
+    void AveBindlessTextures::setSampler(VkSampler sampler) {
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = sampler;
+
+        VkWriteDescriptorSet descriptorWrite{};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = set_;
+        descriptorWrite.dstBinding = 0;
+        descriptorWrite.dstArrayElement = 0;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(aveDevice.device(), 1, &descriptorWrite, 0, nullptr);
+    }
+
+    TextureSlot AveBindlessTextures::allocate(VkImageView view) {
+        TextureSlot slot;
+        if (!freeSlots_.empty()) {
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+        } else if (nextSlot_ < capacity_) {
+            slot = nextSlot_++;
+        } else {
+            throw std::runtime_error("bindless texture table is full!");
+        }
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = view;
+
+        VkWriteDescriptorSet descriptorWrite{};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = set_;
+        descriptorWrite.dstBinding = 1;
+        descriptorWrite.dstArrayElement = slot;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(aveDevice.device(), 1, &descriptorWrite, 0, nullptr);
+        return slot;
+    }
+
+    void AveBindlessTextures::free(TextureSlot slot) {
+        dyingSlots_[currentFrame_].push_back(slot);
+    }
+
+    void AveBindlessTextures::beginFrame(uint32_t frameIndex) {
+        freeSlots_.insert(freeSlots_.end(), dyingSlots_[frameIndex].begin(), dyingSlots_[frameIndex].end());
+        dyingSlots_[frameIndex].clear();
+        currentFrame_ = frameIndex;
+    }
+
+    void AveBindlessTextures::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set) {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set, 1, &set_, 0, nullptr);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ave_constants.h"
+
+#include <array>
+#include <vector>
+
+namespace ave {
+
+    class AveDevice;
+
+    using TextureSlot = uint32_t;
+
+    // Every texture the renderer samples lives in one global descriptor set: a sampler at binding 0 and a
+    // variable count array of sampled images at binding 1. Shaders pick their texture by index (the slot of
+    // the draw's material, pushed as a constant), so the set is bound once per frame however many textures
+    // a scene uses.
+    //
+    // The array is UPDATE_AFTER_BIND, which lifts the small per stage descriptor limits, and
+    // UPDATE_UNUSED_WHILE_PENDING, so new slots can be written while frames in flight still use the set.
+    // A written slot is never rewritten while a frame may read it: giving a texture a new view takes a new
+    // slot, and freed slots are handed out again once the frame slot that freed them comes around.
+    class AveBindlessTextures {
+        public:
+            static constexpr uint32_t MAX_TEXTURES = 16384; // clamped to the device's update after bind limits
+
+            AveBindlessTextures(AveDevice& device);
+            ~AveBindlessTextures();
+
+            AveBindlessTextures(const AveBindlessTextures&) = delete;
+            AveBindlessTextures& operator=(const AveBindlessTextures&) = delete;
+
+            // Sampler for every slot, set once before the first frame binds the table
+            void setSampler(VkSampler sampler);
+
+            // View has to be in SHADER_READ_ONLY_OPTIMAL whenever a draw samples it, throws when the table is full
+            TextureSlot allocate(VkImageView view);
+            void free(TextureSlot slot);
+
+            // Call after the frame's in flight fence was waited on, slots that frame freed become reusable
+            void beginFrame(uint32_t frameIndex);
+            void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set);
+
+            VkDescriptorSetLayout getLayout() const { return layout_; }
+            uint32_t getCapacity() const { return capacity_; }
+            uint32_t getUsedCount() const { return nextSlot_ - static_cast<uint32_t>(freeSlots_.size()); }
+
+        private:
+            AveDevice& aveDevice;
+            VkDescriptorSetLayout layout_;
+            VkDescriptorPool pool_;
+            VkDescriptorSet set_;
+            uint32_t capacity_;
+
+            TextureSlot nextSlot_ = 0; // slots at and above were never handed out
+            std::vector<TextureSlot> freeSlots_;
+            uint32_t currentFrame_ = 0;
+            std::array<std::vector<TextureSlot>, MAX_FRAMES_IN_FLIGHT> dyingSlots_;
+    };
+}
@@ -0,0 +1,186 @@
+#include "ave_bounds_culler.hpp"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// AVX2 is compiled per function and only called when the CPU has it
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define AVE_CULL_AVX2 1
+#endif
+
+namespace ave {
+
+    namespace {
+        struct Spheres {
+            const float* x;
+            const float* y;
+            const float* z;
+            const float* radius;
+        };
+
+        // Spheres [first, end) one by one, in the operation order the vector paths use so results match exactly
+        uint32_t cullScalar(const Spheres& spheres, uint32_t first, uint32_t end, const AveFrustum& frustum, uint32_t* out) {
+            uint32_t count = 0;
+            for (uint32_t i = first; i < end; i++) {
+                bool inside = true;
+                for (const glm::vec4& plane : frustum.planes) {
+                    float distance = plane.x * spheres.x[i] + plane.y * spheres.y[i] + plane.z * spheres.z[i] + plane.w + spheres.radius[i];
+                    inside = inside && distance >= 0.0f;
+                }
+                out[count] = i;
+                count += inside ? 1 : 0;
+            }
+            return count;
+        }
+
+#if defined(__SSE2__)
+        uint32_t cullSse(const Spheres& spheres, uint32_t sphereCount, const AveFrustum& frustum, uint32_t* out) {
+            __m128 planes[6][4];
+            for (int p = 0; p < 6; p++) {
+                for (int k = 0; k < 4; k++) {
+                    planes[p][k] = _mm_set1_ps(frustum.planes[p][k]);
+                }
+            }
+
+            uint32_t count = 0;
+            uint32_t batchEnd = sphereCount & ~3u;
+            const __m128 zero = _mm_setzero_ps();
+            for (uint32_t i = 0; i < batchEnd; i += 4) {
+                __m128 x = _mm_loadu_ps(spheres.x + i);
+                __m128 y = _mm_loadu_ps(spheres.y + i);
+                __m128 z = _mm_loadu_ps(spheres.z + i);
+                __m128 radius = _mm_loadu_ps(spheres.radius + i);
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int p = 0; p < 6; p++) {
+                    __m128 distance = _mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y));
+                    distance = _mm_add_ps(distance, _mm_mul_ps(planes[p][2], z));
+                    distance = _mm_add_ps(_mm_add_ps(distance, planes[p][3]), radius);
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+                }
+
+                // Lane bits to indices, lowest first
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+                while (mask) {
+                    out[count++] = i + static_cast<uint32_t>(__builtin_ctz(mask));
+                    mask &= mask - 1;
+                }
+            }
+            return count + cullScalar(spheres, batchEnd, sphereCount, frustum, out + count);
+        }
+#endif
+
+#if defined(AVE_CULL_AVX2)
+        __attribute__((target("avx2")))
+        uint32_t cullAvx2(const Spheres& spheres, uint32_t sphereCount, const AveFrustum& frustum, uint32_t* out) {
+            __m256 planes[6][4];
+            for (int p = 0; p < 6; p++) {
+                for (int k = 0; k < 4; k++) {
+                    planes[p][k] = _mm256_set1_ps(frustum.planes[p][k]);
+                }
+            }
+
+            uint32_t count = 0;
+            uint32_t batchEnd = sphereCount & ~7u;
+            const __m256 zero = _mm256_setzero_ps();
+            for (uint32_t i = 0; i < batchEnd; i += 8) {
+                __m256 x = _mm256_loadu_ps(spheres.x + i);
+                __m256 y = _mm256_loadu_ps(spheres.y + i);
+                __m256 z = _mm256_loadu_ps(spheres.z + i);
+                __m256 radius = _mm256_loadu_ps(spheres.radius + i);
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                // No FMA: it rounds once where the scalar reference rounds twice
+                for (int p = 0; p < 6; p++) {
+                    __m256 distance = _mm256_add_ps(_mm256_mul_ps(planes[p][0], x), _mm256_mul_ps(planes[p][1], y));
+                    distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][2], z));
+                    distance = _mm256_add_ps(_mm256_add_ps(distance, planes[p][3]), radius);
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+                }
+
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+                while (mask) {
+                    out[count++] = i + static_cast<uint32_t>(__builtin_ctz(mask));
+                    mask &= mask - 1;
+                }
+            }
+            return count + cullScalar(spheres, batchEnd, sphereCount, frustum, out + count);
+        }
+#endif
+    }
+
+    uint32_t AveBoundsCuller::add(const glm::vec3& center, float radius) {
+        x_.push_back(center.x);
+        y_.push_back(center.y);
+        z_.push_back(center.z);
+        radius_.push_back(radius);
+        return static_cast<uint32_t>(radius_.size() - 1);
+    }
+
+    void AveBoundsCuller::set(uint32_t index, const glm::vec3& center, float radius) {
+        x_[index] = center.x;
+        y_[index] = center.y;
+        z_[index] = center.z;
+        radius_[index] = radius;
+    }
+
+    void AveBoundsCuller::reserve(size_t count) {
+        x_.reserve(count);
+        y_.reserve(count);
+        z_.reserve(count);
+        radius_.reserve(count);
+    }
+
+    void AveBoundsCuller::clear() {
+        x_.clear();
+        y_.clear();
+        z_.clear();
+        radius_.clear();
+    }
+
+    void AveBoundsCuller::cull(const AveFrustum& frustum, std::vector<uint32_t>& visible, Path path) const {
+        // Every path writes an index per sphere tested at worst, sized once and cut down afterwards
+        uint32_t sphereCount = static_cast<uint32_t>(size());
+        visible.resize(sphereCount);
+        Spheres spheres{x_.data(), y_.data(), z_.data(), radius_.data()};
+
+        uint32_t count;
+        switch (path) {
+#if defined(AVE_CULL_AVX2)
+            case Path::Avx2:
+                count = cullAvx2(spheres, sphereCount, frustum, visible.data());
+                break;
+#endif
+#if defined(__SSE2__)
+            case Path::Sse:
+                count = cullSse(spheres, sphereCount, frustum, visible.data());
+                break;
+#endif
+            default:
+                count = cullScalar(spheres, 0, sphereCount, frustum, visible.data());
+                break;
+        }
+        visible.resize(count);
+    }
+
+    AveBoundsCuller::Path AveBoundsCuller::bestPath() {
+#if defined(AVE_CULL_AVX2)
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        if (avx2) {
+            return Path::Avx2;
+        }
+#endif
+#if defined(__SSE2__)
+        return Path::Sse;
+#else
+        return Path::Scalar;
+#endif
+    }
+
+    const char* AveBoundsCuller::pathName(Path path) {
+        switch (path) {
+            case Path::Avx2: return "avx2";
+            case Path::Sse: return "sse";
+            default: return "scalar";
+        }
+    }
+}
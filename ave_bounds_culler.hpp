@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ave_frustum.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ave {
+
+    // World space bounding spheres in structure of arrays form, culled against a frustum a batch at a time.
+    // Each plane test is a handful of multiply-adds over whole lanes: 8 spheres per iteration with AVX2, 4 with
+    // SSE, picked at runtime so the binary needs no -mavx2. Survivors come out as an ascending index list.
+    //
+    // Indices are what add() returned, stable until clear(). A sphere is visible unless it lies entirely behind
+    // some plane, the same test as AveFrustum::intersectsSphere, and every path gives the scalar one's result.
+    class AveBoundsCuller {
+        public:
+            enum class Path { Scalar, Sse, Avx2 };
+
+            uint32_t add(const glm::vec3& center, float radius);
+            void set(uint32_t index, const glm::vec3& center, float radius);
+            void reserve(size_t count);
+            void clear();
+            size_t size() const { return radius_.size(); }
+
+            // Replaces visible with the indices of spheres that intersect the frustum, through the best path
+            void cull(const AveFrustum& frustum, std::vector<uint32_t>& visible) const { cull(frustum, visible, bestPath()); }
+            void cull(const AveFrustum& frustum, std::vector<uint32_t>& visible, Path path) const;
+
+            // Widest path this CPU runs
+            static Path bestPath();
+            static const char* pathName(Path path);
+
+        private:
+            std::vector<float> x_;
+            std::vector<float> y_;
+            std::vector<float> z_;
+            std::vector<float> radius_;
+    };
+}
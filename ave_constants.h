@@ -10,7 +10,10 @@
 namespace ave {
     static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
     const std::string MODEL_PATH = "models/viking_room.obj";
+    const std::string COOKED_MODEL_PATH = "models/viking_room.avemesh"; // written by `make cook`
     const std::string TEXTURE_PATH = "textures/viking_room.png";
+    const std::string PIPELINE_CACHE_PATH = "shaders/pipeline_cache.bin"; // rewritten on every exit
+    const std::string COOKED_TEXTURE_PATH = "textures/viking_room.avetex"; // written by `make cook`, BC7
 }
 
 
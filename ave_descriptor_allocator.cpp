@@ -0,0 +1,254 @@
+#include "ave_descriptor_allocator.hpp"
+#include "ave_device.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace ave {
+
+    namespace {
+        // Descriptors of each type a pool holds per set, sets that need more just fill a pool sooner. Every
+        // Vulkan 1.0 type is listed, a type missing here would fail every allocation of a layout that uses it.
+        struct PoolRatio {
+            VkDescriptorType type;
+            float perSet;
+        };
+        constexpr std::array<PoolRatio, 11> POOL_RATIOS = {{
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4.0f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 0.5f},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f},
+            {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f},
+            {VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.5f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 0.25f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 0.25f},
+            {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.25f},
+        }};
+
+        template<typename Handle>
+        uint64_t handleKey(Handle handle) {
+            return reinterpret_cast<uint64_t>(handle); // pointers on 64 bit platforms, uint64_t elsewhere
+        }
+
+        uint64_t bindingHandle(const DescriptorBinding& binding) {
+            return binding.buffer.buffer != VK_NULL_HANDLE ? handleKey(binding.buffer.buffer) : handleKey(binding.image.imageView);
+        }
+
+        template<typename T>
+        void hashCombine(size_t& seed, const T& value) {
+            seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+    }
+
+    DescriptorBinding DescriptorBinding::forBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+        DescriptorBinding result{binding, type};
+        result.buffer.buffer = buffer;
+        result.buffer.offset = offset;
+        result.buffer.range = range;
+        return result;
+    }
+
+    DescriptorBinding DescriptorBinding::forImage(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout layout) {
+        DescriptorBinding result{binding, type};
+        result.image.imageView = view;
+        result.image.sampler = sampler;
+        result.image.imageLayout = layout;
+        return result;
+    }
+
+    bool AveDescriptorAllocator::SetKey::operator==(const SetKey& other) const {
+        if (layout != other.layout || bindings.size() != other.bindings.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < bindings.size(); i++) {
+            const DescriptorBinding& a = bindings[i];
+            const DescriptorBinding& b = other.bindings[i];
+            if (a.binding != b.binding || a.type != b.type
+                || a.buffer.buffer != b.buffer.buffer || a.buffer.offset != b.buffer.offset || a.buffer.range != b.buffer.range
+                || a.image.imageView != b.image.imageView || a.image.sampler != b.image.sampler || a.image.imageLayout != b.image.imageLayout) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t AveDescriptorAllocator::SetKeyHash::operator()(const SetKey& key) const {
+        size_t seed = std::hash<VkDescriptorSetLayout>()(key.layout);
+        for (const DescriptorBinding& binding : key.bindings) {
+            hashCombine(seed, binding.binding);
+            hashCombine(seed, static_cast<uint32_t>(binding.type));
+            hashCombine(seed, binding.buffer.buffer);
+            hashCombine(seed, binding.buffer.offset);
+            hashCombine(seed, binding.buffer.range);
+            hashCombine(seed, binding.image.imageView);
+            hashCombine(seed, binding.image.sampler);
+            hashCombine(seed, static_cast<uint32_t>(binding.image.imageLayout));
+        }
+        return seed;
+    }
+
+    AveDescriptorAllocator::AveDescriptorAllocator(AveDevice& device) : aveDevice{device} {}
+
+    AveDescriptorAllocator::~AveDescriptorAllocator() {
+        for (VkDescriptorPool pool : persistent_.pools) {
+            vkDestroyDescriptorPool(aveDevice.device(), pool, nullptr);
+        }
+        for (PoolChain& chain : transient_) {
+            for (VkDescriptorPool pool : chain.pools) {
+                vkDestroyDescriptorPool(aveDevice.device(), pool, nullptr);
+            }
+        }
+    }
+
+    VkDescriptorSet AveDescriptorAllocator::getPersistent(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings) {
+        SetKey key{layout, bindings};
+        auto cached = cache_.find(key);
+        if (cached != cache_.end()) {
+            cacheHits_++;
+            return cached->second;
+        }
+
+        VkDescriptorSet set = allocate(persistent_, layout);
+        write(set, bindings);
+
+        for (const DescriptorBinding& binding : bindings) {
+            references_[bindingHandle(binding)]++;
+        }
+        cache_.emplace(std::move(key), set);
+        return set;
+    }
+
+    void AveDescriptorAllocator::invalidateBuffer(VkBuffer buffer) {
+        invalidateHandle(handleKey(buffer));
+    }
+
+    void AveDescriptorAllocator::invalidateImageView(VkImageView view) {
+        invalidateHandle(handleKey(view));
+    }
+
+    void AveDescriptorAllocator::invalidateHandle(uint64_t handle) {
+        if (handle == 0 || references_.find(handle) == references_.end()) {
+            return;
+        }
+
+        auto referenced = [&](const DescriptorBinding& binding) { return bindingHandle(binding) == handle; };
+        for (auto entry = cache_.begin(); entry != cache_.end();) {
+            const std::vector<DescriptorBinding>& bindings = entry->first.bindings;
+            if (std::none_of(bindings.begin(), bindings.end(), referenced)) {
+                ++entry;
+                continue;
+            }
+            for (const DescriptorBinding& binding : bindings) {
+                auto count = references_.find(bindingHandle(binding));
+                if (count != references_.end() && --count->second == 0) {
+                    references_.erase(count);
+                }
+            }
+            entry = cache_.erase(entry);
+        }
+    }
+
+    VkDescriptorSet AveDescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings) {
+        VkDescriptorSet set = allocate(transient_[currentFrame_], layout);
+        write(set, bindings);
+        return set;
+    }
+
+    void AveDescriptorAllocator::write(VkDescriptorSet set, const std::vector<DescriptorBinding>& bindings) {
+        std::vector<VkWriteDescriptorSet> writes(bindings.size());
+        for (size_t i = 0; i < bindings.size(); i++) {
+            const DescriptorBinding& binding = bindings[i];
+            VkWriteDescriptorSet& write = writes[i];
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = set;
+            write.dstBinding = binding.binding;
+            write.dstArrayElement = 0;
+            write.descriptorType = binding.type;
+            write.descriptorCount = 1;
+            if (binding.buffer.buffer != VK_NULL_HANDLE) {
+                write.pBufferInfo = &binding.buffer;
+            } else {
+                write.pImageInfo = &binding.image;
+            }
+        }
+        vkUpdateDescriptorSets(aveDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    void AveDescriptorAllocator::beginFrame(uint32_t frameIndex) {
+        PoolChain& chain = transient_[frameIndex];
+        if (chain.pools.size() > 1) {
+            // Overflowed last time, replace the chain with one pool that holds the whole frame
+            for (VkDescriptorPool pool : chain.pools) {
+                vkDestroyDescriptorPool(aveDevice.device(), pool, nullptr);
+            }
+            chain.pools.clear();
+            chain.setsPerPool = std::min(std::max(chain.setsPerPool, chain.allocatedSets), MAX_SETS_PER_POOL);
+            chain.pools.push_back(createPool(chain.setsPerPool));
+        } else if (!chain.pools.empty()) {
+            vkResetDescriptorPool(aveDevice.device(), chain.pools[0], 0);
+        }
+        chain.allocatedSets = 0;
+        currentFrame_ = frameIndex;
+    }
+
+    VkDescriptorPool AveDescriptorAllocator::createPool(uint32_t maxSets) {
+        std::array<VkDescriptorPoolSize, POOL_RATIOS.size()> poolSizes{};
+        for (size_t i = 0; i < POOL_RATIOS.size(); i++) {
+            poolSizes[i].type = POOL_RATIOS[i].type;
+            poolSizes[i].descriptorCount = std::max(1u, static_cast<uint32_t>(POOL_RATIOS[i].perSet * maxSets));
+        }
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = maxSets;
+
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(aveDevice.device(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor pool!");
+        }
+        return pool;
+    }
+
+    VkDescriptorSet AveDescriptorAllocator::allocate(PoolChain& chain, VkDescriptorSetLayout layout) {
+        if (chain.pools.empty()) {
+            chain.pools.push_back(createPool(chain.setsPerPool));
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = chain.pools.back();
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        VkDescriptorSet set;
+        VkResult result = vkAllocateDescriptorSets(aveDevice.device(), &allocInfo, &set);
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+            chain.setsPerPool = std::min(chain.setsPerPool * 2, MAX_SETS_PER_POOL);
+            chain.pools.push_back(createPool(chain.setsPerPool));
+            allocInfo.descriptorPool = chain.pools.back();
+            result = vkAllocateDescriptorSets(aveDevice.device(), &allocInfo, &set);
+        }
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate descriptor set!");
+        }
+        chain.allocatedSets++;
+        return set;
+    }
+
+    DescriptorAllocatorStats AveDescriptorAllocator::getStats() const {
+        DescriptorAllocatorStats stats{};
+        stats.persistentPools = static_cast<uint32_t>(persistent_.pools.size());
+        stats.persistentSets = static_cast<uint32_t>(cache_.size());
+        stats.cacheHits = cacheHits_;
+        for (const PoolChain& chain : transient_) {
+            stats.transientPools += static_cast<uint32_t>(chain.pools.size());
+        }
+        stats.transientSets = transient_[currentFrame_].allocatedSets;
+        return stats;
+    }
+}
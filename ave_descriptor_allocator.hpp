@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ave_constants.h"
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace ave {
+
+    class AveDevice;
+
+    // One binding of a set, what a VkWriteDescriptorSet with a single descriptor would write
+    struct DescriptorBinding {
+        uint32_t binding;
+        VkDescriptorType type;
+        VkDescriptorBufferInfo buffer{};
+        VkDescriptorImageInfo image{};
+
+        static DescriptorBinding forBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+        static DescriptorBinding forImage(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler,
+            VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    };
+
+    struct DescriptorAllocatorStats {
+        uint32_t persistentPools;
+        uint32_t persistentSets; // distinct cached sets
+        uint32_t cacheHits;
+        uint32_t transientPools; // over all frame slots
+        uint32_t transientSets;  // allocated by the current frame so far
+    };
+
+    // Hands out descriptor sets without ever running a pool dry. Pools are created on demand and chained:
+    // when an allocation fails with VK_ERROR_OUT_OF_POOL_MEMORY (or a fragmented pool) a new pool, twice the
+    // size of the last up to MAX_SETS_PER_POOL, takes over. Sets are never freed one by one.
+    //
+    // Persistent sets live as long as the device and are cached by their layout and bindings: asking for a
+    // set that was built before returns it instead of allocating and writing again, so callers may ask every
+    // time they need one. Whatever they reference has to outlive the device's use of the set, and destroying a
+    // buffer or image view it references has to invalidate it, or a new resource that reuses the handle would
+    // get the stale set. AveDevice::destroyBuffer does that for buffers.
+    //
+    // Transient sets are for one frame, e.g. sets that point at a per frame copy of a stream. Each frame slot
+    // has its own pool chain, which beginFrame() resets with vkResetDescriptorPool once the slot's fence was
+    // waited on. A frame that needed more than one pool gets a single pool large enough for all of it next
+    // time, so a steady state frame resets one pool.
+    class AveDescriptorAllocator {
+        public:
+            static constexpr uint32_t INITIAL_SETS_PER_POOL = 64;
+            static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+            AveDescriptorAllocator(AveDevice& device);
+            ~AveDescriptorAllocator();
+
+            AveDescriptorAllocator(const AveDescriptorAllocator&) = delete;
+            AveDescriptorAllocator& operator=(const AveDescriptorAllocator&) = delete;
+
+            // Cached by layout and bindings, written on first use
+            VkDescriptorSet getPersistent(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings);
+
+            // Drops cached sets that reference the resource, call before destroying it. The sets themselves are
+            // only reclaimed with their pool.
+            void invalidateBuffer(VkBuffer buffer);
+            void invalidateImageView(VkImageView view);
+
+            // Written with bindings, valid until the current frame slot comes around again
+            VkDescriptorSet allocateTransient(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings);
+
+            // Call after the frame's in flight fence was waited on, resets that slot's transient pools
+            void beginFrame(uint32_t frameIndex);
+
+            DescriptorAllocatorStats getStats() const;
+
+        private:
+            // Chain of pools, allocations go to the last one
+            struct PoolChain {
+                std::vector<VkDescriptorPool> pools;
+                uint32_t setsPerPool = INITIAL_SETS_PER_POOL;
+                uint32_t allocatedSets = 0;
+            };
+
+            struct SetKey {
+                VkDescriptorSetLayout layout;
+                std::vector<DescriptorBinding> bindings;
+                bool operator==(const SetKey& other) const;
+            };
+            struct SetKeyHash {
+                size_t operator()(const SetKey& key) const;
+            };
+
+            VkDescriptorPool createPool(uint32_t maxSets);
+            VkDescriptorSet allocate(PoolChain& chain, VkDescriptorSetLayout layout);
+            void write(VkDescriptorSet set, const std::vector<DescriptorBinding>& bindings);
+            // Handles of cached bindings are counted in references_, so destroying an uncached resource costs a lookup
+            void invalidateHandle(uint64_t handle);
+
+            AveDevice& aveDevice;
+            PoolChain persistent_;
+            std::unordered_map<SetKey, VkDescriptorSet, SetKeyHash> cache_;
+            std::unordered_map<uint64_t, uint32_t> references_; // buffer or image view handle -> cached sets using it
+            uint32_t cacheHits_ = 0;
+
+            uint32_t currentFrame_ = 0;
+            std::array<PoolChain, MAX_FRAMES_IN_FLIGHT> transient_;
+    };
+}
@@ -29,13 +29,30 @@ namespace ave{
         createSurface();
         pickPhysicalDevice();
         createLogicalDevice();
+        allocator = std::make_unique<AveAllocator>(physicalDevice, device_);
+        residency = std::make_unique<AveResidency>(*this);
         createCommandPool();
-        createDescriptorPool();
+        stagingRing = std::make_unique<AveStagingRing>(*this);
+        uniformRing = std::make_unique<AveUniformRing>(*this);
+        uploadQueue = std::make_unique<AveUploadQueue>(*this, transferFamily_, transferQueue_, graphicsFamily_);
+        if (transferFamily_ != graphicsFamily_) {
+            std::cout << "uploads use dedicated transfer queue family " << transferFamily_ << std::endl;
+        }
+        geometryPool = std::make_unique<AveGeometryPool>(*this);
+        descriptorAllocator = std::make_unique<AveDescriptorAllocator>(*this);
+        bindlessTextures = std::make_unique<AveBindlessTextures>(*this);
     }
 
     AveDevice::~AveDevice(){
-        vkDestroyDescriptorPool(device_, descriptorPool, nullptr);
+        bindlessTextures.reset();
+        descriptorAllocator.reset();
+        geometryPool.reset();
+        uploadQueue.reset();
+        uniformRing.reset();
+        stagingRing.reset();
         vkDestroyCommandPool(device_, commandPool, nullptr);
+        residency.reset();
+        allocator.reset();
 
         vkDestroyDevice(device_, nullptr);
 
@@ -168,7 +185,7 @@ namespace ave{
         QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value(), indices.transferFamily.value()};
 
         // Get queues
         float queuePriority = 1.0f;
@@ -181,8 +198,17 @@ namespace ave{
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        // Block compressed textures are optional, cooked BC textures are only picked when this is on
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures{};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+        // GPU driven draws, AveGpuCulling needs first instance and falls back to one draw per call without multi draw
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+        enabledFeatures = deviceFeatures;
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -192,9 +218,31 @@ namespace ave{
 
         createInfo.pEnabledFeatures = &deviceFeatures;
 
+        // Everything the bindless texture table relies on, checked by isDeviceSuitable
+        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        indexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
+        indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+        indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE; // per instance materials
+        createInfo.pNext = &indexingFeatures;
+
         // Enable extensions
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        // VK_EXT_memory_budget is optional, without it AveResidency works against a configured limit
+        std::vector<const char*> enabledExtensions = deviceExtensions;
+        memoryBudget_ = physicalDeviceProperties2_ && hasDeviceExtension(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        if (memoryBudget_) {
+            enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+        // Optional too, without it culled draws stay in the indirect buffer with instanceCount 0
+        drawIndirectCount_ = hasDeviceExtension(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        if (drawIndirectCount_) {
+            enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        }
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         if (enableValidationLayers) {
             createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -213,6 +261,9 @@ namespace ave{
 
         vkGetDeviceQueue(device_, indices.graphicsFamily.value(), 0, &graphicsQueue_);
         vkGetDeviceQueue(device_, indices.presentFamily.value(), 0, &presentQueue_);
+        vkGetDeviceQueue(device_, indices.transferFamily.value(), 0, &transferQueue_);
+        graphicsFamily_ = indices.graphicsFamily.value();
+        transferFamily_ = indices.transferFamily.value();
     }
 
     void AveDevice::createCommandPool(){
@@ -239,28 +290,6 @@ namespace ave{
 
 
 
-    void AveDevice::createDescriptorPool(){
-
-
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-
-        if (vkCreateDescriptorPool(device_, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor pool!");
-        }
-    }
-
-
     bool AveDevice::checkValidationLayerSupport() {
         uint32_t layerCount;
         vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
@@ -313,6 +342,18 @@ namespace ave{
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
         }
 
+        // Needed to query descriptor indexing and VK_EXT_memory_budget on a 1.0 instance
+        uint32_t extensionCount = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+        for (const auto& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+                extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+                physicalDeviceProperties2_ = true;
+            }
+        }
+
         return extensions;
     }
 
@@ -336,7 +377,8 @@ namespace ave{
         VkPhysicalDeviceFeatures supportedFeatures;
         vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-        return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+        return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy
+            && checkDescriptorIndexingSupport(device);
 
     }
 
@@ -356,6 +398,40 @@ namespace ave{
         return requiredExtensions.empty();
     }
 
+    bool AveDevice::checkDescriptorIndexingSupport(VkPhysicalDevice device) {
+        if (!physicalDeviceProperties2_) {
+            return false;
+        }
+        auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(
+            vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+
+        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &indexingFeatures;
+        getFeatures2(device, &features);
+
+        return indexingFeatures.descriptorBindingSampledImageUpdateAfterBind && indexingFeatures.descriptorBindingUpdateUnusedWhilePending
+            && indexingFeatures.descriptorBindingPartiallyBound && indexingFeatures.descriptorBindingVariableDescriptorCount
+            && indexingFeatures.runtimeDescriptorArray && indexingFeatures.shaderSampledImageArrayNonUniformIndexing;
+    }
+
+    bool AveDevice::hasDeviceExtension(VkPhysicalDevice device, const char* extensionName) {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        for (const auto& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, extensionName) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     QueueFamilyIndices AveDevice::findQueueFamilies(VkPhysicalDevice device) {
         QueueFamilyIndices indices;
         // Logic to find queue family indices to populate struct with
@@ -388,6 +464,25 @@ namespace ave{
             i++;
         }
 
+        // Uploads prefer a transfer only family (the DMA engines on discrete GPUs), then any family without
+        // graphics, and share the graphics family when the device exposes neither
+        for (uint32_t family = 0; family < queueFamilyCount; family++) {
+            VkQueueFlags flags = queueFamilies[family].queueFlags;
+            if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+                continue;
+            }
+            if (!(flags & VK_QUEUE_COMPUTE_BIT)) {
+                indices.transferFamily = family;
+                break;
+            }
+            if (!indices.transferFamily.has_value()) {
+                indices.transferFamily = family;
+            }
+        }
+        if (!indices.transferFamily.has_value()) {
+            indices.transferFamily = indices.graphicsFamily;
+        }
+
         return indices;
     }
 
@@ -453,7 +548,7 @@ namespace ave{
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer &buffer,
-        VkDeviceMemory &bufferMemory) {
+        AveAllocation &bufferMemory) {
     VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
@@ -464,22 +559,29 @@ namespace ave{
             throw std::runtime_error("failed to create vertex buffer!");
         }
 
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate vertex buffer memory!");
+        try {
+            bufferMemory = allocator->allocateForBuffer(buffer, properties);
+        } catch (...) {
+            vkDestroyBuffer(device_, buffer, nullptr);
+            buffer = VK_NULL_HANDLE;
+            throw;
         }
+    }
 
-        vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+    void AveDevice::destroyBuffer(VkBuffer buffer, AveAllocation &bufferMemory) {
+        // Cached descriptor sets must not outlive the handle, a new buffer may get the same one
+        if (descriptorAllocator) {
+            descriptorAllocator->invalidateBuffer(buffer);
+        }
+        vkDestroyBuffer(device_, buffer, nullptr);
+        allocator->free(bufferMemory);
     }
 
     VkCommandBuffer AveDevice::beginSingleTimeCommands() {
+        if (uploadBatch != nullptr) {
+            return uploadBatch->getCommandBuffer();
+        }
+
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -498,6 +600,11 @@ namespace ave{
     }
 
     void AveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+        if (uploadBatch != nullptr) {
+            uploadBatch->endOperation();
+            return;
+        }
+
         vkEndCommandBuffer(commandBuffer);
 
         VkSubmitInfo submitInfo{};
@@ -505,8 +612,16 @@ namespace ave{
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffer;
 
-        vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphicsQueue_); // may instead use fences
+        // Wait for this submission only, frames already queued on the graphics queue keep running
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        VkFence fence;
+        if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create single time command fence!");
+        }
+        vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence);
+        vkWaitForFences(device_, 1, &fence, VK_TRUE, UINT64_MAX);
+        vkDestroyFence(device_, fence, nullptr);
 
         vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
     }
@@ -550,7 +665,7 @@ namespace ave{
         endSingleTimeCommands(commandBuffer);
     }
 
-    void AveDevice::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+    void AveDevice::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, AveAllocation& imageMemory) {
 
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -577,27 +692,24 @@ namespace ave{
         const VkImageCreateInfo &imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage &image,
-        VkDeviceMemory &imageMemory) {
+        AveAllocation &imageMemory) {
 
         if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
             throw std::runtime_error("failed to create image!");
         }
 
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(device_, image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory!");
+        try {
+            imageMemory = allocator->allocateForImage(image, imageInfo.tiling, properties);
+        } catch (...) {
+            vkDestroyImage(device_, image, nullptr);
+            image = VK_NULL_HANDLE;
+            throw;
         }
+    }
 
-        if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
-            throw std::runtime_error("failed to bind image memory!");
-        }
+    void AveDevice::destroyImage(VkImage image, AveAllocation &imageMemory) {
+        vkDestroyImage(device_, image, nullptr);
+        allocator->free(imageMemory);
     }
 
     VkSampleCountFlagBits AveDevice::getMaxUsableSampleCount() {
@@ -3,7 +3,16 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "ave_allocator.hpp"
+#include "ave_bindless_textures.hpp"
 #include "ave_constants.h"
+#include "ave_descriptor_allocator.hpp"
+#include "ave_geometry_pool.hpp"
+#include "ave_residency.hpp"
+#include "ave_staging_ring.hpp"
+#include "ave_uniform_ring.hpp"
+#include "ave_upload_batch.hpp"
+#include "ave_upload_queue.hpp"
 #include "ave_window.hpp"
 
 #include <array>
@@ -28,6 +37,7 @@ namespace ave {
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> transferFamily; // always set, equals graphicsFamily without a separate one
 
         bool isComplete() {
             return graphicsFamily.has_value() && presentFamily.has_value();
@@ -50,7 +60,9 @@ namespace ave {
         };
 
         const std::vector<const char*> deviceExtensions = {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME
+            VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+            VK_KHR_MAINTENANCE_3_EXTENSION_NAME,
+            VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME // bindless texture table, see AveBindlessTextures
         };
         public:
             int noop;
@@ -60,14 +72,29 @@ namespace ave {
             VkDebugUtilsMessengerEXT debugMessenger;
             VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
             VkCommandPool commandPool;
-            VkDescriptorPool descriptorPool;
 
             VkDevice device_; // logical device
             VkSurfaceKHR surface_;
             VkQueue graphicsQueue_;
             VkQueue presentQueue_;
+            VkQueue transferQueue_;
+            uint32_t graphicsFamily_;
+            uint32_t transferFamily_;
 
             VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+            VkPhysicalDeviceFeatures enabledFeatures{};
+            bool physicalDeviceProperties2_ = false; // VK_KHR_get_physical_device_properties2 on the instance
+            bool memoryBudget_ = false;              // VK_EXT_memory_budget on the device
+            bool drawIndirectCount_ = false;         // VK_KHR_draw_indirect_count on the device
+            std::unique_ptr<AveAllocator> allocator;
+            std::unique_ptr<AveResidency> residency;
+            std::unique_ptr<AveStagingRing> stagingRing;
+            std::unique_ptr<AveUniformRing> uniformRing;
+            std::unique_ptr<AveUploadQueue> uploadQueue;
+            std::unique_ptr<AveGeometryPool> geometryPool;
+            std::unique_ptr<AveDescriptorAllocator> descriptorAllocator;
+            std::unique_ptr<AveBindlessTextures> bindlessTextures;
+            AveUploadBatch* uploadBatch = nullptr;
 
         public:
             AveDevice(AveWindow& window);
@@ -79,13 +106,29 @@ namespace ave {
             AveDevice &operator=(AveDevice &&) = delete;
 
             VkCommandPool getCommandPool() { return commandPool; }
-            VkDescriptorPool getDescriptorPool() { return descriptorPool; }
             VkDevice device() { return device_; }
             VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
             VkSurfaceKHR surface() { return surface_; }
             VkQueue graphicsQueue() { return graphicsQueue_; }
             VkQueue presentQueue() { return presentQueue_; }
+            VkQueue transferQueue() { return transferQueue_; }
+            uint32_t getGraphicsQueueFamily() { return graphicsFamily_; }
             VkSampleCountFlagBits getMsaaSamples() { return msaaSamples; }
+            const VkPhysicalDeviceFeatures& getEnabledFeatures() { return enabledFeatures; }
+            VkInstance getInstance() { return instance; }
+            bool hasMemoryBudget() { return memoryBudget_; }
+            bool hasDrawIndirectCount() { return drawIndirectCount_; }
+            AveAllocator& getAllocator() { return *allocator; }
+            AveResidency& getResidency() { return *residency; }
+            AveStagingRing& getStagingRing() { return *stagingRing; }
+            AveUniformRing& getUniformRing() { return *uniformRing; }
+            AveUploadQueue& getUploadQueue() { return *uploadQueue; }
+            AveGeometryPool& getGeometryPool() { return *geometryPool; }
+            AveDescriptorAllocator& getDescriptorAllocator() { return *descriptorAllocator; }
+            AveBindlessTextures& getBindlessTextures() { return *bindlessTextures; }
+            // Open loading phase batch, single time commands are recorded into it instead of submitted (see AveUploadBatch)
+            AveUploadBatch* getUploadBatch() { return uploadBatch; }
+            void setUploadBatch(AveUploadBatch* batch) { uploadBatch = batch; }
 
 
             bool hasStencilComponent(VkFormat format) {
@@ -98,13 +141,14 @@ namespace ave {
             VkFormat findSupportedFormat(
                 const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
             VkFormat findDepthFormat();
-            // Buffer Helper Functions
+            // Buffer Helper Functions, memory comes from the allocator (host visible memory arrives mapped)
             void createBuffer(
                 VkDeviceSize size,
                 VkBufferUsageFlags usage,
                 VkMemoryPropertyFlags properties,
                 VkBuffer &buffer,
-                VkDeviceMemory &bufferMemory);
+                AveAllocation &bufferMemory);
+            void destroyBuffer(VkBuffer buffer, AveAllocation &bufferMemory);
             VkCommandBuffer beginSingleTimeCommands();
             void endSingleTimeCommands(VkCommandBuffer commandBuffer);
             void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -115,8 +159,9 @@ namespace ave {
                 const VkImageCreateInfo &imageInfo,
                 VkMemoryPropertyFlags properties,
                 VkImage &image,
-                VkDeviceMemory &imageMemory);
-            void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+                AveAllocation &imageMemory);
+            void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, AveAllocation& imageMemory);
+            void destroyImage(VkImage image, AveAllocation &imageMemory);
 
         private:
             void createInstance();
@@ -126,7 +171,6 @@ namespace ave {
             void createLogicalDevice();
             void createCommandPool();
             // void createDepthResources();
-            void createDescriptorPool();
 
             // helper functions
             VkSampleCountFlagBits getMaxUsableSampleCount();
@@ -135,6 +179,8 @@ namespace ave {
             std::vector<const char*> getRequiredExtensions();
             bool isDeviceSuitable(VkPhysicalDevice device);
             bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+            bool hasDeviceExtension(VkPhysicalDevice device, const char* extensionName);
+            bool checkDescriptorIndexingSupport(VkPhysicalDevice device);
             QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
             SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
@@ -0,0 +1,78 @@
+#include "ave_dynamic_vertex_buffer.hpp"
+#include "ave_device.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ave {
+
+    namespace {
+        // Keep copies apart by at least an atom so frames never share a cache line or flush range, also a
+        // multiple of every minStorageBufferOffsetAlignment
+        constexpr VkDeviceSize FRAME_ALIGNMENT = 256;
+    }
+
+    AveDynamicVertexBuffer::AveDynamicVertexBuffer(AveDevice& device, const void* vertices, uint32_t vertexCount, uint32_t stride,
+            VkBufferUsageFlags extraUsage) : aveDevice{device}, vertexCount_{vertexCount}, stride_{stride} {
+        VkDeviceSize size = VkDeviceSize{stride} * vertexCount;
+        frameStride_ = (size + FRAME_ALIGNMENT - 1) / FRAME_ALIGNMENT * FRAME_ALIGNMENT;
+        aveDevice.createBuffer(frameStride_ * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | extraUsage,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer_, memory_);
+        mapped_ = static_cast<unsigned char*>(memory_.mapped);
+
+        const unsigned char* bytes = static_cast<const unsigned char*>(vertices);
+        cpu_.assign(bytes, bytes + size);
+        for (int frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+            memcpy(mapped_ + frame * frameStride_, cpu_.data(), static_cast<size_t>(size));
+        }
+    }
+
+    AveDynamicVertexBuffer::~AveDynamicVertexBuffer() {
+        aveDevice.destroyBuffer(buffer_, memory_);
+    }
+
+    void AveDynamicVertexBuffer::markDirty(uint32_t firstVertex, uint32_t count) {
+        assert(uint64_t{firstVertex} + count <= vertexCount_ && "Dirty span outside the mesh");
+        if (count == 0) {
+            return;
+        }
+
+        for (std::vector<Span>& spans : dirty_) {
+            Span span{firstVertex, firstVertex + count};
+            // First span that ends at or after our start can merge with us, so can everything up to our end
+            auto first = std::lower_bound(spans.begin(), spans.end(), span.first,
+                [](const Span& existing, uint32_t value) { return existing.end < value; });
+            auto last = first;
+            while (last != spans.end() && last->first <= span.end) {
+                span.first = std::min(span.first, last->first);
+                span.end = std::max(span.end, last->end);
+                ++last;
+            }
+            first = spans.erase(first, last);
+            spans.insert(first, span);
+        }
+    }
+
+    void AveDynamicVertexBuffer::write(uint32_t firstVertex, const void* vertices, uint32_t count) {
+        memcpy(cpu_.data() + size_t{firstVertex} * stride_, vertices, size_t{count} * stride_);
+        markDirty(firstVertex, count);
+    }
+
+    VkDeviceSize AveDynamicVertexBuffer::flush(uint32_t frameIndex) {
+        VkDeviceSize copied = 0;
+        unsigned char* frame = mapped_ + frameIndex * frameStride_;
+        for (const Span& span : dirty_[frameIndex]) {
+            size_t offset = size_t{span.first} * stride_;
+            size_t size = size_t{span.end - span.first} * stride_;
+            memcpy(frame + offset, cpu_.data() + offset, size);
+            copied += size;
+        }
+        dirty_[frameIndex].clear();
+        return copied;
+    }
+
+    void AveDynamicVertexBuffer::bind(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t binding) {
+        VkDeviceSize offset = frameIndex * frameStride_;
+        vkCmdBindVertexBuffers(commandBuffer, binding, 1, &buffer_, &offset);
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "ave_allocator.hpp"
+#include "ave_constants.h"
+
+#include <array>
+#include <vector>
+
+namespace ave {
+
+    class AveDevice;
+
+    // Vertex buffer for meshes the CPU rewrites while they are drawn. The buffer holds one persistently
+    // mapped copy of the mesh per frame in flight and the vertex stage reads the current frame's copy
+    // straight from host visible memory, so updates need no transfer commands, barriers or waits.
+    //
+    // Writes go to a CPU side master copy and mark vertex spans dirty in every frame's copy. flush() brings
+    // one frame's copy up to date by copying only its dirty spans (overlapping and touching spans are merged),
+    // so an animation costs the bytes it changed, times once per frame in flight. Extra usage flags let the
+    // same per frame stream double as a storage buffer, e.g. instances read by a culling compute shader.
+    class AveDynamicVertexBuffer {
+        public:
+            AveDynamicVertexBuffer(AveDevice& device, const void* vertices, uint32_t vertexCount, uint32_t stride,
+                VkBufferUsageFlags extraUsage = 0);
+            ~AveDynamicVertexBuffer();
+
+            AveDynamicVertexBuffer(const AveDynamicVertexBuffer&) = delete;
+            AveDynamicVertexBuffer& operator=(const AveDynamicVertexBuffer&) = delete;
+
+            // Master copy, call markDirty for whatever is changed through it
+            void* data() { return cpu_.data(); }
+            void markDirty(uint32_t firstVertex, uint32_t count);
+            void write(uint32_t firstVertex, const void* vertices, uint32_t count);
+
+            // Call once the frame's in flight fence was waited on, returns the bytes copied
+            VkDeviceSize flush(uint32_t frameIndex);
+            void bind(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t binding = 0);
+
+            uint32_t getVertexCount() const { return vertexCount_; }
+            // For descriptor writes, a frame's copy spans stride * vertexCount bytes from its offset
+            VkBuffer getBuffer() const { return buffer_; }
+            VkDeviceSize getFrameOffset(uint32_t frameIndex) const { return frameIndex * frameStride_; }
+
+        private:
+            struct Span {
+                uint32_t first;
+                uint32_t end;
+            };
+
+            AveDevice& aveDevice;
+            VkBuffer buffer_;
+            AveAllocation memory_;
+            unsigned char* mapped_;
+            VkDeviceSize frameStride_; // byte distance between two frames' copies
+
+            uint32_t vertexCount_;
+            uint32_t stride_;
+            std::vector<unsigned char> cpu_;
+            std::array<std::vector<Span>, MAX_FRAMES_IN_FLIGHT> dirty_; // sorted, disjoint, not touching
+    };
+}
@@ -0,0 +1,18 @@
+#include "ave_frustum.hpp"
+
+namespace ave {
+
+    AveFrustum AveFrustum::fromMatrix(const glm::mat4& clip) {
+        auto row = [&](int r) { return glm::vec4{clip[0][r], clip[1][r], clip[2][r], clip[3][r]}; };
+        AveFrustum frustum{{
+            row(3) + row(0), row(3) - row(0),
+            row(3) + row(1), row(3) - row(1),
+            row(2),          row(3) - row(2),
+        }};
+        for (glm::vec4& plane : frustum.planes) {
+            float length = glm::length(glm::vec3{plane});
+            if (length > 0.0f) plane /= length;
+        }
+        return frustum;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+
+namespace ave {
+
+    // Six planes of a Vulkan clip matrix (depth [0, 1]), inside is where dot(plane.xyz, p) + plane.w >= 0.
+    // Normalized, so plane distances are in the units of whatever space the matrix maps from: pass a
+    // modelViewProj for object space planes, a viewProj for world space ones.
+    struct AveFrustum {
+        std::array<glm::vec4, 6> planes; // left, right, bottom, top, near, far
+
+        // Gribb/Hartmann plane extraction
+        static AveFrustum fromMatrix(const glm::mat4& clip);
+
+        bool intersectsSphere(const glm::vec3& center, float radius) const {
+            for (const glm::vec4& plane : planes) {
+                if (glm::dot(glm::vec3{plane}, center) + plane.w < -radius) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+}
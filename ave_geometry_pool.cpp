@@ -0,0 +1,316 @@
+#include "ave_geometry_pool.hpp"
+#include "ave_device.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ave {
+
+    namespace {
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        template<typename Range>
+        bool takeRange(std::vector<Range>& freeRanges, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+            size_t best = freeRanges.size();
+            VkDeviceSize bestWaste = ~VkDeviceSize{0};
+            for (size_t i = 0; i < freeRanges.size(); i++) {
+                VkDeviceSize aligned = alignUp(freeRanges[i].offset, alignment);
+                if (aligned + size > freeRanges[i].offset + freeRanges[i].size) {
+                    continue;
+                }
+                if (freeRanges[i].size - size < bestWaste) {
+                    bestWaste = freeRanges[i].size - size;
+                    best = i;
+                }
+            }
+            if (best == freeRanges.size()) {
+                return false;
+            }
+
+            Range range = freeRanges[best];
+            offset = alignUp(range.offset, alignment);
+            Range front{range.offset, offset - range.offset};
+            Range back{offset + size, range.offset + range.size - (offset + size)};
+            freeRanges.erase(freeRanges.begin() + best);
+            if (back.size > 0) freeRanges.insert(freeRanges.begin() + best, back);
+            if (front.size > 0) freeRanges.insert(freeRanges.begin() + best, front);
+            return true;
+        }
+
+        template<typename Range>
+        void giveRange(std::vector<Range>& freeRanges, VkDeviceSize offset, VkDeviceSize size) {
+            auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset,
+                [](const Range& range, VkDeviceSize value) { return range.offset < value; });
+            next = freeRanges.insert(next, {offset, size});
+            if (next + 1 != freeRanges.end() && next->offset + next->size == (next + 1)->offset) {
+                next->size += (next + 1)->size;
+                freeRanges.erase(next + 1);
+            }
+            if (next != freeRanges.begin() && (next - 1)->offset + (next - 1)->size == next->offset) {
+                (next - 1)->size += next->size;
+                freeRanges.erase(next);
+            }
+        }
+
+        // Free bytes that are not part of the free tail of the arena
+        template<typename Range>
+        VkDeviceSize holeBytes(const std::vector<Range>& freeRanges, VkDeviceSize capacity) {
+            VkDeviceSize holes = 0;
+            for (const Range& range : freeRanges) {
+                if (range.offset + range.size != capacity) {
+                    holes += range.size;
+                }
+            }
+            return holes;
+        }
+    }
+
+    AveGeometryPool::AveGeometryPool(AveDevice& device, VkDeviceSize vertexCapacity, VkDeviceSize indexCapacity) : aveDevice{device} {
+        createArena(vertexArena_, vertexCapacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        createArena(indexArena_, indexCapacity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+        vertexArena_.minimumCapacity = vertexCapacity;
+        indexArena_.minimumCapacity = indexCapacity;
+
+        InstanceData defaultInstance{};
+        UploadToken token;
+        defaultInstance_ = allocate(&defaultInstance, 1, sizeof(InstanceData), nullptr, 0, token);
+    }
+
+    AveGeometryPool::~AveGeometryPool() {
+        for (auto& frameBuffers : retiredBuffers_) {
+            for (auto& buffer : frameBuffers) {
+                aveDevice.destroyBuffer(buffer.first, buffer.second);
+            }
+        }
+        aveDevice.destroyBuffer(vertexArena_.buffer, vertexArena_.memory);
+        aveDevice.destroyBuffer(indexArena_.buffer, indexArena_.memory);
+    }
+
+    void AveGeometryPool::createArena(Arena& arena, VkDeviceSize capacity, VkBufferUsageFlags usage) {
+        arena.capacity = capacity;
+        arena.usage = usage;
+        aveDevice.createBuffer(capacity, usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, arena.buffer, arena.memory);
+        arena.freeRanges = {{0, capacity}};
+    }
+
+    GeometryHandle AveGeometryPool::allocate(const void* vertices, uint32_t vertexCount, uint32_t stride,
+            const uint32_t* indices, uint32_t indexCount, UploadToken& token) {
+        // reserve() may relocate an arena, which skips ranges of meshes that are not live yet. Growing can run
+        // out of device memory, in which case the pool is left as it was.
+        VkDeviceSize vertexSize = VkDeviceSize{stride} * vertexCount;
+        VkDeviceSize indexSize = sizeof(uint32_t) * VkDeviceSize{indexCount};
+        VkDeviceSize vertexOffset = vertexSize > 0 ? reserve(vertexArena_, true, vertexSize, stride) : 0;
+        VkDeviceSize indexOffset = 0;
+        try {
+            indexOffset = indexSize > 0 ? reserve(indexArena_, false, indexSize, sizeof(uint32_t)) : 0;
+        } catch (...) {
+            if (vertexSize > 0) giveRange(vertexArena_.freeRanges, vertexOffset, vertexSize);
+            throw;
+        }
+
+        GeometryHandle handle;
+        if (freeHandles_.empty()) {
+            handle = static_cast<GeometryHandle>(meshes_.size());
+            meshes_.emplace_back();
+        } else {
+            handle = freeHandles_.back();
+            freeHandles_.pop_back();
+        }
+
+        Mesh& mesh = meshes_[handle];
+        mesh.vertexOffset = vertexOffset;
+        mesh.vertexSize = vertexSize;
+        mesh.stride = stride;
+        mesh.indexOffset = indexOffset;
+        mesh.indexSize = indexSize;
+        mesh.state = MeshState::Live;
+
+        AveUploadQueue& uploadQueue = aveDevice.getUploadQueue();
+        token = uploadQueue.uploadBuffer(vertices, vertexSize, vertexArena_.buffer, vertexOffset,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+        token = std::max(token, uploadQueue.uploadBuffer(indices, indexSize, indexArena_.buffer, indexOffset,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT));
+        lastUploadToken_ = std::max(lastUploadToken_, token);
+        return handle;
+    }
+
+    VkDeviceSize AveGeometryPool::reserve(Arena& arena, bool vertices, VkDeviceSize size, VkDeviceSize alignment) {
+        VkDeviceSize offset;
+        if (takeRange(arena.freeRanges, size, alignment, offset)) {
+            return offset;
+        }
+
+        // Out of space: move everything into a buffer twice the size. Pending uploads still target the old
+        // buffer, so they have to land and be acquired before the copy.
+        VkDeviceSize used = 0;
+        for (const Mesh& mesh : meshes_) {
+            if (mesh.state == MeshState::Live) {
+                used += vertices ? mesh.vertexSize + mesh.stride : mesh.indexSize;
+            }
+        }
+        VkDeviceSize capacity = std::max(arena.capacity * 2, used + size + alignment);
+        AveUploadQueue& uploadQueue = aveDevice.getUploadQueue();
+        if (frameCommandBuffer_ != VK_NULL_HANDLE) {
+            // A one-off submit would run before the frame's acquire barriers and compaction copies, so the copy
+            // goes into the frame behind them. The old buffer is retired with this frame.
+            uploadQueue.wait(lastUploadToken_, frameCommandBuffer_);
+            relocate(arena, vertices, capacity, frameCommandBuffer_);
+        } else {
+            uploadQueue.wait(lastUploadToken_);
+            VkCommandBuffer commandBuffer = aveDevice.beginSingleTimeCommands();
+            try {
+                relocate(arena, vertices, capacity, commandBuffer);
+            } catch (...) {
+                aveDevice.endSingleTimeCommands(commandBuffer);
+                throw;
+            }
+            aveDevice.endSingleTimeCommands(commandBuffer);
+        }
+
+        if (!takeRange(arena.freeRanges, size, alignment, offset)) {
+            throw std::runtime_error("failed to grow geometry pool!");
+        }
+        return offset;
+    }
+
+    void AveGeometryPool::relocate(Arena& arena, bool vertices, VkDeviceSize capacity, VkCommandBuffer commandBuffer) {
+        // The new buffer comes first so running out of memory leaves the arena untouched
+        Arena fresh;
+        createArena(fresh, capacity, arena.usage);
+        fresh.minimumCapacity = arena.minimumCapacity;
+        Arena old = arena;
+        arena = fresh;
+
+        // Reads of the old buffer wait for uploads and per frame vertex updates that wrote it
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            1, &barrier, 0, nullptr, 0, nullptr);
+
+        std::vector<GeometryHandle> order;
+        for (GeometryHandle handle = 0; handle < meshes_.size(); handle++) {
+            Mesh& mesh = meshes_[handle];
+            if (mesh.state == MeshState::Live) {
+                order.push_back(handle);
+            } else if (vertices) {
+                mesh.vertexSize = 0; // dying ranges stay readable in the old buffer until it is destroyed
+            } else {
+                mesh.indexSize = 0;
+            }
+        }
+        std::sort(order.begin(), order.end(), [&](GeometryHandle a, GeometryHandle b) {
+            return vertices ? meshes_[a].vertexOffset < meshes_[b].vertexOffset : meshes_[a].indexOffset < meshes_[b].indexOffset;
+        });
+
+        std::vector<VkBufferCopy> regions;
+        VkDeviceSize top = 0;
+        for (GeometryHandle handle : order) {
+            Mesh& mesh = meshes_[handle];
+            VkDeviceSize& offset = vertices ? mesh.vertexOffset : mesh.indexOffset;
+            VkDeviceSize size = vertices ? mesh.vertexSize : mesh.indexSize;
+            VkDeviceSize packed = alignUp(top, vertices ? mesh.stride : sizeof(uint32_t));
+            if (size > 0) {
+                regions.push_back({offset, packed, size});
+            }
+            offset = packed;
+            top = packed + size;
+        }
+        if (!regions.empty()) {
+            vkCmdCopyBuffer(commandBuffer, old.buffer, arena.buffer, static_cast<uint32_t>(regions.size()), regions.data());
+        }
+        arena.freeRanges.clear();
+        if (top < capacity) {
+            arena.freeRanges.push_back({top, capacity - top});
+        }
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            1, &barrier, 0, nullptr, 0, nullptr);
+
+        retiredBuffers_[currentFrame_].emplace_back(old.buffer, old.memory);
+        relocations_++;
+    }
+
+    void AveGeometryPool::free(GeometryHandle handle) {
+        meshes_[handle].state = MeshState::Dying;
+        dyingMeshes_[currentFrame_].push_back(handle);
+    }
+
+    void AveGeometryPool::bind(VkCommandBuffer commandBuffer) {
+        static_assert(INSTANCE_BINDING == 1, "the default instance is bound right after the vertices");
+        VkBuffer buffers[] = {vertexArena_.buffer, vertexArena_.buffer};
+        VkDeviceSize offsets[] = {0, meshes_[defaultInstance_].vertexOffset};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, indexArena_.buffer, 0, VK_INDEX_TYPE_UINT32);
+    }
+
+    void AveGeometryPool::beginFrame(uint32_t frameIndex) {
+        for (auto& buffer : retiredBuffers_[frameIndex]) {
+            aveDevice.destroyBuffer(buffer.first, buffer.second);
+        }
+        retiredBuffers_[frameIndex].clear();
+
+        for (GeometryHandle handle : dyingMeshes_[frameIndex]) {
+            Mesh& mesh = meshes_[handle];
+            if (mesh.vertexSize > 0) giveRange(vertexArena_.freeRanges, mesh.vertexOffset, mesh.vertexSize);
+            if (mesh.indexSize > 0) giveRange(indexArena_.freeRanges, mesh.indexOffset, mesh.indexSize);
+            mesh = Mesh{};
+            freeHandles_.push_back(handle);
+        }
+        dyingMeshes_[frameIndex].clear();
+        currentFrame_ = frameIndex;
+    }
+
+    bool AveGeometryPool::needsCompaction() const {
+        return holeBytes(vertexArena_.freeRanges, vertexArena_.capacity) > vertexArena_.capacity * COMPACT_THRESHOLD
+            || holeBytes(indexArena_.freeRanges, indexArena_.capacity) > indexArena_.capacity * COMPACT_THRESHOLD
+            || compactedCapacity(vertexArena_, true) < vertexArena_.capacity
+            || compactedCapacity(indexArena_, false) < indexArena_.capacity;
+    }
+
+    bool AveGeometryPool::compact(VkCommandBuffer commandBuffer) {
+        if (!aveDevice.getUploadQueue().isComplete(lastUploadToken_)) {
+            return false;
+        }
+        relocate(vertexArena_, true, compactedCapacity(vertexArena_, true), commandBuffer);
+        relocate(indexArena_, false, compactedCapacity(indexArena_, false), commandBuffer);
+        return true;
+    }
+
+    VkDeviceSize AveGeometryPool::compactedCapacity(const Arena& arena, bool vertices) const {
+        // Packing pads each vertex range to its stride at most
+        VkDeviceSize packed = 0;
+        for (const Mesh& mesh : meshes_) {
+            if (mesh.state == MeshState::Live) {
+                packed += vertices ? mesh.vertexSize + mesh.stride : mesh.indexSize;
+            }
+        }
+        VkDeviceSize capacity = arena.capacity;
+        while (capacity / 2 >= arena.minimumCapacity && packed < capacity / 4) {
+            capacity /= 2;
+        }
+        return capacity;
+    }
+
+    GeometryPoolStats AveGeometryPool::getStats() const {
+        GeometryPoolStats stats{};
+        for (const Mesh& mesh : meshes_) {
+            if (mesh.state == MeshState::Live) {
+                stats.meshCount++;
+            }
+            stats.vertexBytesUsed += mesh.vertexSize;
+            stats.indexBytesUsed += mesh.indexSize;
+        }
+        stats.meshCount--; // the default instance
+        stats.vertexCapacity = vertexArena_.capacity;
+        stats.indexCapacity = indexArena_.capacity;
+        stats.relocations = relocations_;
+        return stats;
+    }
+}
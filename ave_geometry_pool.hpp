@@ -0,0 +1,129 @@
+#pragma once
+
+#include "ave_allocator.hpp"
+#include "ave_constants.h"
+#include "ave_upload_queue.hpp"
+#include "ave_vertex_layout.hpp"
+
+#include <array>
+#include <utility>
+#include <vector>
+
+namespace ave {
+
+    class AveDevice;
+
+    using GeometryHandle = uint32_t;
+
+    struct GeometryPoolStats {
+        uint32_t meshCount;
+        VkDeviceSize vertexBytesUsed;
+        VkDeviceSize vertexCapacity;
+        VkDeviceSize indexBytesUsed;
+        VkDeviceSize indexCapacity;
+        uint32_t relocations; // grows and compactions since startup
+    };
+
+    // One device local vertex buffer and one index buffer shared by every mesh, so a frame binds geometry
+    // once and draws address their mesh through firstIndex/vertexOffset. Each mesh gets a range in both
+    // arenas; vertex ranges are aligned to the mesh's stride so vertexOffset counts whole vertices even when
+    // vertex formats of different size share the buffer.
+    //
+    // Freed ranges are handed back once the frame slot that freed them comes around again (frames in flight
+    // may still read them). When an arena runs out of space it is reallocated at twice the size and the live
+    // ranges are copied over packed, compact() does the same to squeeze out holes, and halves an arena that grew
+    // while it is less than a quarter full (meshes evicted by AveResidency give their memory back that way). Both
+    // move ranges, so callers must look offsets up through their handle every time they record a draw.
+    class AveGeometryPool {
+        public:
+            static constexpr VkDeviceSize VERTEX_CAPACITY = 16 * 1024 * 1024;
+            static constexpr VkDeviceSize INDEX_CAPACITY = 8 * 1024 * 1024;
+            static constexpr float COMPACT_THRESHOLD = 0.25f; // share of an arena lost to holes before compacting
+
+            AveGeometryPool(AveDevice& device, VkDeviceSize vertexCapacity = VERTEX_CAPACITY, VkDeviceSize indexCapacity = INDEX_CAPACITY);
+            ~AveGeometryPool();
+
+            AveGeometryPool(const AveGeometryPool&) = delete;
+            AveGeometryPool& operator=(const AveGeometryPool&) = delete;
+
+            // Reserves both ranges and queues their upload, token completes when the data may be drawn.
+            // vertexCount may be 0 for meshes that keep their vertices elsewhere.
+            GeometryHandle allocate(const void* vertices, uint32_t vertexCount, uint32_t stride,
+                const uint32_t* indices, uint32_t indexCount, UploadToken& token);
+            void free(GeometryHandle handle);
+
+            int32_t getVertexOffset(GeometryHandle handle) const {
+                return static_cast<int32_t>(meshes_[handle].vertexOffset / meshes_[handle].stride);
+            }
+            uint32_t getFirstIndex(GeometryHandle handle) const {
+                return static_cast<uint32_t>(meshes_[handle].indexOffset / sizeof(uint32_t));
+            }
+            VkDeviceSize getVertexByteOffset(GeometryHandle handle) const { return meshes_[handle].vertexOffset; }
+            VkBuffer getVertexBuffer() const { return vertexArena_.buffer; }
+            VkBuffer getIndexBuffer() const { return indexArena_.buffer; }
+
+            // Vertices at binding 0, indices, and the default instance at INSTANCE_BINDING for models that are not instanced
+            void bind(VkCommandBuffer commandBuffer);
+
+            // Call after the frame's in flight fence was waited on, releases what that slot freed last time
+            void beginFrame(uint32_t frameIndex);
+            // While set, growing an arena records its copy into this frame command buffer, behind the upload queue's
+            // acquire barriers and any compaction already recorded there. Set it outside the render pass and reset
+            // it to VK_NULL_HANDLE before the render pass begins; without one growth submits and waits on its own,
+            // which is only safe between frames.
+            void setFrameCommandBuffer(VkCommandBuffer commandBuffer) { frameCommandBuffer_ = commandBuffer; }
+
+            bool needsCompaction() const;
+            // Records the packing copies into commandBuffer (outside a render pass), false while uploads are pending
+            bool compact(VkCommandBuffer commandBuffer);
+
+            GeometryPoolStats getStats() const;
+
+        private:
+            struct Range {
+                VkDeviceSize offset;
+                VkDeviceSize size;
+            };
+
+            struct Arena {
+                VkBuffer buffer = VK_NULL_HANDLE;
+                AveAllocation memory;
+                VkDeviceSize capacity = 0;
+                VkBufferUsageFlags usage = 0;
+                VkDeviceSize minimumCapacity = 0; // created with, compaction never shrinks below
+                std::vector<Range> freeRanges; // sorted by offset, never adjacent
+            };
+
+            enum class MeshState { Live, Dying, Free };
+
+            struct Mesh {
+                VkDeviceSize vertexOffset = 0;
+                VkDeviceSize vertexSize = 0; // 0 once a relocation dropped the range of a dying mesh
+                uint32_t stride = 1;
+                VkDeviceSize indexOffset = 0;
+                VkDeviceSize indexSize = 0;
+                MeshState state = MeshState::Free;
+            };
+
+            void createArena(Arena& arena, VkDeviceSize capacity, VkBufferUsageFlags usage);
+            // Copies every live range of the arena into a new buffer of the given capacity, packed from the start
+            void relocate(Arena& arena, bool vertices, VkDeviceSize capacity, VkCommandBuffer commandBuffer);
+            VkDeviceSize reserve(Arena& arena, bool vertices, VkDeviceSize size, VkDeviceSize alignment);
+            VkDeviceSize compactedCapacity(const Arena& arena, bool vertices) const;
+
+            AveDevice& aveDevice;
+            Arena vertexArena_;
+            Arena indexArena_;
+
+            std::vector<Mesh> meshes_;
+            std::vector<GeometryHandle> freeHandles_;
+            GeometryHandle defaultInstance_; // one InstanceData{}, queued before any mesh so it lands first
+            UploadToken lastUploadToken_ = 0;
+            uint32_t relocations_ = 0;
+
+            uint32_t currentFrame_ = 0;
+            VkCommandBuffer frameCommandBuffer_ = VK_NULL_HANDLE;
+            std::array<std::vector<GeometryHandle>, MAX_FRAMES_IN_FLIGHT> dyingMeshes_;
+            std::array<std::vector<std::pair<VkBuffer, AveAllocation>>, MAX_FRAMES_IN_FLIGHT> retiredBuffers_;
+    };
+}
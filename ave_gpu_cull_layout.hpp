@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ave_frustum.hpp"
+#include "ave_vertex_layout.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace ave {
+
+    // What cull.comp reads and writes, shared by AveGpuCulling and the headless check in bench/bench_gpu_cull
+
+    static constexpr uint32_t CULL_OBJECT_EMPTY = UINT32_MAX; // mesh of a removed object, never drawn
+
+    // std430 mirror of cull.comp's Mesh
+    struct GpuCullMesh {
+        uint32_t firstIndex; // absolute, into the geometry pool's index buffer
+        uint32_t indexCount;
+        int32_t vertexOffset;
+        uint32_t padding;
+        glm::vec4 boundingSphere; // xyz center, w radius, in the space instance transforms map from
+    };
+    static_assert(sizeof(GpuCullMesh) == 32, "GpuCullMesh must match the std430 layout of cull.comp");
+
+    // Push constants of cull.comp
+    struct GpuCullPushConstants {
+        glm::vec4 planes[6]; // world space, see AveFrustum
+        uint32_t objectCount;
+        uint32_t compact; // 1: visible draws are packed and counted, 0: draw i is object i, culled ones have instanceCount 0
+    };
+
+    // Output buffer of cull.comp: draw count at 0, commands from here on
+    static constexpr VkDeviceSize GPU_CULL_COMMAND_OFFSET = 16;
+
+    // What cull.comp writes in compact mode, in object order (the GPU's order is arbitrary)
+    inline void cullReference(const GpuCullMesh* meshes, const uint32_t* objectMeshes, const InstanceData* instances,
+            uint32_t objectCount, const AveFrustum& frustum, std::vector<VkDrawIndexedIndirectCommand>& commands) {
+        commands.clear();
+        for (uint32_t object = 0; object < objectCount; object++) {
+            if (objectMeshes[object] == CULL_OBJECT_EMPTY) {
+                continue;
+            }
+
+            // World space sphere, the radius grows with the transform's largest axis scale
+            const GpuCullMesh& mesh = meshes[objectMeshes[object]];
+            const glm::mat4& transform = instances[object].transform;
+            glm::vec3 center = glm::vec3{transform * glm::vec4{glm::vec3{mesh.boundingSphere}, 1.0f}};
+            float scale = std::max({glm::length(glm::vec3{transform[0]}), glm::length(glm::vec3{transform[1]}),
+                glm::length(glm::vec3{transform[2]})});
+            if (!frustum.intersectsSphere(center, mesh.boundingSphere.w * scale)) {
+                continue;
+            }
+
+            VkDrawIndexedIndirectCommand command{};
+            command.indexCount = mesh.indexCount;
+            command.instanceCount = 1;
+            command.firstIndex = mesh.firstIndex;
+            command.vertexOffset = mesh.vertexOffset;
+            command.firstInstance = object;
+            commands.push_back(command);
+        }
+    }
+}
@@ -0,0 +1,266 @@
+#include "ave_gpu_culling.hpp"
+#include "ave_descriptor_allocator.hpp"
+#include "ave_geometry_pool.hpp"
+#include "ave_model.hpp"
+#include "ave_uniform_ring.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace ave {
+
+    namespace {
+        constexpr uint32_t BINDING_MESHES = 0;
+        constexpr uint32_t BINDING_OBJECT_MESHES = 1;
+        constexpr uint32_t BINDING_INSTANCES = 2;
+        constexpr uint32_t BINDING_OUTPUT = 3;
+
+        constexpr VkDeviceSize COMMAND_SIZE = sizeof(VkDrawIndexedIndirectCommand);
+    }
+
+    AveGpuCulling::AveGpuCulling(AveDevice& device, AvePipelineCache& pipelineCache, VertexFormat format, uint32_t maxObjects)
+            : aveDevice{device}, format_{format}, maxObjects_{maxObjects} {
+        if (!isSupported(aveDevice)) {
+            throw std::runtime_error("failed to create gpu culling, drawIndirectFirstInstance is not supported!");
+        }
+
+        compact_ = aveDevice.hasDrawIndirectCount();
+        if (compact_) {
+            drawIndexedIndirectCount_ = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(
+                vkGetDeviceProcAddr(aveDevice.device(), "vkCmdDrawIndexedIndirectCountKHR"));
+            compact_ = drawIndexedIndirectCount_ != nullptr;
+        }
+
+        // Empty objects until added, a zero sized stream would be a zero sized buffer
+        std::vector<GpuCullMesh> meshes(MAX_MESHES, GpuCullMesh{});
+        std::vector<uint32_t> objectMeshes(maxObjects_, CULL_OBJECT_EMPTY);
+        std::vector<InstanceData> instances(maxObjects_);
+        meshStream_ = std::make_unique<AveDynamicVertexBuffer>(aveDevice, meshes.data(), MAX_MESHES,
+            static_cast<uint32_t>(sizeof(GpuCullMesh)), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        objectMeshStream_ = std::make_unique<AveDynamicVertexBuffer>(aveDevice, objectMeshes.data(), maxObjects_,
+            static_cast<uint32_t>(sizeof(uint32_t)), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        instanceStream_ = std::make_unique<AveDynamicVertexBuffer>(aveDevice, instances.data(), maxObjects_,
+            static_cast<uint32_t>(sizeof(InstanceData)), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+        for (int frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+            aveDevice.createBuffer(GPU_CULL_COMMAND_OFFSET + COMMAND_SIZE * maxObjects_,
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indirectBuffers_[frame], indirectMemory_[frame]);
+        }
+
+        createPipeline(pipelineCache);
+        std::cout << "gpu culling: " << maxObjects_ << " objects, " << (compact_ ? "compacted with draw count" : "uncompacted") << std::endl;
+    }
+
+    AveGpuCulling::~AveGpuCulling() {
+        for (int frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+            aveDevice.destroyBuffer(indirectBuffers_[frame], indirectMemory_[frame]);
+        }
+        vkDestroyPipeline(aveDevice.device(), pipeline_, nullptr);
+        vkDestroyPipelineLayout(aveDevice.device(), pipelineLayout_, nullptr);
+        vkDestroyDescriptorSetLayout(aveDevice.device(), setLayout_, nullptr);
+    }
+
+    void AveGpuCulling::createPipeline(AvePipelineCache& pipelineCache) {
+        std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+        for (uint32_t i = 0; i < bindings.size(); i++) {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+        if (vkCreateDescriptorSetLayout(aveDevice.device(), &layoutInfo, nullptr, &setLayout_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create culling descriptor set layout!");
+        }
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(GpuCullPushConstants);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &setLayout_;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        if (vkCreatePipelineLayout(aveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create culling pipeline layout!");
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = pipelineCache.getShaderModule("shaders/cull.comp.spv");
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = pipelineLayout_;
+        if (vkCreateComputePipelines(aveDevice.device(), pipelineCache.getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create culling pipeline!");
+        }
+    }
+
+    CullMeshId AveGpuCulling::addMesh(GeometryHandle geometry, uint32_t firstIndex, uint32_t indexCount, const glm::vec3& center, float radius) {
+        if (meshes_.size() >= MAX_MESHES) {
+            throw std::runtime_error("failed to add culling mesh, out of mesh slots!");
+        }
+
+        CullMeshId id = static_cast<CullMeshId>(meshes_.size());
+        meshes_.push_back({geometry, firstIndex, indexCount});
+
+        // Offsets are filled in by beginFrame, like every time the pool moves the geometry
+        GpuCullMesh mesh{};
+        mesh.indexCount = indexCount;
+        mesh.boundingSphere = glm::vec4{center, radius};
+        gpuMeshes_.push_back(mesh);
+        meshStream_->write(id, &mesh, 1);
+        return id;
+    }
+
+    CullObjectId AveGpuCulling::addObject(CullMeshId mesh, const InstanceData& instance) {
+        assert(mesh < meshes_.size() && "Unknown culling mesh");
+
+        CullObjectId object;
+        if (!freeObjects_.empty()) {
+            object = freeObjects_.back();
+            freeObjects_.pop_back();
+        } else {
+            if (objectCount_ >= maxObjects_) {
+                throw std::runtime_error("failed to add culling object, out of object slots!");
+            }
+            object = objectCount_++;
+        }
+
+        objectMeshStream_->write(object, &mesh, 1);
+        instanceStream_->write(object, &instance, 1);
+        return object;
+    }
+
+    void AveGpuCulling::setInstance(CullObjectId object, const InstanceData& instance) {
+        assert(object < objectCount_ && "Unknown culling object");
+        instanceStream_->write(object, &instance, 1);
+    }
+
+    void AveGpuCulling::setTransform(CullObjectId object, const glm::mat4& transform) {
+        assert(object < objectCount_ && "Unknown culling object");
+        static_cast<InstanceData*>(instanceStream_->data())[object].transform = transform;
+        instanceStream_->markDirty(object, 1);
+    }
+
+    void AveGpuCulling::removeObject(CullObjectId object) {
+        assert(object < objectCount_ && "Unknown culling object");
+        objectMeshStream_->write(object, &CULL_OBJECT_EMPTY, 1);
+        freeObjects_.push_back(object);
+    }
+
+    void AveGpuCulling::beginFrame(uint32_t frameIndex) {
+        currentFrame_ = frameIndex;
+
+        // Compaction and growth move geometry, so offsets are looked up again each frame and written when they changed
+        AveGeometryPool& geometryPool = aveDevice.getGeometryPool();
+        for (size_t i = 0; i < meshes_.size(); i++) {
+            GpuCullMesh& mesh = gpuMeshes_[i];
+            uint32_t firstIndex = geometryPool.getFirstIndex(meshes_[i].geometry) + meshes_[i].firstIndex;
+            int32_t vertexOffset = geometryPool.getVertexOffset(meshes_[i].geometry);
+            if (mesh.firstIndex != firstIndex || mesh.vertexOffset != vertexOffset) {
+                mesh.firstIndex = firstIndex;
+                mesh.vertexOffset = vertexOffset;
+                meshStream_->write(static_cast<uint32_t>(i), &mesh, 1);
+            }
+        }
+
+        meshStream_->flush(frameIndex);
+        objectMeshStream_->flush(frameIndex);
+        instanceStream_->flush(frameIndex);
+    }
+
+    void AveGpuCulling::cull(VkCommandBuffer commandBuffer, const glm::mat4& view, const glm::mat4& proj) {
+        // Instance transforms already place objects in the world
+        UniformBufferObject ubo{};
+        ubo.model = glm::mat4{1.0f};
+        ubo.view = view;
+        ubo.proj = proj;
+        uniformOffset_ = aveDevice.getUniformRing().push(ubo);
+
+        culledObjectCount_ = objectCount_;
+        if (culledObjectCount_ == 0) {
+            return;
+        }
+
+        VkBuffer output = indirectBuffers_[currentFrame_];
+        // Points at this frame's copy of the streams, a set for the frame rather than one cached per slot
+        VkDescriptorSet descriptorSet = aveDevice.getDescriptorAllocator().allocateTransient(setLayout_, {
+            DescriptorBinding::forBuffer(BINDING_MESHES, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshStream_->getBuffer(),
+                meshStream_->getFrameOffset(currentFrame_), sizeof(GpuCullMesh) * MAX_MESHES),
+            DescriptorBinding::forBuffer(BINDING_OBJECT_MESHES, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, objectMeshStream_->getBuffer(),
+                objectMeshStream_->getFrameOffset(currentFrame_), sizeof(uint32_t) * maxObjects_),
+            DescriptorBinding::forBuffer(BINDING_INSTANCES, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, instanceStream_->getBuffer(),
+                instanceStream_->getFrameOffset(currentFrame_), sizeof(InstanceData) * maxObjects_),
+            DescriptorBinding::forBuffer(BINDING_OUTPUT, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, output, 0, VK_WHOLE_SIZE),
+        });
+
+        // The shader counts visible draws with atomics, start from zero
+        vkCmdFillBuffer(commandBuffer, output, 0, sizeof(uint32_t), 0);
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = output;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            0, nullptr, 1, &barrier, 0, nullptr);
+
+        GpuCullPushConstants constants{};
+        AveFrustum frustum = AveFrustum::fromMatrix(proj * view);
+        std::copy(frustum.planes.begin(), frustum.planes.end(), constants.planes);
+        constants.objectCount = culledObjectCount_;
+        constants.compact = compact_ ? 1 : 0;
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_, 0, 1, &descriptorSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(commandBuffer, (culledObjectCount_ + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+            0, nullptr, 1, &barrier, 0, nullptr);
+    }
+
+    void AveGpuCulling::draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkDescriptorSet uniformSet) {
+        if (culledObjectCount_ == 0) {
+            return;
+        }
+
+        VkBuffer output = indirectBuffers_[currentFrame_];
+        instanceStream_->bind(commandBuffer, currentFrame_, INSTANCE_BINDING);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &uniformSet, 1, &uniformOffset_);
+
+        if (compact_) {
+            drawIndexedIndirectCount_(commandBuffer, output, GPU_CULL_COMMAND_OFFSET, output, 0, culledObjectCount_,
+                static_cast<uint32_t>(COMMAND_SIZE));
+        } else if (aveDevice.getEnabledFeatures().multiDrawIndirect) {
+            vkCmdDrawIndexedIndirect(commandBuffer, output, GPU_CULL_COMMAND_OFFSET, culledObjectCount_, static_cast<uint32_t>(COMMAND_SIZE));
+        } else {
+            // One call per object without multiDrawIndirect, culled ones draw 0 instances
+            for (uint32_t i = 0; i < culledObjectCount_; i++) {
+                vkCmdDrawIndexedIndirect(commandBuffer, output, GPU_CULL_COMMAND_OFFSET + i * COMMAND_SIZE, 1,
+                    static_cast<uint32_t>(COMMAND_SIZE));
+            }
+        }
+
+        // Back to the default instance for models drawn after us
+        aveDevice.getGeometryPool().bind(commandBuffer);
+    }
+}
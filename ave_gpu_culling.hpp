@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ave_device.hpp"
+#include "ave_dynamic_vertex_buffer.hpp"
+#include "ave_gpu_cull_layout.hpp"
+#include "ave_pipeline_cache.hpp"
+#include "ave_vertex_layout.hpp"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace ave {
+
+    using CullMeshId = uint32_t;
+    using CullObjectId = uint32_t;
+
+    // GPU driven culling for large numbers of static objects. Every object is a mesh from the geometry pool
+    // plus an InstanceData (the instance stream the vertex shaders already read). Each frame a compute pass
+    // tests every object's bounding sphere against the frustum and writes a VkDrawIndexedIndirectCommand for
+    // each visible one, with firstInstance pointing at the object's instance, so the whole set costs one
+    // dispatch and one indirect draw on the CPU however many objects there are.
+    //
+    // With VK_KHR_draw_indirect_count the visible draws are compacted and counted on the GPU and drawn with
+    // vkCmdDrawIndexedIndirectCount. Without it draw i belongs to object i and culled objects draw 0 instances.
+    // Needs drawIndirectFirstInstance, see isSupported. Objects, their meshes and instances live in per frame
+    // mapped streams, so changing them costs the bytes changed. All meshes must share one VertexFormat.
+    class AveGpuCulling {
+        public:
+            static constexpr uint32_t MAX_OBJECTS = 65536;
+            static constexpr uint32_t MAX_MESHES = 1024;
+            static constexpr uint32_t WORKGROUP_SIZE = 64; // local_size_x of cull.comp
+
+            static bool isSupported(AveDevice& device) { return device.getEnabledFeatures().drawIndirectFirstInstance; }
+
+            AveGpuCulling(AveDevice& device, AvePipelineCache& pipelineCache, VertexFormat format, uint32_t maxObjects = MAX_OBJECTS);
+            ~AveGpuCulling();
+
+            AveGpuCulling(const AveGpuCulling&) = delete;
+            AveGpuCulling& operator=(const AveGpuCulling&) = delete;
+
+            // Index range relative to the geometry's allocation (like MeshLod), looked up again whenever the pool moves it
+            CullMeshId addMesh(GeometryHandle geometry, uint32_t firstIndex, uint32_t indexCount, const glm::vec3& center, float radius);
+            CullObjectId addObject(CullMeshId mesh, const InstanceData& instance);
+            void setInstance(CullObjectId object, const InstanceData& instance);
+            // Keeps color and material, e.g. for objects that follow an AveScene entity
+            void setTransform(CullObjectId object, const glm::mat4& transform);
+            void removeObject(CullObjectId object);
+
+            // Call once the frame's in flight fence was waited on, after the geometry pool's compaction
+            void beginFrame(uint32_t frameIndex);
+            // Outside the render pass. Pushes the objects' uniforms (identity model) and records the culling dispatch.
+            void cull(VkCommandBuffer commandBuffer, const glm::mat4& view, const glm::mat4& proj);
+            // Inside the render pass, with the format's pipeline bound and the material push constants set.
+            // uniformSet is set 0 of pipelineLayout, bound here with the offset of cull()'s uniforms.
+            void draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkDescriptorSet uniformSet);
+
+            VertexFormat getVertexFormat() const { return format_; }
+            uint32_t getObjectCount() const { return objectCount_ - static_cast<uint32_t>(freeObjects_.size()); }
+
+        private:
+            struct Mesh {
+                GeometryHandle geometry;
+                uint32_t firstIndex;
+                uint32_t indexCount;
+            };
+
+            void createPipeline(AvePipelineCache& pipelineCache);
+
+            AveDevice& aveDevice;
+            VertexFormat format_;
+            uint32_t maxObjects_;
+            bool compact_;
+            PFN_vkCmdDrawIndexedIndirectCount drawIndexedIndirectCount_ = nullptr;
+
+            VkDescriptorSetLayout setLayout_;
+            VkPipelineLayout pipelineLayout_;
+            VkPipeline pipeline_;
+
+            std::vector<Mesh> meshes_;
+            std::vector<GpuCullMesh> gpuMeshes_; // as last written, to write only what the pool moved
+            std::unique_ptr<AveDynamicVertexBuffer> meshStream_;
+            std::unique_ptr<AveDynamicVertexBuffer> objectMeshStream_; // CullMeshId per object
+            std::unique_ptr<AveDynamicVertexBuffer> instanceStream_;   // InstanceData per object, also the vertex stream
+            uint32_t objectCount_ = 0; // high water mark, objects past it are never dispatched
+            std::vector<CullObjectId> freeObjects_;
+
+            std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> indirectBuffers_;
+            std::array<AveAllocation, MAX_FRAMES_IN_FLIGHT> indirectMemory_;
+            uint32_t currentFrame_ = 0;
+            uint32_t uniformOffset_ = 0;
+            uint32_t culledObjectCount_ = 0; // objects the last cull() dispatched
+    };
+}
@@ -0,0 +1,48 @@
+#include "ave_mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace ave {
+    AveMappedFile::AveMappedFile(const std::string& filePath) {
+        int fd = open(filePath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("failed to open file: " + filePath);
+        }
+
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("failed to stat file: " + filePath);
+        }
+
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("failed to map file: " + filePath);
+            }
+            // Readers touch every page once, let the kernel start reading ahead now
+            madvise(mapped, size_, MADV_WILLNEED);
+            data_ = static_cast<const char*>(mapped);
+        }
+
+        close(fd); // the mapping keeps its own reference
+    }
+
+    AveMappedFile::~AveMappedFile() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    bool AveMappedFile::exists(const std::string& filePath) {
+        struct stat st{};
+        return stat(filePath.c_str(), &st) == 0;
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace ave {
+    // Read-only memory mapping of a whole file. The mapping lives as long as the object.
+    class AveMappedFile {
+        public:
+            AveMappedFile(const std::string& filePath);
+            ~AveMappedFile();
+
+            AveMappedFile(const AveMappedFile&) = delete;
+            AveMappedFile& operator=(const AveMappedFile&) = delete;
+
+            const char* data() const { return data_; }
+            size_t size() const { return size_; }
+
+            static bool exists(const std::string& filePath);
+
+        private:
+            const char* data_ = nullptr;
+            size_t size_ = 0;
+    };
+}
@@ -0,0 +1,183 @@
+#include "ave_mesh_file.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace ave {
+    namespace {
+        uint64_t alignUp(uint64_t value, uint64_t alignment) {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        void computeBounds(const std::vector<Vertex>& vertices, const u_int32_t* indices, uint32_t indexCount, float boundsMin[3], float boundsMax[3]) {
+            glm::vec3 lo{std::numeric_limits<float>::max()};
+            glm::vec3 hi{std::numeric_limits<float>::lowest()};
+            for (uint32_t i = 0; i < indexCount; i++) {
+                lo = glm::min(lo, vertices[indices[i]].pos);
+                hi = glm::max(hi, vertices[indices[i]].pos);
+            }
+            if (indexCount == 0) {
+                lo = hi = glm::vec3{0.0f};
+            }
+            for (int axis = 0; axis < 3; axis++) {
+                boundsMin[axis] = lo[axis];
+                boundsMax[axis] = hi[axis];
+            }
+        }
+    }
+
+    AveMeshFile::AveMeshFile(const std::string& filePath) : file_{filePath} {
+        if (file_.size() < sizeof(AveMeshHeader)) {
+            throw std::runtime_error("avemesh file is truncated: " + filePath);
+        }
+
+        header_ = reinterpret_cast<const AveMeshHeader*>(file_.data());
+
+        if (header_->magic != AVEMESH_MAGIC) {
+            throw std::runtime_error("not an avemesh file: " + filePath);
+        }
+        if (header_->version != AVEMESH_VERSION) {
+            throw std::runtime_error("avemesh version mismatch, re-run the cooker: " + filePath);
+        }
+        if (header_->vertexFormat >= VERTEX_FORMAT_COUNT || header_->vertexStride != getVertexLayout(vertexFormat()).stride()) {
+            throw std::runtime_error("avemesh vertex layout mismatch, re-run the cooker: " + filePath);
+        }
+
+        uint64_t vertexEnd = header_->vertexDataOffset + uint64_t{header_->vertexCount} * header_->vertexStride;
+        uint64_t indexEnd = header_->indexDataOffset + uint64_t{header_->indexCount} * sizeof(u_int32_t);
+        uint64_t submeshEnd = header_->submeshDataOffset + uint64_t{header_->submeshCount} * sizeof(AveMeshSubmesh);
+        uint64_t lodEnd = header_->lodDataOffset + uint64_t{header_->lodCount} * sizeof(MeshLod);
+        uint64_t meshletEnd = header_->meshletDataOffset + uint64_t{header_->meshletCount} * sizeof(Meshlet);
+        if (header_->fileSize != file_.size() || vertexEnd > file_.size() || indexEnd > file_.size() || submeshEnd > file_.size()
+                || lodEnd > file_.size() || meshletEnd > file_.size()) {
+            throw std::runtime_error("avemesh file is truncated: " + filePath);
+        }
+        if (header_->lodCount == 0) {
+            throw std::runtime_error("avemesh file has no levels of detail: " + filePath);
+        }
+        for (uint32_t i = 0; i < header_->lodCount; i++) {
+            if (uint64_t{lods()[i].firstIndex} + lods()[i].indexCount > header_->indexCount
+                    || uint64_t{lods()[i].firstMeshlet} + lods()[i].meshletCount > header_->meshletCount) {
+                throw std::runtime_error("avemesh lod range is out of bounds: " + filePath);
+            }
+        }
+        for (uint32_t i = 0; i < header_->submeshCount; i++) {
+            if (uint64_t{submeshes()[i].firstIndex} + submeshes()[i].indexCount > header_->indexCount) {
+                throw std::runtime_error("avemesh submesh range is out of bounds: " + filePath);
+            }
+        }
+        for (uint32_t i = 0; i < header_->meshletCount; i++) {
+            if (uint64_t{meshlets()[i].firstIndex} + uint64_t{meshlets()[i].triangleCount} * 3 > header_->indexCount) {
+                throw std::runtime_error("avemesh meshlet range is out of bounds: " + filePath);
+            }
+        }
+
+        // The GPU would read past the mesh's vertex range, into other meshes of the geometry pool or past its end
+        const u_int32_t* indexData = indices();
+        uint32_t maxIndex = 0;
+        for (uint32_t i = 0; i < header_->indexCount; i++) {
+            maxIndex = std::max(maxIndex, indexData[i]);
+        }
+        if (header_->indexCount > 0 && maxIndex >= header_->vertexCount) {
+            throw std::runtime_error("avemesh index is out of bounds: " + filePath);
+        }
+    }
+
+    glm::mat4 AveMeshFile::dequantMatrix() const {
+        glm::vec3 offset{header_->dequantOffset[0], header_->dequantOffset[1], header_->dequantOffset[2]};
+        return glm::scale(glm::translate(glm::mat4{1.0f}, offset), glm::vec3{header_->dequantScale});
+    }
+
+    void AveMeshFile::write(
+        const std::string& filePath,
+        const std::vector<Vertex>& vertices,
+        const std::vector<u_int32_t>& indices,
+        const std::vector<AveMeshSubmesh>& submeshes,
+        const std::vector<MeshLod>& lods,
+        const std::vector<Meshlet>& meshlets,
+        VertexFormat format) {
+        const void* vertexData = vertices.data();
+        std::vector<PackedVertex> packed;
+        glm::mat4 dequant{1.0f};
+        if (format == VertexFormat::Packed) {
+            if (!canPackVertices(vertices.data(), vertices.size())) {
+                throw std::runtime_error("mesh cannot be packed, uvs or colors outside [0, 1]: " + filePath);
+            }
+            dequant = packVertices(vertices.data(), vertices.size(), packed);
+            vertexData = packed.data();
+        }
+        const uint32_t stride = getVertexLayout(format).stride();
+
+        AveMeshHeader header{};
+        header.magic = AVEMESH_MAGIC;
+        header.version = AVEMESH_VERSION;
+        header.vertexFormat = static_cast<uint32_t>(format);
+        header.vertexStride = stride;
+        header.vertexCount = static_cast<uint32_t>(vertices.size());
+        header.indexCount = static_cast<uint32_t>(indices.size());
+        header.submeshCount = static_cast<uint32_t>(submeshes.size());
+
+        if (std::any_of(indices.begin(), indices.end(), [&](u_int32_t index) { return index >= vertices.size(); })) {
+            throw std::runtime_error("avemesh index is out of bounds!");
+        }
+
+        std::vector<MeshLod> lodTable = lods;
+        if (lodTable.empty()) {
+            lodTable.push_back({0, header.indexCount, 0.0f, 0, 0});
+        }
+        for (const MeshLod& lod : lodTable) {
+            if (uint64_t{lod.firstIndex} + lod.indexCount > indices.size() || uint64_t{lod.firstMeshlet} + lod.meshletCount > meshlets.size()) {
+                throw std::runtime_error("avemesh lod range is out of bounds!");
+            }
+        }
+        header.lodCount = static_cast<uint32_t>(lodTable.size());
+        header.meshletCount = static_cast<uint32_t>(meshlets.size());
+        computeBounds(vertices, indices.data(), header.indexCount, header.boundsMin, header.boundsMax);
+        for (int axis = 0; axis < 3; axis++) {
+            header.dequantOffset[axis] = dequant[3][axis];
+        }
+        header.dequantScale = dequant[0][0];
+
+        header.vertexDataOffset = alignUp(sizeof(AveMeshHeader), AVEMESH_ALIGNMENT);
+        header.indexDataOffset = alignUp(header.vertexDataOffset + vertices.size() * stride, AVEMESH_ALIGNMENT);
+        header.submeshDataOffset = alignUp(header.indexDataOffset + indices.size() * sizeof(u_int32_t), AVEMESH_ALIGNMENT);
+        header.lodDataOffset = alignUp(header.submeshDataOffset + submeshes.size() * sizeof(AveMeshSubmesh), AVEMESH_ALIGNMENT);
+        header.meshletDataOffset = alignUp(header.lodDataOffset + lodTable.size() * sizeof(MeshLod), AVEMESH_ALIGNMENT);
+        header.fileSize = header.meshletDataOffset + meshlets.size() * sizeof(Meshlet);
+
+        std::vector<AveMeshSubmesh> submeshTable = submeshes;
+        for (auto& submesh : submeshTable) {
+            if (uint64_t{submesh.firstIndex} + submesh.indexCount > indices.size()) {
+                throw std::runtime_error("avemesh submesh range is out of bounds!");
+            }
+            computeBounds(vertices, indices.data() + submesh.firstIndex, submesh.indexCount, submesh.boundsMin, submesh.boundsMax);
+        }
+
+        std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file for writing: " + filePath);
+        }
+
+        auto writeAt = [&file](uint64_t offset, const void* data, size_t size) {
+            static const char zeros[AVEMESH_ALIGNMENT] = {};
+            uint64_t position = static_cast<uint64_t>(file.tellp());
+            file.write(zeros, static_cast<std::streamsize>(offset - position));
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        };
+
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.vertexDataOffset, vertexData, vertices.size() * stride);
+        writeAt(header.indexDataOffset, indices.data(), indices.size() * sizeof(u_int32_t));
+        writeAt(header.submeshDataOffset, submeshTable.data(), submeshTable.size() * sizeof(AveMeshSubmesh));
+        writeAt(header.lodDataOffset, lodTable.data(), lodTable.size() * sizeof(MeshLod));
+        writeAt(header.meshletDataOffset, meshlets.data(), meshlets.size() * sizeof(Meshlet));
+
+        if (!file.good()) {
+            throw std::runtime_error("failed to write avemesh file: " + filePath);
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ave_model.hpp"
+#include "ave_mapped_file.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ave {
+    // Cooked mesh container (.avemesh). Everything is stored exactly as AveModel uploads it, so loading
+    // is a mmap plus a memcpy into the staging buffer. Little endian, streams aligned to AVEMESH_ALIGNMENT.
+    // Vertices are in the header's VertexFormat (Vertex or PackedVertex).
+    //
+    //   AveMeshHeader | pad | vertices[vertexCount] | pad | u_int32_t[indexCount] | pad | AveMeshSubmesh[submeshCount]
+    //   | pad | MeshLod[lodCount] | pad | Meshlet[meshletCount]
+    //
+    // The index stream holds every level of detail back to back, MeshLod entries index into it
+    // and into the meshlet table.
+    static constexpr uint32_t AVEMESH_MAGIC = 0x4D455641; // "AVEM"
+    static constexpr uint32_t AVEMESH_VERSION = 4;
+    static constexpr uint32_t AVEMESH_ALIGNMENT = 64;
+
+    struct AveMeshSubmesh {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    struct AveMeshHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexFormat; // VertexFormat
+        uint32_t vertexStride; // stride of vertexFormat at cook time, rejected if the runtime layout differs
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t submeshCount;
+        uint32_t lodCount;
+        uint32_t meshletCount;
+        uint32_t reserved;
+        float boundsMin[3];
+        float boundsMax[3];
+        float dequantOffset[3]; // packed position * dequantScale + dequantOffset = object space position
+        float dequantScale;
+        uint64_t vertexDataOffset;
+        uint64_t indexDataOffset;
+        uint64_t submeshDataOffset;
+        uint64_t lodDataOffset;
+        uint64_t meshletDataOffset;
+        uint64_t fileSize;
+    };
+
+    class AveMeshFile {
+        public:
+            AveMeshFile(const std::string& filePath);
+
+            AveMeshFile(const AveMeshFile&) = delete;
+            AveMeshFile& operator=(const AveMeshFile&) = delete;
+
+            const AveMeshHeader& header() const { return *header_; }
+            const void* vertexData() const { return file_.data() + header_->vertexDataOffset; }
+            const u_int32_t* indices() const { return reinterpret_cast<const u_int32_t*>(file_.data() + header_->indexDataOffset); }
+            const AveMeshSubmesh* submeshes() const { return reinterpret_cast<const AveMeshSubmesh*>(file_.data() + header_->submeshDataOffset); }
+            const MeshLod* lods() const { return reinterpret_cast<const MeshLod*>(file_.data() + header_->lodDataOffset); }
+            const Meshlet* meshlets() const { return reinterpret_cast<const Meshlet*>(file_.data() + header_->meshletDataOffset); }
+
+            uint32_t vertexCount() const { return header_->vertexCount; }
+            uint32_t indexCount() const { return header_->indexCount; }
+            uint32_t submeshCount() const { return header_->submeshCount; }
+            uint32_t lodCount() const { return header_->lodCount; }
+            uint32_t meshletCount() const { return header_->meshletCount; }
+            VertexFormat vertexFormat() const { return static_cast<VertexFormat>(header_->vertexFormat); }
+            glm::mat4 dequantMatrix() const;
+
+            // Submesh bounds are filled in from the referenced triangles. Vertices are converted to `format` on the way out.
+            // Without lods a single level covering all indices is written.
+            static void write(
+                const std::string& filePath,
+                const std::vector<Vertex>& vertices,
+                const std::vector<u_int32_t>& indices,
+                const std::vector<AveMeshSubmesh>& submeshes,
+                const std::vector<MeshLod>& lods = {},
+                const std::vector<Meshlet>& meshlets = {},
+                VertexFormat format = VertexFormat::Full);
+
+        private:
+            AveMappedFile file_;
+            const AveMeshHeader* header_;
+    };
+}
@@ -0,0 +1,308 @@
+#include "ave_mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+namespace ave {
+
+    namespace {
+        // Forsyth scoring constants, see "Linear-Speed Vertex Cache Optimisation" (2006)
+        constexpr int FORSYTH_CACHE_SIZE = 32;
+        constexpr float CACHE_DECAY_POWER = 1.5f;
+        constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+        constexpr float VALENCE_BOOST_SCALE = 2.0f;
+        constexpr float VALENCE_BOOST_POWER = 0.5f;
+        constexpr uint32_t MAX_VALENCE = 64; // the valence boost is tabulated up to here
+
+        struct ForsythTables {
+            float cache[FORSYTH_CACHE_SIZE];
+            float valence[MAX_VALENCE];
+
+            ForsythTables() {
+                for (int i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+                    if (i < 3) {
+                        // The three vertices of the last triangle get a fixed score so it is not reused immediately
+                        cache[i] = LAST_TRIANGLE_SCORE;
+                    } else {
+                        float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                        cache[i] = std::pow(1.0f - (i - 3) * scaler, CACHE_DECAY_POWER);
+                    }
+                }
+                valence[0] = 0.0f;
+                for (uint32_t i = 1; i < MAX_VALENCE; i++) {
+                    valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+                }
+            }
+
+            float score(int cachePosition, uint32_t remainingTriangles) const {
+                if (remainingTriangles == 0) return -1.0f;
+                float result = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+                return result + valence[std::min(remainingTriangles, MAX_VALENCE - 1)];
+            }
+        };
+
+        const ForsythTables& forsythTables() {
+            static const ForsythTables tables;
+            return tables;
+        }
+
+        void validateIndices(const std::vector<u_int32_t>& indices, size_t vertexCount) {
+            if (indices.size() % 3 != 0) {
+                throw std::runtime_error("failed to optimize mesh, index count is not a multiple of 3!");
+            }
+            for (u_int32_t index : indices) {
+                if (index >= vertexCount) {
+                    throw std::runtime_error("failed to optimize mesh, index out of range!");
+                }
+            }
+        }
+
+        // Returns the FIFO cache misses of every triangle, the same cache model analyzeVertexCache uses
+        std::vector<uint8_t> simulateMisses(const std::vector<u_int32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+            std::vector<uint32_t> timestamps(vertexCount, 0);
+            std::vector<uint8_t> misses(indices.size() / 3, 0);
+            uint32_t time = cacheSize + 1;
+
+            for (size_t i = 0; i < indices.size(); i++) {
+                u_int32_t index = indices[i];
+                // A vertex is resident if it was pushed within the last cacheSize misses
+                if (time - timestamps[index] > cacheSize) {
+                    timestamps[index] = time++;
+                    misses[i / 3]++;
+                }
+            }
+            return misses;
+        }
+    }
+
+    VertexCacheStats AveMeshOptimizer::analyzeVertexCache(const std::vector<u_int32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+        VertexCacheStats stats{};
+        if (indices.empty()) return stats;
+
+        std::vector<uint8_t> misses = simulateMisses(indices, vertexCount, cacheSize);
+        for (uint8_t m : misses) stats.transformedVertices += m;
+
+        std::vector<bool> referenced(vertexCount, false);
+        size_t uniqueVertices = 0;
+        for (u_int32_t index : indices) {
+            if (!referenced[index]) {
+                referenced[index] = true;
+                uniqueVertices++;
+            }
+        }
+
+        stats.acmr = static_cast<float>(stats.transformedVertices) / (indices.size() / 3);
+        stats.atvr = static_cast<float>(stats.transformedVertices) / uniqueVertices;
+        return stats;
+    }
+
+    void AveMeshOptimizer::optimizeVertexCache(std::vector<u_int32_t>& indices, size_t vertexCount) {
+        validateIndices(indices, vertexCount);
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) return;
+
+        const ForsythTables& tables = forsythTables();
+
+        // Vertex -> triangle adjacency in CSR form. Each vertex's active triangles are kept at the
+        // front of its span so removing an emitted triangle is a swap with the last active one.
+        std::vector<uint32_t> remaining(vertexCount, 0);
+        for (u_int32_t index : indices) remaining[index]++;
+
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+
+        std::vector<uint32_t> adjacency(indices.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t t = 0; t < triangleCount; t++) {
+                for (int k = 0; k < 3; k++) {
+                    adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+                }
+            }
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) vertexScore[v] = tables.score(-1, remaining[v]);
+
+        std::vector<float> triangleScore(triangleCount);
+        for (size_t t = 0; t < triangleCount; t++) {
+            triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<u_int32_t> output;
+        output.reserve(indices.size());
+
+        // Two cache arrays swapped every step; a triangle can push up to 3 entries past the modelled size
+        std::vector<u_int32_t> cache, nextCache;
+        cache.reserve(FORSYTH_CACHE_SIZE + 3);
+        nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+        size_t inputCursor = 0;
+        int64_t bestTriangle = -1;
+
+        for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+            if (bestTriangle < 0) {
+                // Dead end: nothing in the cache touches a live triangle, restart from the next unemitted one in input order
+                while (emitted[inputCursor]) inputCursor++;
+                bestTriangle = static_cast<int64_t>(inputCursor);
+            }
+
+            const size_t t = static_cast<size_t>(bestTriangle);
+            const u_int32_t* tri = &indices[t * 3];
+            emitted[t] = true;
+            output.insert(output.end(), tri, tri + 3);
+
+            for (int k = 0; k < 3; k++) {
+                u_int32_t v = tri[k];
+                uint32_t* begin = &adjacency[adjacencyOffsets[v]];
+                uint32_t* last = begin + remaining[v] - 1;
+                uint32_t* it = std::find(begin, last + 1, static_cast<uint32_t>(t));
+                std::swap(*it, *last);
+                remaining[v]--;
+            }
+
+            // Emitted vertices move to the front, everything else keeps its LRU order
+            nextCache.assign(tri, tri + 3);
+            for (u_int32_t v : cache) {
+                if (v != tri[0] && v != tri[1] && v != tri[2]) nextCache.push_back(v);
+            }
+            std::swap(cache, nextCache);
+
+            // Vertices pushed past the modelled size fall out but still need their score refreshed
+            for (size_t i = 0; i < cache.size(); i++) {
+                u_int32_t v = cache[i];
+                int position = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+                cachePosition[v] = position;
+                float newScore = tables.score(position, remaining[v]);
+                float delta = newScore - vertexScore[v];
+                vertexScore[v] = newScore;
+
+                for (uint32_t a = 0; a < remaining[v]; a++) {
+                    triangleScore[adjacency[adjacencyOffsets[v] + a]] += delta;
+                }
+            }
+            if (cache.size() > FORSYTH_CACHE_SIZE) cache.resize(FORSYTH_CACHE_SIZE);
+
+            // Only triangles touching the cache can have the best score
+            bestTriangle = -1;
+            float bestScore = -1.0f;
+            for (u_int32_t v : cache) {
+                for (uint32_t a = 0; a < remaining[v]; a++) {
+                    uint32_t candidate = adjacency[adjacencyOffsets[v] + a];
+                    if (triangleScore[candidate] > bestScore) {
+                        bestScore = triangleScore[candidate];
+                        bestTriangle = candidate;
+                    }
+                }
+            }
+        }
+
+        indices.swap(output);
+    }
+
+    void AveMeshOptimizer::optimizeOverdraw(std::vector<u_int32_t>& indices, const std::vector<Vertex>& vertices, float threshold) {
+        validateIndices(indices, vertices.size());
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) return;
+
+        // A triangle that misses on all three vertices starts a new cluster: the cache order already restarted there,
+        // so moving whole clusters around costs (almost) nothing in vertex reuse
+        std::vector<uint8_t> misses = simulateMisses(indices, vertices.size(), ANALYSIS_CACHE_SIZE);
+        std::vector<size_t> clusterStarts;
+        for (size_t t = 0; t < triangleCount; t++) {
+            if (t == 0 || misses[t] == 3) clusterStarts.push_back(t);
+        }
+        if (clusterStarts.size() < 2) return;
+        clusterStarts.push_back(triangleCount);
+
+        // Area weighted centroids and normals for the whole mesh and each cluster
+        glm::vec3 meshCentroid{0.0f};
+        float meshArea = 0.0f;
+        std::vector<glm::vec3> clusterCentroid(clusterStarts.size() - 1, glm::vec3{0.0f});
+        std::vector<glm::vec3> clusterNormal(clusterStarts.size() - 1, glm::vec3{0.0f});
+        std::vector<float> clusterArea(clusterStarts.size() - 1, 0.0f);
+
+        for (size_t c = 0; c + 1 < clusterStarts.size(); c++) {
+            for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+                const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+                const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+                const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float area = glm::length(normal);
+                glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+                clusterCentroid[c] += centroid * area;
+                clusterNormal[c] += normal;
+                clusterArea[c] += area;
+            }
+            meshCentroid += clusterCentroid[c];
+            meshArea += clusterArea[c];
+        }
+        if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+        // Clusters facing away from the centre are likely occluders of the rest, draw those first
+        std::vector<float> sortKey(clusterStarts.size() - 1, 0.0f);
+        for (size_t c = 0; c < sortKey.size(); c++) {
+            if (clusterArea[c] <= 0.0f) continue;
+            glm::vec3 centroid = clusterCentroid[c] / clusterArea[c];
+            float normalLength = glm::length(clusterNormal[c]);
+            if (normalLength > 0.0f) {
+                sortKey[c] = glm::dot(centroid - meshCentroid, clusterNormal[c] / normalLength);
+            }
+        }
+
+        std::vector<size_t> order(sortKey.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+        std::vector<u_int32_t> sorted;
+        sorted.reserve(indices.size());
+        for (size_t c : order) {
+            sorted.insert(sorted.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+        }
+
+        float before = analyzeVertexCache(indices, vertices.size()).acmr;
+        float after = analyzeVertexCache(sorted, vertices.size()).acmr;
+        if (after <= before * threshold) {
+            indices.swap(sorted);
+        }
+    }
+
+    void AveMeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<u_int32_t>& indices) {
+        validateIndices(indices, vertices.size());
+
+        constexpr u_int32_t UNASSIGNED = ~0u;
+        std::vector<u_int32_t> remap(vertices.size(), UNASSIGNED);
+        std::vector<Vertex> reordered;
+        reordered.reserve(vertices.size());
+
+        for (u_int32_t& index : indices) {
+            if (remap[index] == UNASSIGNED) {
+                remap[index] = static_cast<u_int32_t>(reordered.size());
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        vertices.swap(reordered);
+    }
+
+    MeshOptimizationReport AveMeshOptimizer::optimizeMesh(std::vector<Vertex>& vertices, std::vector<u_int32_t>& indices) {
+        MeshOptimizationReport report{};
+        report.verticesBefore = vertices.size();
+        report.before = analyzeVertexCache(indices, vertices.size());
+
+        optimizeVertexCache(indices, vertices.size());
+        optimizeOverdraw(indices, vertices);
+        optimizeVertexFetch(vertices, indices);
+
+        report.verticesAfter = vertices.size();
+        report.after = analyzeVertexCache(indices, vertices.size());
+        return report;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ave_model.hpp"
+
+#include <vector>
+
+namespace ave {
+
+    // Post-transform cache efficiency of an index buffer, measured against a FIFO cache
+    struct VertexCacheStats {
+        size_t transformedVertices = 0; // cache misses, i.e. vertex shader invocations
+        float acmr = 0.0f;              // average cache miss ratio: misses per triangle, 0.5 is ideal for big grids, 3 is worst
+        float atvr = 0.0f;              // average transformed vertex ratio: misses per referenced vertex, 1 is ideal
+    };
+
+    struct MeshOptimizationReport {
+        VertexCacheStats before;
+        VertexCacheStats after;
+        size_t verticesBefore = 0;
+        size_t verticesAfter = 0; // unreferenced vertices are dropped by the fetch remap
+    };
+
+    // Cook/load time index and vertex reordering. All passes keep the triangle set intact, only order changes.
+    class AveMeshOptimizer {
+        public:
+            static constexpr uint32_t ANALYSIS_CACHE_SIZE = 16;
+
+            static VertexCacheStats analyzeVertexCache(const std::vector<u_int32_t>& indices, size_t vertexCount, uint32_t cacheSize = ANALYSIS_CACHE_SIZE);
+
+            // Tom Forsyth's linear-speed vertex cache optimisation
+            static void optimizeVertexCache(std::vector<u_int32_t>& indices, size_t vertexCount);
+
+            // Splits a cache optimised index buffer into clusters at cache restarts and sorts the clusters so outward
+            // facing ones draw first. Reverts if the cluster order costs more than `threshold` times the ACMR.
+            static void optimizeOverdraw(std::vector<u_int32_t>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+
+            // Reorders vertices by first use so the vertex fetch streams linearly through memory
+            static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<u_int32_t>& indices);
+
+            // Runs all of the above in order
+            static MeshOptimizationReport optimizeMesh(std::vector<Vertex>& vertices, std::vector<u_int32_t>& indices);
+    };
+}
@@ -0,0 +1,353 @@
+#include "ave_mesh_simplifier.hpp"
+#include "ave_mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace ave {
+
+    namespace {
+        // Borders and uv seams get a plane perpendicular to the surface through the edge, scaled by this
+        constexpr float BORDER_WEIGHT = 10.0f;
+        constexpr int MAX_PASSES = 64;
+
+        // Symmetric 4x4 plane quadric (Garland & Heckbert 1997), error is normalised by the accumulated weight
+        struct Quadric {
+            double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+            double b0 = 0, b1 = 0, b2 = 0;
+            double c = 0;
+            double w = 0;
+
+            // Plane n.p + d = 0 with unit n
+            void addPlane(const glm::vec3& n, float d, float weight) {
+                a00 += weight * n.x * n.x; a01 += weight * n.x * n.y; a02 += weight * n.x * n.z;
+                a11 += weight * n.y * n.y; a12 += weight * n.y * n.z; a22 += weight * n.z * n.z;
+                b0 += weight * n.x * d; b1 += weight * n.y * d; b2 += weight * n.z * d;
+                c += weight * d * d;
+                w += weight;
+            }
+
+            void add(const Quadric& other) {
+                a00 += other.a00; a01 += other.a01; a02 += other.a02;
+                a11 += other.a11; a12 += other.a12; a22 += other.a22;
+                b0 += other.b0; b1 += other.b1; b2 += other.b2;
+                c += other.c;
+                w += other.w;
+            }
+
+            // Weighted mean squared distance of p to the accumulated planes
+            double error(const glm::vec3& p) const {
+                double x = p.x, y = p.y, z = p.z;
+                double r = a00 * x * x + a11 * y * y + a22 * z * z
+                         + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                         + 2.0 * (b0 * x + b1 * y + b2 * z)
+                         + c;
+                return w > 0.0 ? std::max(r, 0.0) / w : 0.0;
+            }
+        };
+
+        double collapseError(const Quadric& from, const Quadric& to, const glm::vec3& position) {
+            Quadric merged = from;
+            merged.add(to);
+            return merged.error(position);
+        }
+
+        struct PositionKey {
+            uint32_t bits[3];
+
+            bool operator==(const PositionKey& other) const {
+                return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+            }
+        };
+
+        struct PositionKey_hash {
+            size_t operator()(const PositionKey& key) const {
+                return (key.bits[0] * 73856093u) ^ (key.bits[1] * 19349663u) ^ (key.bits[2] * 83492791u);
+            }
+        };
+
+        uint64_t edgeKey(uint32_t a, uint32_t b) {
+            if (a > b) std::swap(a, b);
+            return (uint64_t{a} << 32) | b;
+        }
+
+        struct Collapse {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+        };
+    }
+
+    std::vector<u_int32_t> AveMeshSimplifier::simplify(
+        const std::vector<Vertex>& vertices,
+        const std::vector<u_int32_t>& indices,
+        size_t targetIndexCount,
+        float* resultError) {
+        if (indices.size() % 3 != 0) {
+            throw std::runtime_error("failed to simplify mesh, index count is not a multiple of 3!");
+        }
+        const size_t vertexCount = vertices.size();
+        for (u_int32_t index : indices) {
+            if (index >= vertexCount) {
+                throw std::runtime_error("failed to simplify mesh, index out of range!");
+            }
+        }
+
+        // Position groups: every wedge (vertex) with a bitwise identical position collapses as one
+        std::vector<uint32_t> group(vertexCount);
+        std::vector<glm::vec3> groupPos;
+        {
+            std::unordered_map<PositionKey, uint32_t, PositionKey_hash> lookup;
+            lookup.reserve(vertexCount);
+            for (size_t v = 0; v < vertexCount; v++) {
+                PositionKey key;
+                std::memcpy(key.bits, &vertices[v].pos, sizeof(key.bits));
+                auto inserted = lookup.emplace(key, static_cast<uint32_t>(groupPos.size()));
+                if (inserted.second) groupPos.push_back(vertices[v].pos);
+                group[v] = inserted.first->second;
+            }
+        }
+        const size_t groupCount = groupPos.size();
+
+        std::vector<uint32_t> wedgeOffsets(groupCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++) wedgeOffsets[group[v] + 1]++;
+        for (size_t g = 0; g < groupCount; g++) wedgeOffsets[g + 1] += wedgeOffsets[g];
+        std::vector<uint32_t> wedges(vertexCount);
+        {
+            std::vector<uint32_t> fill(wedgeOffsets.begin(), wedgeOffsets.end() - 1);
+            for (size_t v = 0; v < vertexCount; v++) wedges[fill[group[v]]++] = static_cast<uint32_t>(v);
+        }
+
+        // Triangles that are already degenerate in position space are dropped up front
+        std::vector<u_int32_t> result;
+        result.reserve(indices.size());
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            uint32_t g0 = group[indices[i]], g1 = group[indices[i + 1]], g2 = group[indices[i + 2]];
+            if (g0 != g1 && g1 != g2 && g0 != g2) {
+                result.insert(result.end(), indices.begin() + i, indices.begin() + i + 3);
+            }
+        }
+
+        // Area weighted face quadrics, plus border and seam edge quadrics
+        std::vector<Quadric> quadrics(groupCount);
+        std::unordered_map<uint64_t, uint32_t> groupEdgeCount;
+        std::unordered_map<uint64_t, uint32_t> vertexEdgeCount;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                u_int32_t va = result[i + k], vb = result[i + (k + 1) % 3];
+                groupEdgeCount[edgeKey(group[va], group[vb])]++;
+                vertexEdgeCount[edgeKey(va, vb)]++;
+            }
+        }
+
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const glm::vec3& p0 = groupPos[group[result[i]]];
+            const glm::vec3& p1 = groupPos[group[result[i + 1]]];
+            const glm::vec3& p2 = groupPos[group[result[i + 2]]];
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(normal);
+            if (length <= 0.0f) continue;
+            normal /= length;
+
+            float area = length * 0.5f;
+            float d = -glm::dot(normal, p0);
+            for (int k = 0; k < 3; k++) quadrics[group[result[i + k]]].addPlane(normal, d, area);
+
+            for (int k = 0; k < 3; k++) {
+                u_int32_t va = result[i + k], vb = result[i + (k + 1) % 3];
+                bool border = groupEdgeCount[edgeKey(group[va], group[vb])] == 1;
+                bool seam = !border && vertexEdgeCount[edgeKey(va, vb)] == 1;
+                if (!border && !seam) continue;
+
+                const glm::vec3& pa = groupPos[group[va]];
+                const glm::vec3& pb = groupPos[group[vb]];
+                glm::vec3 edge = pb - pa;
+                glm::vec3 edgeNormal = glm::cross(edge, normal);
+                float edgeNormalLength = glm::length(edgeNormal);
+                if (edgeNormalLength <= 0.0f) continue;
+                edgeNormal /= edgeNormalLength;
+
+                float weight = glm::dot(edge, edge) * BORDER_WEIGHT;
+                float edgeD = -glm::dot(edgeNormal, pa);
+                quadrics[group[va]].addPlane(edgeNormal, edgeD, weight);
+                quadrics[group[vb]].addPlane(edgeNormal, edgeD, weight);
+            }
+        }
+
+        // A collapsed group's wedges move to the target group's wedge with the closest attributes
+        auto nearestWedge = [&](uint32_t targetGroup, u_int32_t vertex) {
+            const Vertex& source = vertices[vertex];
+            uint32_t best = wedges[wedgeOffsets[targetGroup]];
+            float bestDistance = std::numeric_limits<float>::max();
+            for (uint32_t w = wedgeOffsets[targetGroup]; w < wedgeOffsets[targetGroup + 1]; w++) {
+                const Vertex& candidate = vertices[wedges[w]];
+                glm::vec2 uv = candidate.texCoord - source.texCoord;
+                glm::vec3 normal = candidate.normal - source.normal;
+                float distance = glm::dot(uv, uv) + glm::dot(normal, normal);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = wedges[w];
+                }
+            }
+            return best;
+        };
+
+        const size_t targetTriangles = targetIndexCount / 3;
+        std::vector<uint32_t> groupRemap(groupCount);
+        std::vector<uint8_t> touched(groupCount);
+        std::vector<uint32_t> adjacencyOffsets(groupCount + 1);
+        std::vector<uint32_t> adjacency;
+        std::vector<uint64_t> edges;
+        std::vector<Collapse> collapses;
+        double maxError = 0.0;
+
+        for (int pass = 0; pass < MAX_PASSES; pass++) {
+            const size_t triangleCount = result.size() / 3;
+            if (triangleCount <= targetTriangles) break;
+
+            // Group -> live triangle adjacency
+            std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+            for (u_int32_t v : result) adjacencyOffsets[group[v] + 1]++;
+            for (size_t g = 0; g < groupCount; g++) adjacencyOffsets[g + 1] += adjacencyOffsets[g];
+            adjacency.resize(result.size());
+            {
+                std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+                for (size_t i = 0; i < result.size(); i++) adjacency[fill[group[result[i]]]++] = static_cast<uint32_t>(i / 3);
+            }
+
+            // Every unique edge is a candidate, in its cheaper direction
+            edges.clear();
+            for (size_t i = 0; i < result.size(); i += 3) {
+                for (int k = 0; k < 3; k++) {
+                    edges.push_back(edgeKey(group[result[i + k]], group[result[i + (k + 1) % 3]]));
+                }
+            }
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+            collapses.clear();
+            for (uint64_t key : edges) {
+                uint32_t a = static_cast<uint32_t>(key >> 32);
+                uint32_t b = static_cast<uint32_t>(key & 0xffffffffu);
+                double costAB = collapseError(quadrics[a], quadrics[b], groupPos[b]);
+                double costBA = collapseError(quadrics[b], quadrics[a], groupPos[a]);
+                collapses.push_back(costAB <= costBA ? Collapse{a, b, costAB} : Collapse{b, a, costBA});
+            }
+
+            // Greedily apply the cheapest collapses. Both ends of a collapse are locked for the rest of the pass,
+            // so groupRemap is at most one step deep and looking through it gives the current triangles.
+            // Roughly a third of the candidates survive locking, so each pass looks at three times as many as
+            // it needs; blocked cheap ones get another chance next pass before anything more expensive is taken.
+            for (size_t g = 0; g < groupCount; g++) groupRemap[g] = static_cast<uint32_t>(g);
+            std::fill(touched.begin(), touched.end(), 0);
+            const size_t trianglesToRemove = triangleCount - targetTriangles;
+            auto byCost = [](const Collapse& l, const Collapse& r) { return l.cost < r.cost; };
+            auto window = collapses.begin() + std::min(collapses.size() - 1, trianglesToRemove * 3 / 2);
+            std::nth_element(collapses.begin(), window, collapses.end(), byCost);
+            std::sort(collapses.begin(), window + 1, byCost);
+            collapses.erase(window + 1, collapses.end());
+            size_t removed = 0;
+            size_t applied = 0;
+
+            for (const Collapse& collapse : collapses) {
+                if (removed >= trianglesToRemove) break;
+                if (touched[collapse.from] || touched[collapse.to]) continue;
+
+                // Reject collapses that would flip a surviving triangle
+                bool flips = false;
+                size_t degenerate = 0;
+                for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; a++) {
+                    const u_int32_t* tri = &result[adjacency[a] * 3];
+                    uint32_t g[3] = {groupRemap[group[tri[0]]], groupRemap[group[tri[1]]], groupRemap[group[tri[2]]]};
+                    if (g[0] == g[1] || g[1] == g[2] || g[0] == g[2]) {
+                        continue; // already removed by an earlier collapse this pass
+                    }
+                    if (g[0] == collapse.to || g[1] == collapse.to || g[2] == collapse.to) {
+                        degenerate++;
+                        continue;
+                    }
+
+                    glm::vec3 before[3], after[3];
+                    for (int k = 0; k < 3; k++) {
+                        before[k] = groupPos[g[k]];
+                        after[k] = g[k] == collapse.from ? groupPos[collapse.to] : before[k];
+                    }
+                    glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                    flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+                }
+                if (flips) continue;
+
+                groupRemap[collapse.from] = collapse.to;
+                quadrics[collapse.to].add(quadrics[collapse.from]);
+                maxError = std::max(maxError, collapse.cost);
+                touched[collapse.from] = 1;
+                touched[collapse.to] = 1;
+                removed += degenerate;
+                applied++;
+            }
+
+            if (applied == 0) break;
+
+            // Rewrite the triangles onto the surviving groups and drop the ones that collapsed
+            size_t write = 0;
+            for (size_t i = 0; i < result.size(); i += 3) {
+                u_int32_t tri[3];
+                for (int k = 0; k < 3; k++) {
+                    u_int32_t v = result[i + k];
+                    uint32_t target = groupRemap[group[v]];
+                    tri[k] = target == group[v] ? v : nearestWedge(target, v);
+                }
+                if (group[tri[0]] == group[tri[1]] || group[tri[1]] == group[tri[2]] || group[tri[0]] == group[tri[2]]) continue;
+                result[write++] = tri[0];
+                result[write++] = tri[1];
+                result[write++] = tri[2];
+            }
+            result.resize(write);
+        }
+
+        if (resultError != nullptr) {
+            *resultError = static_cast<float>(std::sqrt(maxError));
+        }
+        return result;
+    }
+
+    std::vector<MeshLod> AveMeshSimplifier::buildLodChain(
+        const std::vector<Vertex>& vertices,
+        std::vector<u_int32_t>& indices,
+        std::vector<Meshlet>* meshlets) {
+        std::vector<MeshLod> lods;
+        lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f, 0, 0});
+
+        // Each level is simplified from the previous one, so errors accumulate
+        std::vector<u_int32_t> previous = indices;
+        float error = 0.0f;
+        for (float ratio : LOD_RATIOS) {
+            size_t target = static_cast<size_t>(lods[0].indexCount / 3 * ratio) * 3;
+            float levelError = 0.0f;
+            std::vector<u_int32_t> lod = simplify(vertices, previous, target, &levelError);
+            if (lod.empty() || lod.size() * 10 > previous.size() * 9) break;
+
+            AveMeshOptimizer::optimizeVertexCache(lod, vertices.size());
+            error += levelError;
+            lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lod.size()), error, 0, 0});
+            indices.insert(indices.end(), lod.begin(), lod.end());
+            previous.swap(lod);
+        }
+
+        if (meshlets != nullptr) {
+            meshlets->clear();
+            for (MeshLod& lod : lods) {
+                std::vector<Meshlet> levelMeshlets = AveMeshlets::build(vertices, indices, lod.firstIndex, lod.indexCount);
+                lod.firstMeshlet = static_cast<uint32_t>(meshlets->size());
+                lod.meshletCount = static_cast<uint32_t>(levelMeshlets.size());
+                meshlets->insert(meshlets->end(), levelMeshlets.begin(), levelMeshlets.end());
+            }
+        }
+        return lods;
+    }
+}
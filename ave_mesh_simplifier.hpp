@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ave_model.hpp"
+
+#include <array>
+#include <vector>
+
+namespace ave {
+
+    // Index-only quadric error simplification: edges collapse onto existing vertices, so every LOD
+    // of a mesh can share its vertex buffer. Vertices with the same position (uv/normal seams) move
+    // together, and mesh borders and attribute seams are kept in place by extra edge quadrics.
+    class AveMeshSimplifier {
+        public:
+            // Fraction of LOD0's triangles each further level aims for
+            static constexpr std::array<float, 4> LOD_RATIOS = {0.5f, 0.25f, 0.125f, 0.0625f};
+
+            // Returns at most targetIndexCount indices unless the mesh cannot be reduced further.
+            // resultError receives the object space error of the simplification.
+            static std::vector<u_int32_t> simplify(
+                const std::vector<Vertex>& vertices,
+                const std::vector<u_int32_t>& indices,
+                size_t targetIndexCount,
+                float* resultError = nullptr);
+
+            // Appends one cache optimised index range per LOD_RATIOS entry to `indices` (which holds LOD0 on entry)
+            // and returns the ranges, LOD0 first. Stops early once a level no longer reduces the triangle count.
+            // With meshlets every level, LOD0 included, is also split into meshlets referenced by its MeshLod.
+            static std::vector<MeshLod> buildLodChain(
+                const std::vector<Vertex>& vertices,
+                std::vector<u_int32_t>& indices,
+                std::vector<Meshlet>* meshlets = nullptr);
+    };
+}
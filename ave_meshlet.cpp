@@ -0,0 +1,277 @@
+#include "ave_meshlet.hpp"
+#include "ave_frustum.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace ave {
+
+    namespace {
+        // Cones wider than this (dot of the axis with the widest normal) can never be culled, skip them
+        constexpr float CONE_MIN_SPREAD = 0.1f;
+
+        // Weight of the normal cone spread (1 - dot with the meshlet's average normal, 0..2) in a candidate's
+        // score, like meshoptimizer's cone_weight. Below 0.5 it never outweighs one extra vertex, so it only
+        // breaks ties between triangles that grow the meshlet equally and never closes a meshlet early.
+        constexpr float MESHLET_CONE_WEIGHT = 0.25f;
+
+        // Culled runs shorter than this many triangles are drawn anyway: the rasterizer rejects them
+        // cheaper than the extra vkCmdDrawIndexed would cost
+        constexpr uint32_t DRAW_RANGE_MAX_GAP = 32;
+
+        void computeBounds(const std::vector<Vertex>& vertices, const u_int32_t* indices, uint32_t triangleCount, Meshlet& meshlet) {
+            // Sphere around the AABB centre, tight enough for culling and cheaper than Ritter
+            glm::vec3 lo{std::numeric_limits<float>::max()};
+            glm::vec3 hi{std::numeric_limits<float>::lowest()};
+            for (uint32_t i = 0; i < triangleCount * 3; i++) {
+                lo = glm::min(lo, vertices[indices[i]].pos);
+                hi = glm::max(hi, vertices[indices[i]].pos);
+            }
+            glm::vec3 center = (lo + hi) * 0.5f;
+            float radius = 0.0f;
+            for (uint32_t i = 0; i < triangleCount * 3; i++) {
+                radius = std::max(radius, glm::length(vertices[indices[i]].pos - center));
+            }
+
+            // Normal cone from the unit face normals
+            glm::vec3 axisSum{0.0f};
+            std::vector<glm::vec3> normals;
+            normals.reserve(triangleCount);
+            for (uint32_t t = 0; t < triangleCount; t++) {
+                const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+                const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+                const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float length = glm::length(normal);
+                normals.push_back(length > 0.0f ? normal / length : glm::vec3{0.0f});
+                axisSum += normals.back();
+            }
+
+            float axisLength = glm::length(axisSum);
+            glm::vec3 axis = axisLength > 0.0f ? axisSum / axisLength : glm::vec3{0.0f, 0.0f, 1.0f};
+            float minDot = axisLength > 0.0f ? 1.0f : -1.0f;
+            for (const glm::vec3& normal : normals) {
+                minDot = std::min(minDot, glm::dot(axis, normal));
+            }
+
+            // Move the apex back along the axis until it is behind every triangle's plane
+            glm::vec3 apex = center;
+            float cutoff = 1.0f;
+            if (minDot > CONE_MIN_SPREAD) {
+                float maxT = 0.0f;
+                for (uint32_t t = 0; t < triangleCount; t++) {
+                    const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+                    float dc = glm::dot(center - p0, normals[t]);
+                    float dn = glm::dot(axis, normals[t]);
+                    maxT = std::max(maxT, dc / dn);
+                }
+                apex = center - axis * maxT;
+                cutoff = std::sqrt(1.0f - minDot * minDot);
+            }
+
+            for (int k = 0; k < 3; k++) {
+                meshlet.center[k] = center[k];
+                meshlet.coneApex[k] = apex[k];
+                meshlet.coneAxis[k] = axis[k];
+            }
+            meshlet.radius = radius;
+            meshlet.coneCutoff = cutoff;
+        }
+    }
+
+    std::vector<Meshlet> AveMeshlets::build(
+        const std::vector<Vertex>& vertices,
+        std::vector<u_int32_t>& indices,
+        uint32_t firstIndex,
+        uint32_t indexCount) {
+        if (indexCount % 3 != 0 || uint64_t{firstIndex} + indexCount > indices.size()) {
+            throw std::runtime_error("failed to build meshlets, invalid index range!");
+        }
+        for (uint32_t i = firstIndex; i < firstIndex + indexCount; i++) {
+            if (indices[i] >= vertices.size()) {
+                throw std::runtime_error("failed to build meshlets, index out of range!");
+            }
+        }
+
+        const uint32_t triangleCount = indexCount / 3;
+        const std::vector<u_int32_t> source(indices.begin() + firstIndex, indices.begin() + firstIndex + indexCount);
+
+        std::vector<glm::vec3> normals(triangleCount);
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            const glm::vec3& p0 = vertices[source[t * 3]].pos;
+            const glm::vec3& p1 = vertices[source[t * 3 + 1]].pos;
+            const glm::vec3& p2 = vertices[source[t * 3 + 2]].pos;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(normal);
+            normals[t] = length > 0.0f ? normal / length : glm::vec3{0.0f};
+        }
+
+        // Triangles across a uv or normal seam share positions but not vertices, so connectivity is
+        // tracked per position: every vertex maps to the first vertex with the same position
+        std::vector<u_int32_t> positionIds(vertices.size());
+        {
+            std::vector<u_int32_t> order(vertices.size());
+            for (u_int32_t v = 0; v < order.size(); v++) order[v] = v;
+            auto less = [&](u_int32_t a, u_int32_t b) {
+                const glm::vec3& pa = vertices[a].pos;
+                const glm::vec3& pb = vertices[b].pos;
+                if (pa.x != pb.x) return pa.x < pb.x;
+                if (pa.y != pb.y) return pa.y < pb.y;
+                if (pa.z != pb.z) return pa.z < pb.z;
+                return a < b;
+            };
+            std::sort(order.begin(), order.end(), less);
+            for (size_t i = 0; i < order.size(); i++) {
+                bool same = i > 0 && vertices[order[i]].pos == vertices[order[i - 1]].pos;
+                positionIds[order[i]] = same ? positionIds[order[i - 1]] : order[i];
+            }
+        }
+
+        // Position -> triangle adjacency in CSR form
+        std::vector<uint32_t> adjacencyOffsets(vertices.size() + 1, 0);
+        for (u_int32_t v : source) adjacencyOffsets[positionIds[v] + 1]++;
+        for (size_t v = 0; v < vertices.size(); v++) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        std::vector<uint32_t> adjacency(source.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (uint32_t i = 0; i < source.size(); i++) adjacency[fill[positionIds[source[i]]]++] = i / 3;
+        }
+
+        std::vector<Meshlet> meshlets;
+        std::vector<u_int32_t> output;
+        output.reserve(indexCount);
+        std::vector<bool> emitted(triangleCount, false);
+
+        // Vertex -> meshlet it was last added to, so membership checks are O(1) without clearing a set
+        std::vector<uint32_t> lastMeshlet(vertices.size(), ~0u);
+        std::vector<u_int32_t> meshletVertices;
+        Meshlet current{};
+        current.firstIndex = firstIndex;
+        glm::vec3 axisSum{0.0f};
+        uint32_t seedCursor = 0;
+
+        auto newVertexCount = [&](uint32_t t) {
+            const u_int32_t* tri = &source[t * 3];
+            uint32_t id = static_cast<uint32_t>(meshlets.size());
+            return static_cast<uint32_t>(lastMeshlet[tri[0]] != id)
+                + static_cast<uint32_t>(lastMeshlet[tri[1]] != id && tri[1] != tri[0])
+                + static_cast<uint32_t>(lastMeshlet[tri[2]] != id && tri[2] != tri[0] && tri[2] != tri[1]);
+        };
+
+        auto flush = [&]() {
+            if (current.triangleCount == 0) return;
+            computeBounds(vertices, &output[current.firstIndex - firstIndex], current.triangleCount, current);
+            meshlets.push_back(current);
+            current = Meshlet{};
+            current.firstIndex = firstIndex + static_cast<uint32_t>(output.size());
+            axisSum = glm::vec3{0.0f};
+            meshletVertices.clear();
+        };
+
+        for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+            // Grow the meshlet through its own vertices: prefer triangles that add no new vertex, then ones
+            // that keep the normal cone tight. The meshlet closes only at the vertex or triangle limit or once
+            // no triangle adjacent to it is left.
+            int64_t best = -1;
+            if (current.triangleCount > 0 && current.triangleCount < MESHLET_MAX_TRIANGLES) {
+                float axisLength = glm::length(axisSum);
+                glm::vec3 axis = axisLength > 0.0f ? axisSum / axisLength : glm::vec3{0.0f};
+                float bestScore = std::numeric_limits<float>::max();
+
+                for (u_int32_t v : meshletVertices) {
+                    u_int32_t p = positionIds[v];
+                    for (uint32_t a = adjacencyOffsets[p]; a < adjacencyOffsets[p + 1]; a++) {
+                        uint32_t t = adjacency[a];
+                        if (emitted[t]) continue;
+
+                        uint32_t added = newVertexCount(t);
+                        if (current.vertexCount + added > MESHLET_MAX_VERTICES) continue;
+                        float spread = 1.0f - glm::dot(axis, normals[t]);
+                        float score = added + MESHLET_CONE_WEIGHT * spread;
+                        if (score < bestScore) {
+                            bestScore = score;
+                            best = t;
+                        }
+                    }
+                }
+            }
+
+            if (best < 0) {
+                // Nothing connected fits, start the next meshlet from the earliest remaining triangle
+                flush();
+                while (emitted[seedCursor]) seedCursor++;
+                best = seedCursor;
+            }
+
+            const uint32_t t = static_cast<uint32_t>(best);
+            const uint32_t id = static_cast<uint32_t>(meshlets.size());
+            emitted[t] = true;
+            for (int k = 0; k < 3; k++) {
+                u_int32_t v = source[t * 3 + k];
+                output.push_back(v);
+                if (lastMeshlet[v] != id) {
+                    lastMeshlet[v] = id;
+                    meshletVertices.push_back(v);
+                    current.vertexCount++;
+                }
+            }
+            axisSum += normals[t];
+            current.triangleCount++;
+        }
+        flush();
+
+        std::copy(output.begin(), output.end(), indices.begin() + firstIndex);
+        return meshlets;
+    }
+
+    void AveMeshlets::cull(
+        const Meshlet* meshlets,
+        size_t meshletCount,
+        const glm::mat4& modelViewProj,
+        const glm::vec3& cameraPosition,
+        bool cullBackfaces,
+        std::vector<DrawRange>& ranges,
+        MeshletCullStats* stats) {
+        // Object space frustum planes straight from the clip matrix
+        AveFrustum frustum = AveFrustum::fromMatrix(modelViewProj);
+
+        MeshletCullStats counts{};
+        ranges.clear();
+
+        for (size_t m = 0; m < meshletCount; m++) {
+            const Meshlet& meshlet = meshlets[m];
+            glm::vec3 center{meshlet.center[0], meshlet.center[1], meshlet.center[2]};
+
+            if (!frustum.intersectsSphere(center, meshlet.radius)) {
+                counts.frustumCulled++;
+                continue;
+            }
+
+            if (cullBackfaces && meshlet.coneCutoff < 1.0f) {
+                glm::vec3 apex{meshlet.coneApex[0], meshlet.coneApex[1], meshlet.coneApex[2]};
+                glm::vec3 axis{meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]};
+                glm::vec3 view = apex - cameraPosition;
+                float distance = glm::length(view);
+                if (distance > 0.0f && glm::dot(view, axis) >= meshlet.coneCutoff * distance) {
+                    counts.backfaceCulled++;
+                    continue;
+                }
+            }
+
+            counts.visible++;
+            uint32_t indexCount = meshlet.triangleCount * 3;
+            if (!ranges.empty() && ranges.back().firstIndex + ranges.back().indexCount + DRAW_RANGE_MAX_GAP * 3 >= meshlet.firstIndex) {
+                ranges.back().indexCount = meshlet.firstIndex + indexCount - ranges.back().firstIndex;
+            } else {
+                ranges.push_back({meshlet.firstIndex, indexCount});
+            }
+        }
+
+        counts.drawRanges = static_cast<uint32_t>(ranges.size());
+        if (stats != nullptr) {
+            *stats = counts;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "ave_vertex_layout.hpp"
+
+#include <vector>
+
+namespace ave {
+
+    static constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+    static constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+    // A run of triangles inside a model's index buffer. The builder reorders triangles so every meshlet
+    // is contiguous, which lets visible neighbours merge back into one draw.
+    // Bounds are in object space (before any dequant matrix), stored flat so .avemesh can hold them.
+    struct Meshlet {
+        uint32_t firstIndex;
+        uint32_t triangleCount;
+        uint32_t vertexCount;  // unique vertices referenced, at most MESHLET_MAX_VERTICES
+        float center[3];       // bounding sphere
+        float radius;
+        float coneApex[3];     // normal cone, the meshlet is back facing for every camera with
+        float coneAxis[3];     //   dot(normalize(coneApex - camera), coneAxis) >= coneCutoff
+        float coneCutoff;      // sin of the cone half angle, 1 when the normals spread too far to ever cull
+    };
+
+    struct DrawRange {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+    };
+
+    struct MeshletCullStats {
+        uint32_t visible = 0;
+        uint32_t frustumCulled = 0;
+        uint32_t backfaceCulled = 0;
+        uint32_t drawRanges = 0;
+    };
+
+    class AveMeshlets {
+        public:
+            // Groups the triangles of indices[firstIndex, firstIndex + indexCount) into connected meshlets, filled
+            // up to the vertex and triangle limits while favouring narrow normal cones, and rewrites that range in
+            // meshlet order
+            static std::vector<Meshlet> build(
+                const std::vector<Vertex>& vertices,
+                std::vector<u_int32_t>& indices,
+                uint32_t firstIndex,
+                uint32_t indexCount);
+
+            // Drops meshlets outside the frustum of modelViewProj (Vulkan clip space) and, when cullBackfaces
+            // is set, meshlets facing away from cameraPosition (object space). Survivors are written to ranges
+            // with neighbours merged across short culled runs.
+            static void cull(
+                const Meshlet* meshlets,
+                size_t meshletCount,
+                const glm::mat4& modelViewProj,
+                const glm::vec3& cameraPosition,
+                bool cullBackfaces,
+                std::vector<DrawRange>& ranges,
+                MeshletCullStats* stats = nullptr);
+    };
+}
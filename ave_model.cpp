@@ -1,169 +1,334 @@
 #include "ave_model.hpp"
+#include "ave_obj_loader.hpp"
+#include "ave_mesh_file.hpp"
+#include "ave_mesh_optimizer.hpp"
+#include "ave_mesh_simplifier.hpp"
+#include "ave_vertex_welder.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
 
 namespace ave {
-    AveModel::AveModel(AveDevice& device, const std::vector<Vertex>& vertices, const std::vector<u_int32_t>& indices) : aveDevice{device},
-                origVertices_{vertices}, stagingVertices_{vertices}, origIndices_{indices} {
-        createVertexBuffers(vertices);
-        createIndexBuffer(indices);
-        createUniformBuffers();
+
+    namespace {
+        // How much a transform stretches lengths at most, for bounding radii
+        float maxScale(const glm::mat4& transform) {
+            return std::max({glm::length(glm::vec3{transform[0]}), glm::length(glm::vec3{transform[1]}), glm::length(glm::vec3{transform[2]})});
+        }
     }
 
-    AveModel::~AveModel(){
-        vkDestroyBuffer(aveDevice.device(), indexBuffer, nullptr);
-        vkFreeMemory(aveDevice.device(), indexBufferMemory, nullptr);
+    AveModel::AveModel(AveDevice& device, const std::vector<Vertex>& vertices, const std::vector<u_int32_t>& indices, bool dynamic) : aveDevice{device},
+                origVertices_{vertices}, origIndices_{indices} {
+        if (dynamic) {
+            dynamicVertices_ = std::make_unique<AveDynamicVertexBuffer>(aveDevice, vertices.data(),
+                static_cast<uint32_t>(vertices.size()), sizeof(Vertex));
+        }
+        createGeometry(vertices.data(), static_cast<uint32_t>(vertices.size()), sizeof(Vertex),
+            indices.data(), static_cast<uint32_t>(indices.size()));
+    }
 
-        vkDestroyBuffer(aveDevice.device(), vertexBuffer, nullptr); // RAII
-        vkFreeMemory(aveDevice.device(), vertexBufferMemory, nullptr);
+    AveModel::AveModel(AveDevice& device, VertexFormat format, const void* vertexData, uint32_t vertexCount,
+                const u_int32_t* indices, uint32_t indexCount, const glm::mat4& dequantMatrix) : aveDevice{device},
+                vertexFormat_{format}, dequantMatrix_{dequantMatrix} {
+        createGeometry(vertexData, vertexCount, getVertexLayout(format).stride(), indices, indexCount);
+    }
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkDestroyBuffer(aveDevice.device(), uniformBuffers[i], nullptr);
-            vkFreeMemory(aveDevice.device(), uniformBuffersMemory[i], nullptr);
+    AveModel::~AveModel(){
+        aveDevice.getResidency().untrack(residency_);
+        if (!evicted_) {
+            aveDevice.getUploadQueue().wait(uploadToken_);
+            aveDevice.getGeometryPool().free(geometry_);
         }
-
     }
 
-    void AveModel::createVertexBuffers(const std::vector<Vertex> &vertices){
-        vertexCount = static_cast<uint32_t>(vertices.size());
+    void AveModel::createGeometry(const void* vertices, uint32_t vertexTotal, uint32_t stride, const u_int32_t* indices, uint32_t indexTotal) {
+        vertexCount = vertexTotal;
         assert(vertexCount >= 3 && "Vertex Count must be greater than 3");
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
+        indexCount = indexTotal;
+        lods_ = {{0, indexCount, 0.0f, 0, 0}};
+        currentLod_ = 0;
+
+        // Shared device local buffers, the ranges are looked up at draw time since compaction moves them
+        // Dynamic meshes only keep their indices in the pool
+        geometry_ = aveDevice.getGeometryPool().allocate(vertices, dynamicVertices_ ? 0 : vertexCount, stride, indices, indexCount, uploadToken_);
+        stride_ = stride;
+        geometryBytes_ = (dynamicVertices_ ? 0 : VkDeviceSize{stride} * vertexCount) + sizeof(u_int32_t) * VkDeviceSize{indexCount};
+        residency_ = aveDevice.getResidency().track(geometryBytes_,
+            [this](VkCommandBuffer commandBuffer, bool idle) { return evict(commandBuffer, idle); });
+    }
 
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        aveDevice.createBuffer(
-            bufferSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            stagingBuffer,
-            stagingBufferMemory);
+    VkDeviceSize AveModel::evict(VkCommandBuffer commandBuffer, bool idle) {
+        // Pool ranges are all or nothing, a model still in use keeps its geometry. A failed allocation (no
+        // command buffer) needs memory back right away, but the pool only hands ranges back frames later and
+        // shrinks at a later compaction, so the residency manager moves on to resources that can free now.
+        if (!idle || evicted_ || !canReload() || commandBuffer == VK_NULL_HANDLE) {
+            return 0;
+        }
+        aveDevice.getUploadQueue().wait(uploadToken_);
+        aveDevice.getGeometryPool().free(geometry_);
+        evicted_ = true;
+        return geometryBytes_;
+    }
+
+    void AveModel::reload() {
+        AveGeometryPool& geometryPool = aveDevice.getGeometryPool();
+        try {
+            if (!sourcePath_.empty()) {
+                AveMeshFile meshFile{sourcePath_};
+                geometry_ = geometryPool.allocate(meshFile.vertexData(), meshFile.vertexCount(), stride_,
+                    meshFile.indices(), meshFile.indexCount(), uploadToken_);
+            } else {
+                geometry_ = geometryPool.allocate(origVertices_.data(), dynamicVertices_ ? 0 : vertexCount, stride_,
+                    origIndices_.data(), indexCount, uploadToken_);
+            }
+        } catch (const AveOutOfDeviceMemory&) {
+            return; // stays evicted and is not drawn, tried again next frame
+        }
+        evicted_ = false;
+        aveDevice.getResidency().setSize(residency_, geometryBytes_);
+    }
 
-        void* data;
 
-        vkMapMemory(aveDevice.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
+    void AveModel::draw(VkCommandBuffer commandBuffer){
+        // vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
 
-        memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-        vkUnmapMemory(aveDevice.device(), stagingBufferMemory);
+        if (instanceCount_ == 0) {
+            return;
+        }
 
-        aveDevice.createBuffer(
-            bufferSize,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            vertexBuffer,
-            vertexBufferMemory
-        );
+        AveGeometryPool& geometryPool = aveDevice.getGeometryPool();
+        uint32_t firstIndex = geometryPool.getFirstIndex(geometry_);
+        int32_t vertexOffset = geometryPool.getVertexOffset(geometry_);
+        if (dynamicVertices_) {
+            dynamicVertices_->bind(commandBuffer, dynamicFrame_);
+            vertexOffset = 0;
+        }
+        if (instances_) {
+            instances_->bind(commandBuffer, instanceFrame_, INSTANCE_BINDING);
+        }
 
-        aveDevice.copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+        // Meshlets are culled for the model's own transform and cooked vertices, instances and dynamic models draw
+        // the whole level
+        const MeshLod& lod = lods_[currentLod_];
+        if (lod.meshletCount == 0 || instances_ || dynamicVertices_) {
+            vkCmdDrawIndexed(commandBuffer, lod.indexCount, instanceCount_, firstIndex + lod.firstIndex, vertexOffset, 0);
+        } else {
+            for (const DrawRange& range : drawRanges_) {
+                vkCmdDrawIndexed(commandBuffer, range.indexCount, instanceCount_, firstIndex + range.firstIndex, vertexOffset, 0);
+            }
+        }
 
-        vkDestroyBuffer(aveDevice.device(), stagingBuffer, nullptr);
-        vkFreeMemory(aveDevice.device(), stagingBufferMemory, nullptr);
+        if (dynamicVertices_ || instances_) {
+            geometryPool.bind(commandBuffer); // back to the shared buffers for the models drawn after this one
+        }
     }
 
-    void AveModel::createIndexBuffer(const std::vector<u_int32_t> &indices) {
-        indexCount = static_cast<u_int32_t>(indices.size());
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        aveDevice.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    void AveModel::enableInstancing(uint32_t maxInstances) {
+        std::vector<InstanceData> instances(maxInstances);
+        instances_ = std::make_unique<AveDynamicVertexBuffer>(aveDevice, instances.data(), maxInstances, sizeof(InstanceData));
+        instanceCount_ = 0;
+    }
 
-        void* data;
-        vkMapMemory(aveDevice.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, indices.data(), (size_t) bufferSize);
-        vkUnmapMemory(aveDevice.device(), stagingBufferMemory);
+    void AveModel::setInstances(uint32_t firstInstance, const InstanceData* instances, uint32_t count) {
+        if (!instances_ || uint64_t{firstInstance} + count > instances_->getVertexCount()) {
+            throw std::runtime_error("instances outside the model's instance buffer!");
+        }
+        instances_->write(firstInstance, instances, count);
+    }
 
-        aveDevice.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+    void AveModel::setInstanceCount(uint32_t count) {
+        if (!instances_ || count > instances_->getVertexCount()) {
+            throw std::runtime_error("instance count exceeds the model's instance buffer!");
+        }
+        instanceCount_ = count;
+    }
 
-        aveDevice.copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+    glm::vec4 AveModel::getInstanceBounds(const glm::vec4& sphere, float& maxInstanceScale) {
+        // Instance transforms apply after the model matrix, so each instance moves the model's world sphere.
+        // The result is centered on the box around the instance spheres, which stays tight for a grid.
+        const InstanceData* instances = static_cast<const InstanceData*>(instances_->data());
+        glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+        glm::vec3 boundsMax{std::numeric_limits<float>::lowest()};
+        maxInstanceScale = 0.0f;
+        for (uint32_t i = 0; i < instanceCount_; i++) {
+            glm::vec3 center = glm::vec3(instances[i].transform * glm::vec4(glm::vec3{sphere}, 1.0f));
+            maxInstanceScale = std::max(maxInstanceScale, maxScale(instances[i].transform));
+            float radius = sphere.w * maxScale(instances[i].transform);
+            boundsMin = glm::min(boundsMin, center - radius);
+            boundsMax = glm::max(boundsMax, center + radius);
+        }
 
-        vkDestroyBuffer(aveDevice.device(), stagingBuffer, nullptr);
-        vkFreeMemory(aveDevice.device(), stagingBufferMemory, nullptr);
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        float radius = 0.0f;
+        for (uint32_t i = 0; i < instanceCount_; i++) {
+            glm::vec3 instanceCenter = glm::vec3(instances[i].transform * glm::vec4(glm::vec3{sphere}, 1.0f));
+            radius = std::max(radius, glm::length(instanceCenter - center) + sphere.w * maxScale(instances[i].transform));
+        }
+        return glm::vec4{center, radius};
     }
 
+    void AveModel::setLods(const std::vector<MeshLod>& lods, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+        assert(!lods.empty() && "A model needs at least one level of detail");
+        for (const MeshLod& lod : lods) {
+            assert(uint64_t{lod.firstIndex} + lod.indexCount <= indexCount && "LOD range outside the index buffer");
+            assert(uint64_t{lod.firstMeshlet} + lod.meshletCount <= meshlets_.size() && "Set meshlets before the LODs that use them");
+        }
+        lods_ = lods;
+        currentLod_ = 0;
+        boundsCenter_ = (boundsMin + boundsMax) * 0.5f;
+        boundsRadius_ = glm::length(boundsMax - boundsMin) * 0.5f;
+    }
 
-    void AveModel::createUniformBuffers() {
-        VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+    void AveModel::selectLod(const glm::vec3& eye, float errorScale, float pixelsPerRadian) {
+        if (lods_.size() < 2) {
+            return;
+        }
 
-        uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-        uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-        uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+        // Distance to the nearest point of the world bounds (the nearest instance for instanced models), clamped so
+        // the camera inside the sphere keeps LOD0
+        float distance = glm::length(glm::vec3{worldSphere_} - eye) - worldSphere_.w;
+        if (distance <= 0.0f) {
+            currentLod_ = 0;
+            return;
+        }
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            aveDevice.createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+        // Errors are in object space, scaled like the bounds so a model drawn twice as large refines as early as a closer one
+        auto pixelError = [&](size_t level) { return lods_[level].error * errorScale / distance * pixelsPerRadian; };
 
-            vkMapMemory(aveDevice.device(), uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
+        size_t level = currentLod_;
+        while (level > 0 && pixelError(level) > LOD_PIXEL_ERROR) {
+            level--;
         }
+        while (level + 1 < lods_.size() && pixelError(level + 1) <= LOD_PIXEL_ERROR * LOD_HYSTERESIS) {
+            level++;
+        }
+        currentLod_ = level;
     }
 
-    void AveModel::draw(VkCommandBuffer commandBuffer){
-        // vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+    void AveModel::updateModel(uint32_t frameIndex) {
+        if (instances_) {
+            instanceFrame_ = frameIndex;
+            instances_->flush(frameIndex);
+        }
+        if (!dynamicVertices_) {
+            return; // static geometry lives in the geometry pool
+        }
 
-        vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+        dynamicFrame_ = frameIndex;
+        dynamicVertices_->flush(frameIndex);
     }
 
-    void AveModel::bind(VkCommandBuffer commandBuffer){
-        VkBuffer buffers[] = {vertexBuffer};
-
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    void AveModel::writeVertices(uint32_t firstVertex, const Vertex* vertices, uint32_t count) {
+        assert(dynamicVertices_ && "only dynamic models can rewrite their vertices");
+        dynamicVertices_->write(firstVertex, vertices, count);
     }
 
-    void AveModel::updateModel() {
-
-        static auto startTime = std::chrono::high_resolution_clock::now();
+    void AveModel::updateUniformBuffer(const glm::mat4& world, const glm::mat4& view, const glm::mat4& proj, VkExtent2D swapChainExtent) {
+        aveDevice.getResidency().touch(residency_);
+        if (evicted_) {
+            reload();
+        }
 
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+        glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
 
-        // const std::vector<Vertex> vertices_;
-        // std::cout << origVertices_[0].pos.y << std::endl;
-        for(size_t i = 0; i < origVertices_.size(); i++){
-            stagingVertices_[i].pos.y = origVertices_[i].pos.z + 2.0 * sin(time);
+        UniformBufferObject ubo{};
+        ubo.model = world * dequantMatrix_;
+        ubo.view = view;
+        ubo.proj = proj;
+
+        float scale = maxScale(world);
+        worldSphere_ = glm::vec4{glm::vec3(world * glm::vec4(boundsCenter_, 1.0f)), boundsRadius_ * scale};
+        if (instances_ && instanceCount_ > 0) {
+            float instanceScale;
+            worldSphere_ = getInstanceBounds(worldSphere_, instanceScale);
+            scale *= instanceScale;
         }
-        // std::cout << stagingVertices_[0].pos.y << std::endl;
 
-        vertexCount = static_cast<uint32_t>(stagingVertices_.size());
-        assert(vertexCount >= 3 && "Vertex Count must be greater than 3");
-        VkDeviceSize bufferSize = sizeof(stagingVertices_[0]) * vertexCount;
+        // |proj[1][1]| is 1 / tan(fovy / 2), so this converts an angle near the view axis into pixels
+        selectLod(eye, scale, 0.5f * swapChainExtent.height * std::abs(proj[1][1]));
 
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        aveDevice.createBuffer(
-            bufferSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            stagingBuffer,
-            stagingBufferMemory);
-        void* data;
+        const MeshLod& lod = lods_[currentLod_];
+        if (lod.meshletCount > 0 && !instances_ && !dynamicVertices_) {
+            // Cone culling matches the pipeline's VK_CULL_MODE_BACK_BIT, it only skips triangles the rasterizer would drop
+            glm::vec3 cameraPosition = glm::vec3(glm::inverse(world) * glm::vec4(eye, 1.0f));
+            AveMeshlets::cull(&meshlets_[lod.firstMeshlet], lod.meshletCount, proj * view * world, cameraPosition,
+                true, drawRanges_, &cullStats_);
+        }
 
-        vkMapMemory(aveDevice.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
+        uniformOffset_ = aveDevice.getUniformRing().push(ubo);
+    }
 
-        memcpy(data, stagingVertices_.data(), static_cast<size_t>(bufferSize));
-        vkUnmapMemory(aveDevice.device(), stagingBufferMemory);
 
-        aveDevice.copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+    std::unique_ptr<AveModel> AveModel::createModelFromObjFile(AveDevice& device, const std::string& filePath, VertexFormat preferredFormat){
+        std::vector<Vertex> vertices;
+        std::vector<u_int32_t> indices;
+        ObjLoadStats stats{};
 
-        vkDestroyBuffer(aveDevice.device(), stagingBuffer, nullptr);
-        vkFreeMemory(aveDevice.device(), stagingBufferMemory, nullptr);
+        AveObjLoader::load(filePath, vertices, indices, &stats);
 
-    }
+        std::cout << "loaded " << filePath << ": " << stats.vertexCount << " vertices, " << stats.triangleCount
+                  << " triangles in " << stats.totalSeconds() * 1000.0 << " ms (" << stats.threadCount << " threads)" << std::endl;
 
-    void AveModel::updateUniformBuffer(uint32_t currentImage, VkExtent2D swapChainExtent) {
-        static auto startTime = std::chrono::high_resolution_clock::now();
+        // OBJ corners are deduplicated by index, this also merges corners that only share values
+        WeldStats weldStats = AveVertexWelder::weld(vertices, indices);
+        std::cout << "welded " << filePath << ": " << weldStats.verticesIn << " -> " << weldStats.verticesOut
+                  << " vertices in " << weldStats.seconds * 1000.0 << " ms" << std::endl;
 
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+        MeshOptimizationReport report = AveMeshOptimizer::optimizeMesh(vertices, indices);
+        std::cout << "optimized " << filePath << ": ACMR " << report.before.acmr << " -> " << report.after.acmr
+                  << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << std::endl;
 
-        UniformBufferObject ubo{};
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(1.0, 0.0, sin(time)));
-        ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 10.0f);
-        ubo.proj[1][1] *= -1;
+        std::vector<Meshlet> meshlets;
+        std::vector<MeshLod> lods = AveMeshSimplifier::buildLodChain(vertices, indices, &meshlets);
+        std::cout << "built " << lods.size() << " LODs for " << filePath << ":";
+        for (const MeshLod& lod : lods) {
+            std::cout << " " << lod.indexCount / 3;
+        }
+        std::cout << " triangles, " << meshlets.size() << " meshlets" << std::endl;
 
-        memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+        glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+        glm::vec3 boundsMax{std::numeric_limits<float>::lowest()};
+        for (const Vertex& vertex : vertices) {
+            boundsMin = glm::min(boundsMin, vertex.pos);
+            boundsMax = glm::max(boundsMax, vertex.pos);
+        }
 
+        std::unique_ptr<AveModel> model;
+        if (preferredFormat == VertexFormat::Packed && canPackVertices(vertices.data(), vertices.size())) {
+            std::vector<PackedVertex> packed;
+            glm::mat4 dequantMatrix = packVertices(vertices.data(), vertices.size(), packed);
+            model = std::make_unique<AveModel>(device, VertexFormat::Packed, packed.data(), static_cast<uint32_t>(packed.size()),
+                indices.data(), static_cast<uint32_t>(indices.size()), dequantMatrix);
+        } else {
+            model = std::make_unique<AveModel>(device, vertices, indices);
+        }
+        model->setMeshlets(meshlets);
+        model->setLods(lods, boundsMin, boundsMax);
+
+        return model;
     }
 
+    std::unique_ptr<AveModel> AveModel::createModelFromMeshFile(AveDevice& device, const std::string& filePath){
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        // The mapping only has to outlive the staging copies made by the constructor
+        AveMeshFile meshFile{filePath};
+        auto model = std::make_unique<AveModel>(device, meshFile.vertexFormat(), meshFile.vertexData(), meshFile.vertexCount(),
+            meshFile.indices(), meshFile.indexCount(), meshFile.dequantMatrix());
+        model->sourcePath_ = filePath;
+        const AveMeshHeader& header = meshFile.header();
+        model->setMeshlets(std::vector<Meshlet>(meshFile.meshlets(), meshFile.meshlets() + meshFile.meshletCount()));
+        model->setLods(std::vector<MeshLod>(meshFile.lods(), meshFile.lods() + meshFile.lodCount()),
+            glm::vec3{header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]},
+            glm::vec3{header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]});
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        std::cout << "loaded " << filePath << ": " << meshFile.vertexCount() << " vertices, " << meshFile.indexCount() / 3
+                  << " triangles in " << std::chrono::duration<double, std::milli>(endTime - startTime).count() << " ms" << std::endl;
+
+        return model;
+    }
 
     // AveModel* AveModel::createPlantModel(AveDevice& device, std::string stringrepr){
     //     std::vector<Vertex> vertices;
@@ -191,6 +356,13 @@ namespace ave {
     std::unique_ptr<AveModel> AveModel::createCubeModel(AveDevice& device){
         std::vector<Vertex> vertices;
         std::vector<u_int32_t> indices;
+        getCubeGeometry(vertices, indices);
+        return std::make_unique<AveModel>(device, vertices, indices);
+    }
+
+    void AveModel::getCubeGeometry(std::vector<Vertex>& vertices, std::vector<u_int32_t>& indices){
+        vertices.clear();
+        indices.clear();
 
         vertices.insert(vertices.end(),{
             // top face
@@ -240,7 +412,7 @@ namespace ave {
                 20, 21, 22, 22, 23, 20
         });
 
-        return std::make_unique<AveModel>(device, vertices, indices);
+        AveMeshOptimizer::optimizeMesh(vertices, indices);
     }
 
 
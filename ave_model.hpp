@@ -7,6 +7,9 @@
 
 #include "ave_constants.h"
 #include "ave_device.hpp"
+#include "ave_dynamic_vertex_buffer.hpp"
+#include "ave_vertex_layout.hpp"
+#include "ave_meshlet.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
@@ -16,85 +19,23 @@
 #include <vector>
 #include <cassert>
 #include <cstring>
+#include <limits>
 #include <memory>
 #include <chrono>
-
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include <string>
 
 
 
 namespace ave {
 
 
-    struct Vertex {
-        glm::vec3 pos;
-        glm::vec3 normal;
-        glm::vec3 color;
-        glm::vec2 texCoord;
-
-        static VkVertexInputBindingDescription getBindingDescription() {
-            VkVertexInputBindingDescription bindingDescription{};
-            bindingDescription.binding = 0;
-            bindingDescription.stride = sizeof(Vertex);
-            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // VK_VERTEX_INPUT_RATE_INSTANCE for instanced rendering
-            return bindingDescription;
-        }
-
-
-        static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions() {
-            std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
-            attributeDescriptions[0].binding = 0;
-            attributeDescriptions[0].location = 0;
-            attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-
-            attributeDescriptions[1].binding = 0;
-            attributeDescriptions[1].location = 1;
-            attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attributeDescriptions[1].offset = offsetof(Vertex, normal);
-
-
-            attributeDescriptions[2].binding = 0;
-            attributeDescriptions[2].location = 2;
-            attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attributeDescriptions[2].offset = offsetof(Vertex, color);
-
-            attributeDescriptions[3].binding = 0;
-            attributeDescriptions[3].location = 3;
-            attributeDescriptions[3].format = VK_FORMAT_R32G32_SFLOAT;
-            attributeDescriptions[3].offset = offsetof(Vertex, texCoord);
-
-
-            return attributeDescriptions;
-        }
-
-        Vertex operator+(const Vertex& other){
-            return {pos+other.pos, color+other.color};
-        }
-        Vertex operator-(const Vertex& other){
-            return {pos - other.pos, color - other.color};
-        }
-        Vertex operator/(float f){
-            return {pos / f, color / f};
-        }
-        Vertex operator*(float f){
-            return {pos * f, color * f};
-        }
-
-        bool operator==(const Vertex& other) const {
-            return pos == other.pos && color == other.color && texCoord == other.texCoord;
-        }
-    };
-
-    struct Vertex_hash {
-        size_t operator()(Vertex const& vertex) const {
-            return ((std::hash<glm::vec3>()(vertex.pos) ^
-                   (std::hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                   (std::hash<glm::vec2>()(vertex.texCoord) << 1) ^
-                   (std::hash<glm::vec2>()(vertex.normal) >> 1);;
-        }
+    // Index range of one level of detail inside a model's index buffer, all levels share the vertex buffer
+    struct MeshLod {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float error; // object space simplification error, 0 for the full resolution level
+        uint32_t firstMeshlet; // meshlets covering this level, none means it is drawn as one range
+        uint32_t meshletCount;
     };
 
     struct UniformBufferObject {
@@ -106,21 +47,71 @@ namespace ave {
 
     class AveModel {
         public:
-            AveModel(AveDevice& device, const std::vector<Vertex> &vertices, const std::vector<u_int32_t> &indices);
+            // dynamic keeps the vertices in an AveDynamicVertexBuffer the caller rewrites through writeVertices, instead
+            // of the geometry pool
+            AveModel(AveDevice& device, const std::vector<Vertex> &vertices, const std::vector<u_int32_t> &indices, bool dynamic = false);
+            // Uploads straight from caller owned memory (e.g. a mapped .avemesh) in any VertexFormat, no CPU copy is kept.
+            // dequantMatrix maps packed positions back to object space.
+            AveModel(AveDevice& device, VertexFormat format, const void* vertexData, uint32_t vertexCount,
+                const u_int32_t* indices, uint32_t indexCount, const glm::mat4& dequantMatrix = glm::mat4{1.0f});
             ~AveModel();
 
             AveModel(const AveModel&) = delete;
             AveModel& operator=(const AveModel&) = delete;
 
-            void bind(VkCommandBuffer commandBuffer);
-            void updateUniformBuffer(uint32_t currentImage, VkExtent2D swapChainExtent);
-            void updateModel();
+            // Pushes this frame's UniformBufferObject into the device's uniform ring, call after the ring's beginFrame.
+            // world places the model (e.g. straight from AveScene), proj is the Vulkan one with Y already flipped.
+            // Also picks the level of detail that draw() uses for this frame, and counts as a use for AveResidency:
+            // geometry it evicted is uploaded again here.
+            void updateUniformBuffer(const glm::mat4& world, const glm::mat4& view, const glm::mat4& proj, VkExtent2D swapChainExtent);
+            // Brings this frame's copy of the instances and of a dynamic model's vertices up to date with what was
+            // written since. Call once the frame's in flight fence was waited on.
+            void updateModel(uint32_t frameIndex);
+
+            // Dynamic models only. Vertices are written to a CPU side copy and reach the GPU through updateModel, only
+            // the spans written are copied. Either write whole runs, or change them in place through getVertices and
+            // mark them. Meshlets are never culled for dynamic models, their cones and bounds would go stale as the
+            // vertices move, and the bounds given to setLods must cover every pose the caller moves them to.
+            void writeVertices(uint32_t firstVertex, const Vertex* vertices, uint32_t count);
+            Vertex* getVertices() { return static_cast<Vertex*>(dynamicVertices_->data()); }
+            void markVerticesDirty(uint32_t firstVertex, uint32_t count) { dynamicVertices_->markDirty(firstVertex, count); }
+            bool isDynamic() const { return dynamicVertices_ != nullptr; }
 
             void draw(VkCommandBuffer commandBuffer);
 
-            VkBuffer& getUniformBuffer(size_t i) { return uniformBuffers[i]; }
-
-            // static AveModel* createModelFromObjFile(AveDevice& device, const std::string& filePath);
+            // Draws the mesh once per instance from a per frame mapped stream of up to maxInstances InstanceData,
+            // one draw for a whole forest. Instances start out as the default one and none are drawn until
+            // setInstanceCount. Writes reach the GPU through updateModel and the bounds through updateUniformBuffer,
+            // so set them before both each frame. The world sphere then covers every instance and meshlets are not
+            // culled, since they are placed by the model's transform alone.
+            void enableInstancing(uint32_t maxInstances);
+            void setInstances(uint32_t firstInstance, const InstanceData* instances, uint32_t count);
+            void setInstanceCount(uint32_t count);
+            uint32_t getInstanceCount() const { return instanceCount_; }
+
+            // Vertex and index data arrive through the upload queue, draw only once this returns true. Geometry lives
+            // in the device's AveGeometryPool, bind that once per frame before drawing any model.
+            bool isReady() const { return !evicted_ && aveDevice.getUploadQueue().isComplete(uploadToken_); }
+
+            // lods index into this model's index buffer, LOD0 first; bounds are in object space
+            void setLods(const std::vector<MeshLod>& lods, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+            size_t getLodCount() const { return lods_.size(); }
+            size_t getCurrentLod() const { return currentLod_; }
+
+            // Per level clusters referenced by MeshLod::firstMeshlet/meshletCount, culled every frame on the CPU
+            void setMeshlets(const std::vector<Meshlet>& meshlets) { meshlets_ = meshlets; }
+            const MeshletCullStats& getCullStats() const { return cullStats_; }
+
+            // Dynamic offset of this frame's uniform data, bind the frame's descriptor set with it before draw()
+            uint32_t getUniformOffset() const { return uniformOffset_; }
+            // Bounding sphere in world space (xyz center, w radius) as placed by the last updateUniformBuffer, around
+            // all drawn instances for instanced models
+            const glm::vec4& getWorldSphere() const { return worldSphere_; }
+            VertexFormat getVertexFormat() const { return vertexFormat_; }
+
+            // Packs the mesh when preferredFormat is Packed and the mesh allows it (see canPackVertices)
+            static std::unique_ptr<AveModel> createModelFromObjFile(AveDevice& device, const std::string& filePath, VertexFormat preferredFormat = VertexFormat::Packed);
+            static std::unique_ptr<AveModel> createModelFromMeshFile(AveDevice& device, const std::string& filePath);
 
             // static AveModel* createPlantModel(AveDevice& device, std::string stringrepr);
 
@@ -128,33 +119,65 @@ namespace ave {
 
 
             static std::unique_ptr<AveModel> createCubeModel(AveDevice& device);
+            // Unit cube around the origin, for callers that place it in the geometry pool themselves
+            static void getCubeGeometry(std::vector<Vertex>& vertices, std::vector<u_int32_t>& indices);
 
             // static AveModel* createCPyramidModel(AveDevice& device);
 
 
 
+            // Coarsest level whose error projects to at most this many pixels. Coarser levels are only
+            // entered below LOD_HYSTERESIS times the threshold so the level does not flicker at the boundary.
+            static constexpr float LOD_PIXEL_ERROR = 1.0f;
+            static constexpr float LOD_HYSTERESIS = 0.75f;
+
         private:
-            void createVertexBuffers(const std::vector<Vertex> &vertices);
-            void createIndexBuffer(const std::vector<u_int32_t>& indices);
-            void createUniformBuffers();
+            // errorScale turns the object space MeshLod::error into world units, the largest axis scale of the transform
+            void selectLod(const glm::vec3& eye, float errorScale, float pixelsPerRadian);
+            // Sphere around every drawn instance of the model's world sphere, and the largest scale of their transforms
+            glm::vec4 getInstanceBounds(const glm::vec4& sphere, float& maxInstanceScale);
+            void createGeometry(const void* vertices, uint32_t vertexTotal, uint32_t stride, const u_int32_t* indices, uint32_t indexTotal);
+            // Only models that can rebuild their geometry (CPU copy or .avemesh) are evicted, the rest is just counted
+            bool canReload() const { return !origIndices_.empty() || !sourcePath_.empty(); }
+            VkDeviceSize evict(VkCommandBuffer commandBuffer, bool idle);
+            void reload();
             AveDevice& aveDevice;
-            VkBuffer vertexBuffer;
-            VkDeviceMemory vertexBufferMemory;
+            GeometryHandle geometry_;
             uint32_t vertexCount;
-
-            VkBuffer indexBuffer;
-            VkDeviceMemory indexBufferMemory;
             u_int32_t indexCount;
+            uint32_t stride_ = 0;
+            UploadToken uploadToken_ = 0;
 
-            std::vector<VkBuffer> uniformBuffers;
-            std::vector<VkDeviceMemory> uniformBuffersMemory;
-            std::vector<void*> uniformBuffersMapped;
+            ResidencyId residency_ = UINT32_MAX;
+            VkDeviceSize geometryBytes_ = 0; // held in the geometry pool while not evicted
+            bool evicted_ = false;
+            std::string sourcePath_; // .avemesh the geometry is reloaded from
+
+            uint32_t uniformOffset_ = 0;
+
+            std::unique_ptr<AveDynamicVertexBuffer> instances_; // only instanced models, the rest use the pool's default
+            uint32_t instanceCount_ = 1;
+            uint32_t instanceFrame_ = 0;
 
             std::vector<Vertex> origVertices_;
-            std::vector<Vertex> stagingVertices_;
+            std::unique_ptr<AveDynamicVertexBuffer> dynamicVertices_;
+            uint32_t dynamicFrame_ = 0;
 
             std::vector<u_int32_t> origIndices_;
 
+            VertexFormat vertexFormat_ = VertexFormat::Full;
+            glm::mat4 dequantMatrix_{1.0f};
+
+            std::vector<MeshLod> lods_;
+            size_t currentLod_ = 0;
+            glm::vec3 boundsCenter_{0.0f};
+            float boundsRadius_ = std::numeric_limits<float>::infinity(); // never culled until setLods gives bounds
+            glm::vec4 worldSphere_{0.0f, 0.0f, 0.0f, std::numeric_limits<float>::infinity()};
+
+            std::vector<Meshlet> meshlets_;
+            std::vector<DrawRange> drawRanges_;
+            MeshletCullStats cullStats_;
+
 
 
 
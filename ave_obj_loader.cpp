@@ -0,0 +1,453 @@
+#include "ave_obj_loader.hpp"
+#include "ave_mapped_file.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace ave {
+    namespace {
+        // Chunks smaller than this are not worth a thread
+        constexpr size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+        // One face corner, 0-based attribute indices, -1 when the attribute is absent
+        struct ObjCorner {
+            int32_t v;
+            int32_t vt;
+            int32_t vn;
+
+            bool operator==(const ObjCorner& other) const {
+                return v == other.v && vt == other.vt && vn == other.vn;
+            }
+        };
+
+        struct ObjCorner_hash {
+            size_t operator()(const ObjCorner& corner) const {
+                uint64_t h = static_cast<uint32_t>(corner.v) * 0x9E3779B97F4A7C15ull;
+                h ^= (static_cast<uint32_t>(corner.vt) + 0x632BE59BD9B4E019ull) + (h << 6) + (h >> 2);
+                h ^= (static_cast<uint32_t>(corner.vn) + 0x85EBCA77C2B2AE63ull) + (h << 6) + (h >> 2);
+                return static_cast<size_t>(h);
+            }
+        };
+
+        enum RelativeBits : uint8_t {
+            RELATIVE_V = 1 << 0,
+            RELATIVE_VT = 1 << 1,
+            RELATIVE_VN = 1 << 2,
+        };
+
+        struct ObjChunk {
+            const char* begin;
+            const char* end;
+
+            std::vector<float> positions; // xyz
+            std::vector<float> colors;    // rgb, white unless the file carries vertex colors
+            std::vector<float> texcoords; // uv
+            std::vector<float> normals;   // xyz
+
+            // Negative OBJ indices are relative to the attributes seen so far, which depends on the
+            // chunks before this one. They are stored chunk local and fixed up once counts are known.
+            std::vector<ObjCorner> corners; // 3 per triangle
+            std::vector<uint8_t> relative;  // per corner RelativeBits, empty when the chunk has none
+            bool hasRelative = false;
+
+            std::vector<ObjCorner> uniqueCorners;
+            std::vector<u_int32_t> localIndices; // into uniqueCorners
+            std::vector<u_int32_t> remap;        // uniqueCorners -> global vertex index
+
+            size_t positionBase = 0;
+            size_t texcoordBase = 0;
+            size_t normalBase = 0;
+            size_t indexBase = 0;
+        };
+
+        template <typename Fn>
+        void parallelFor(size_t count, Fn&& fn) {
+            if (count == 1) {
+                fn(0);
+                return;
+            }
+            std::vector<std::thread> workers;
+            workers.reserve(count);
+            for (size_t i = 0; i < count; i++) {
+                workers.emplace_back([&fn, i]() { fn(i); });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+
+        inline void skipSpaces(const char*& p, const char* end) {
+            while (p < end && isSpace(*p)) p++;
+        }
+
+        inline void skipLine(const char*& p, const char* end) {
+            while (p < end && *p != '\n') p++;
+            if (p < end) p++;
+        }
+
+        // Hand rolled float parsing, strtof is locale aware and dominates the profile on large files
+        bool parseFloat(const char*& p, const char* end, float& out) {
+            skipSpaces(p, end);
+            const char* start = p;
+
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                negative = *p == '-';
+                p++;
+            }
+
+            double value = 0.0;
+            bool anyDigits = false;
+            while (p < end && *p >= '0' && *p <= '9') {
+                value = value * 10.0 + (*p - '0');
+                p++;
+                anyDigits = true;
+            }
+
+            if (p < end && *p == '.') {
+                p++;
+                double scale = 0.1;
+                while (p < end && *p >= '0' && *p <= '9') {
+                    value += (*p - '0') * scale;
+                    scale *= 0.1;
+                    p++;
+                    anyDigits = true;
+                }
+            }
+
+            if (!anyDigits) {
+                p = start;
+                return false;
+            }
+
+            if (p < end && (*p == 'e' || *p == 'E')) {
+                p++;
+                bool negativeExponent = false;
+                if (p < end && (*p == '-' || *p == '+')) {
+                    negativeExponent = *p == '-';
+                    p++;
+                }
+                int exponent = 0;
+                while (p < end && *p >= '0' && *p <= '9') {
+                    exponent = exponent * 10 + (*p - '0');
+                    p++;
+                }
+                value *= std::pow(10.0, negativeExponent ? -exponent : exponent);
+            }
+
+            out = static_cast<float>(negative ? -value : value);
+            return true;
+        }
+
+        bool parseInt(const char*& p, const char* end, int32_t& out) {
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                negative = *p == '-';
+                p++;
+            }
+            if (p >= end || *p < '0' || *p > '9') {
+                return false;
+            }
+            int64_t value = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                value = value * 10 + (*p - '0');
+                p++;
+            }
+            out = static_cast<int32_t>(negative ? -value : value);
+            return true;
+        }
+
+        // Converts an OBJ index (1-based, or negative relative) into a 0-based index.
+        // Relative indices are resolved against the chunk local count and flagged for fix up.
+        inline int32_t resolveIndex(int32_t index, size_t localCount, uint8_t bit, uint8_t& relativeMask) {
+            if (index > 0) {
+                return index - 1;
+            }
+            relativeMask |= bit;
+            return static_cast<int32_t>(localCount) + index;
+        }
+
+        bool parseCorner(const char*& p, const char* end, ObjChunk& chunk, ObjCorner& corner, uint8_t& relativeMask) {
+            skipSpaces(p, end);
+            int32_t index;
+            if (!parseInt(p, end, index)) {
+                return false;
+            }
+            corner = {resolveIndex(index, chunk.positions.size() / 3, RELATIVE_V, relativeMask), -1, -1};
+
+            if (p < end && *p == '/') {
+                p++;
+                if (p < end && *p != '/' && parseInt(p, end, index)) {
+                    corner.vt = resolveIndex(index, chunk.texcoords.size() / 2, RELATIVE_VT, relativeMask);
+                }
+                if (p < end && *p == '/') {
+                    p++;
+                    if (parseInt(p, end, index)) {
+                        corner.vn = resolveIndex(index, chunk.normals.size() / 3, RELATIVE_VN, relativeMask);
+                    }
+                }
+            }
+            return true;
+        }
+
+        void pushCorner(ObjChunk& chunk, const ObjCorner& corner, uint8_t relativeMask) {
+            if (relativeMask != 0 && !chunk.hasRelative) {
+                chunk.relative.resize(chunk.corners.size(), 0);
+                chunk.hasRelative = true;
+            }
+            chunk.corners.push_back(corner);
+            if (chunk.hasRelative) {
+                chunk.relative.push_back(relativeMask);
+            }
+        }
+
+        void parseChunk(ObjChunk& chunk) {
+            const char* p = chunk.begin;
+            const char* end = chunk.end;
+
+            // Rough guess from the viking room: ~30 bytes per record
+            size_t expectedRecords = static_cast<size_t>(end - p) / 30;
+            chunk.positions.reserve(expectedRecords);
+            chunk.corners.reserve(expectedRecords);
+
+            std::vector<ObjCorner> polygon;
+            std::vector<uint8_t> polygonRelative;
+
+            while (p < end) {
+                skipSpaces(p, end);
+                if (p + 1 >= end) {
+                    break;
+                }
+
+                if (p[0] == 'v' && isSpace(p[1])) {
+                    p += 2;
+                    float x = 0.0f, y = 0.0f, z = 0.0f;
+                    parseFloat(p, end, x);
+                    parseFloat(p, end, y);
+                    parseFloat(p, end, z);
+                    chunk.positions.insert(chunk.positions.end(), {x, y, z});
+
+                    // Optional w or vertex color (xyzrgb), anything we can't read stays white
+                    float extra[4];
+                    int extraCount = 0;
+                    while (extraCount < 4 && parseFloat(p, end, extra[extraCount])) {
+                        extraCount++;
+                    }
+                    if (extraCount >= 3) {
+                        chunk.colors.insert(chunk.colors.end(), {extra[extraCount - 3], extra[extraCount - 2], extra[extraCount - 1]});
+                    } else {
+                        chunk.colors.insert(chunk.colors.end(), {1.0f, 1.0f, 1.0f});
+                    }
+                } else if (p[0] == 'v' && p[1] == 't' && p + 2 < end && isSpace(p[2])) {
+                    p += 3;
+                    float u = 0.0f, v = 0.0f;
+                    parseFloat(p, end, u);
+                    parseFloat(p, end, v);
+                    chunk.texcoords.insert(chunk.texcoords.end(), {u, v});
+                } else if (p[0] == 'v' && p[1] == 'n' && p + 2 < end && isSpace(p[2])) {
+                    p += 3;
+                    float x = 0.0f, y = 0.0f, z = 0.0f;
+                    parseFloat(p, end, x);
+                    parseFloat(p, end, y);
+                    parseFloat(p, end, z);
+                    chunk.normals.insert(chunk.normals.end(), {x, y, z});
+                } else if (p[0] == 'f' && isSpace(p[1])) {
+                    p += 2;
+                    polygon.clear();
+                    polygonRelative.clear();
+
+                    ObjCorner corner;
+                    uint8_t relativeMask = 0;
+                    while (parseCorner(p, end, chunk, corner, relativeMask)) {
+                        polygon.push_back(corner);
+                        polygonRelative.push_back(relativeMask);
+                        relativeMask = 0;
+                    }
+
+                    // Triangle fan, same as tinyobj's default triangulation
+                    for (size_t i = 1; i + 1 < polygon.size(); i++) {
+                        pushCorner(chunk, polygon[0], polygonRelative[0]);
+                        pushCorner(chunk, polygon[i], polygonRelative[i]);
+                        pushCorner(chunk, polygon[i + 1], polygonRelative[i + 1]);
+                    }
+                }
+
+                skipLine(p, end);
+            }
+        }
+
+        void fixupRelativeIndices(ObjChunk& chunk) {
+            for (size_t i = 0; i < chunk.relative.size(); i++) {
+                uint8_t mask = chunk.relative[i];
+                if (mask & RELATIVE_V) chunk.corners[i].v += static_cast<int32_t>(chunk.positionBase);
+                if (mask & RELATIVE_VT) chunk.corners[i].vt += static_cast<int32_t>(chunk.texcoordBase);
+                if (mask & RELATIVE_VN) chunk.corners[i].vn += static_cast<int32_t>(chunk.normalBase);
+            }
+        }
+
+        void deduplicateChunk(ObjChunk& chunk) {
+            std::unordered_map<ObjCorner, u_int32_t, ObjCorner_hash> uniqueCorners;
+            uniqueCorners.reserve(chunk.corners.size() / 2);
+            chunk.localIndices.reserve(chunk.corners.size());
+
+            for (const auto& corner : chunk.corners) {
+                auto inserted = uniqueCorners.emplace(corner, static_cast<u_int32_t>(chunk.uniqueCorners.size()));
+                if (inserted.second) {
+                    chunk.uniqueCorners.push_back(corner);
+                }
+                chunk.localIndices.push_back(inserted.first->second);
+            }
+
+            std::vector<ObjCorner>().swap(chunk.corners);
+        }
+    }
+
+    void AveObjLoader::load(
+        const std::string& filePath,
+        std::vector<Vertex>& vertices,
+        std::vector<u_int32_t>& indices,
+        ObjLoadStats* stats,
+        unsigned threadCount) {
+        AveMappedFile file{filePath};
+        loadFromMemory(file.data(), file.size(), vertices, indices, stats, threadCount);
+    }
+
+    void AveObjLoader::loadFromMemory(
+        const char* data,
+        size_t size,
+        std::vector<Vertex>& vertices,
+        std::vector<u_int32_t>& indices,
+        ObjLoadStats* stats,
+        unsigned threadCount) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, size / MIN_CHUNK_BYTES));
+
+        // Split on line boundaries so no record straddles two chunks
+        std::vector<ObjChunk> chunks(chunkCount);
+        const char* end = data + size;
+        const char* cursor = data;
+        for (size_t i = 0; i < chunkCount; i++) {
+            chunks[i].begin = cursor;
+            const char* chunkEnd = (i + 1 == chunkCount) ? end : data + (size * (i + 1)) / chunkCount;
+            chunkEnd = std::max(chunkEnd, cursor);
+            while (chunkEnd < end && *chunkEnd != '\n') chunkEnd++;
+            if (chunkEnd < end) chunkEnd++;
+            chunks[i].end = chunkEnd;
+            cursor = chunkEnd;
+        }
+
+        parallelFor(chunkCount, [&](size_t i) { parseChunk(chunks[i]); });
+
+        size_t positionCount = 0, texcoordCount = 0, normalCount = 0, cornerCount = 0;
+        for (auto& chunk : chunks) {
+            chunk.positionBase = positionCount;
+            chunk.texcoordBase = texcoordCount;
+            chunk.normalBase = normalCount;
+            chunk.indexBase = cornerCount;
+            positionCount += chunk.positions.size() / 3;
+            texcoordCount += chunk.texcoords.size() / 2;
+            normalCount += chunk.normals.size() / 3;
+            cornerCount += chunk.corners.size();
+        }
+
+        parallelFor(chunkCount, [&](size_t i) {
+            fixupRelativeIndices(chunks[i]);
+            deduplicateChunk(chunks[i]);
+        });
+
+        auto parseTime = std::chrono::high_resolution_clock::now();
+
+        // Chunks only know their own duplicates, fold the (much smaller) unique sets together
+        std::unordered_map<ObjCorner, u_int32_t, ObjCorner_hash> globalCorners;
+        std::vector<ObjCorner> globalUnique;
+        size_t uniqueEstimate = 0;
+        for (const auto& chunk : chunks) uniqueEstimate += chunk.uniqueCorners.size();
+        globalCorners.reserve(uniqueEstimate);
+        globalUnique.reserve(uniqueEstimate);
+
+        for (auto& chunk : chunks) {
+            chunk.remap.resize(chunk.uniqueCorners.size());
+            for (size_t i = 0; i < chunk.uniqueCorners.size(); i++) {
+                auto inserted = globalCorners.emplace(chunk.uniqueCorners[i], static_cast<u_int32_t>(globalUnique.size()));
+                if (inserted.second) {
+                    globalUnique.push_back(chunk.uniqueCorners[i]);
+                }
+                chunk.remap[i] = inserted.first->second;
+            }
+        }
+
+        // Attribute lookups cross chunk boundaries, so gather the raw attributes into one place first
+        std::vector<float> positions(positionCount * 3);
+        std::vector<float> colors(positionCount * 3);
+        std::vector<float> texcoords(texcoordCount * 2);
+        std::vector<float> normals(normalCount * 3);
+        indices.resize(cornerCount);
+
+        parallelFor(chunkCount, [&](size_t i) {
+            auto& chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase * 3);
+            std::copy(chunk.colors.begin(), chunk.colors.end(), colors.begin() + chunk.positionBase * 3);
+            std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + chunk.texcoordBase * 2);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase * 3);
+
+            for (size_t j = 0; j < chunk.localIndices.size(); j++) {
+                indices[chunk.indexBase + j] = chunk.remap[chunk.localIndices[j]];
+            }
+        });
+
+        vertices.resize(globalUnique.size());
+        std::atomic<bool> missingVertex{false};
+        size_t vertexSlice = (globalUnique.size() + chunkCount - 1) / chunkCount;
+        parallelFor(chunkCount, [&](size_t i) {
+            size_t first = i * vertexSlice;
+            size_t last = std::min(globalUnique.size(), first + vertexSlice);
+            for (size_t j = first; j < last; j++) {
+                const ObjCorner& corner = globalUnique[j];
+                Vertex vertex{};
+
+                if (corner.v < 0 || static_cast<size_t>(corner.v) >= positionCount) {
+                    missingVertex = true; // can't throw across the worker thread
+                    continue;
+                }
+                vertex.pos = {positions[3 * corner.v + 0], positions[3 * corner.v + 1], positions[3 * corner.v + 2]};
+                vertex.color = {colors[3 * corner.v + 0], colors[3 * corner.v + 1], colors[3 * corner.v + 2]};
+
+                if (corner.vt >= 0 && static_cast<size_t>(corner.vt) < texcoordCount) {
+                    vertex.texCoord = {texcoords[2 * corner.vt + 0], 1.0f - texcoords[2 * corner.vt + 1]};
+                }
+                if (corner.vn >= 0 && static_cast<size_t>(corner.vn) < normalCount) {
+                    vertex.normal = {normals[3 * corner.vn + 0], normals[3 * corner.vn + 1], normals[3 * corner.vn + 2]};
+                }
+
+                vertices[j] = vertex;
+            }
+        });
+
+        if (missingVertex) {
+            throw std::runtime_error("obj face references a missing vertex!");
+        }
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+
+        if (stats != nullptr) {
+            stats->fileBytes = size;
+            stats->triangleCount = cornerCount / 3;
+            stats->vertexCount = vertices.size();
+            stats->threadCount = static_cast<unsigned>(chunkCount);
+            stats->parseSeconds = std::chrono::duration<double>(parseTime - startTime).count();
+            stats->mergeSeconds = std::chrono::duration<double>(endTime - parseTime).count();
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ave_model.hpp"
+
+#include <string>
+#include <vector>
+
+namespace ave {
+
+    struct ObjLoadStats {
+        size_t fileBytes = 0;
+        size_t triangleCount = 0;
+        size_t vertexCount = 0; // after deduplication
+        unsigned threadCount = 0;
+        double parseSeconds = 0.0;
+        double mergeSeconds = 0.0;
+
+        double totalSeconds() const { return parseSeconds + mergeSeconds; }
+    };
+
+    // Memory mapped OBJ importer. The file is split into line aligned chunks which are parsed
+    // and deduplicated on all cores, then merged into a single Vertex/index stream for AveModel.
+    // Supports v (with optional vertex colors), vt, vn and polygonal f records; everything else is skipped.
+    class AveObjLoader {
+        public:
+            static void load(
+                const std::string& filePath,
+                std::vector<Vertex>& vertices,
+                std::vector<u_int32_t>& indices,
+                ObjLoadStats* stats = nullptr,
+                unsigned threadCount = 0);
+
+            static void loadFromMemory(
+                const char* data,
+                size_t size,
+                std::vector<Vertex>& vertices,
+                std::vector<u_int32_t>& indices,
+                ObjLoadStats* stats = nullptr,
+                unsigned threadCount = 0);
+    };
+}
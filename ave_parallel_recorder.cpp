@@ -0,0 +1,131 @@
+#include "ave_parallel_recorder.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+
+namespace ave {
+
+    AveParallelRecorder::AveParallelRecorder(VkDevice device, uint32_t queueFamily, AveThreadPool& threadPool)
+        : device_{device}, queueFamily_{queueFamily}, threadPool{threadPool} {
+        // The main thread records a range of its own
+        maxJobs_ = static_cast<uint32_t>(threadPool.threadCount()) + 1;
+    }
+
+    AveParallelRecorder::~AveParallelRecorder() {
+        for (auto& pools : framePools_) {
+            for (FramePool& framePool : pools) {
+                vkDestroyCommandPool(device_, framePool.pool, nullptr);
+            }
+        }
+    }
+
+    void AveParallelRecorder::beginFrame(uint32_t frameIndex) {
+        for (FramePool& framePool : framePools_[frameIndex]) {
+            vkResetCommandPool(device_, framePool.pool, 0);
+        }
+        currentFrame_ = frameIndex;
+    }
+
+    VkCommandBuffer AveParallelRecorder::getSecondary(uint32_t job) {
+        std::vector<FramePool>& pools = framePools_[currentFrame_];
+        while (pools.size() <= job) {
+            FramePool framePool{};
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolInfo.queueFamilyIndex = queueFamily_;
+            if (vkCreateCommandPool(device_, &poolInfo, nullptr, &framePool.pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create recording command pool!");
+            }
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = framePool.pool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(device_, &allocInfo, &framePool.commandBuffer) != VK_SUCCESS) {
+                vkDestroyCommandPool(device_, framePool.pool, nullptr);
+                throw std::runtime_error("failed to allocate secondary command buffer!");
+            }
+            pools.push_back(framePool);
+        }
+        return pools[job].commandBuffer;
+    }
+
+    void AveParallelRecorder::recordRenderPass(VkCommandBuffer primary, const VkRenderPassBeginInfo& renderPassInfo, uint32_t drawCount,
+        const RecordFunction& record) {
+        uint32_t jobCount = std::min(maxJobs_, drawCount / MIN_DRAWS_PER_BUFFER);
+        if (jobCount <= 1) {
+            vkCmdBeginRenderPass(primary, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            record(primary, 0, drawCount);
+            vkCmdEndRenderPass(primary);
+            lastBufferCount_ = 0;
+            return;
+        }
+
+        // Allocated up front, workers only record
+        std::vector<VkCommandBuffer> secondaries(jobCount);
+        for (uint32_t job = 0; job < jobCount; job++) {
+            secondaries[job] = getSecondary(job);
+        }
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderPassInfo.renderPass;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = renderPassInfo.framebuffer;
+
+        std::mutex mutex;
+        std::condition_variable done;
+        uint32_t pending = jobCount;
+        std::exception_ptr error;
+
+        auto recordRange = [&](uint32_t job) {
+            uint32_t firstDraw = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * job / jobCount);
+            uint32_t lastDraw = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * (job + 1) / jobCount);
+            try {
+                VkCommandBufferBeginInfo beginInfo{};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                beginInfo.pInheritanceInfo = &inheritanceInfo;
+                if (vkBeginCommandBuffer(secondaries[job], &beginInfo) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to begin secondary command buffer!");
+                }
+                record(secondaries[job], firstDraw, lastDraw - firstDraw);
+                if (vkEndCommandBuffer(secondaries[job]) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to record secondary command buffer!");
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock{mutex};
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock{mutex};
+            if (--pending == 0) {
+                done.notify_one();
+            }
+        };
+
+        for (uint32_t job = 1; job < jobCount; job++) {
+            threadPool.submit([&recordRange, job]() { recordRange(job); });
+        }
+        recordRange(0);
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            done.wait(lock, [&]() { return pending == 0; });
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        vkCmdBeginRenderPass(primary, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        vkCmdExecuteCommands(primary, jobCount, secondaries.data());
+        vkCmdEndRenderPass(primary);
+        lastBufferCount_ = jobCount;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ave_constants.h"
+#include "ave_thread_pool.hpp"
+
+#include <array>
+#include <functional>
+#include <vector>
+
+namespace ave {
+
+    // Records a render pass's draws on several threads. The draw list is split into contiguous ranges, each
+    // recorded into a secondary command buffer by its own thread, and the primary executes them in draw order.
+    // Every recording job owns a command pool per frame slot (pools are externally synchronized, so no two
+    // threads ever share one), and beginFrame() resets the slot's pools wholesale instead of freeing buffers.
+    //
+    // The main thread records the first range itself while workers of the thread pool take the rest. The pool
+    // is FIFO, so give the recorder one of its own: ranges queued behind long jobs (texture decodes) stall the frame.
+    // Below MIN_DRAWS_PER_BUFFER draws per range the split costs more than it saves, so short lists are
+    // recorded inline into the primary. Only takes a VkDevice, the benchmark drives it without a window.
+    class AveParallelRecorder {
+        public:
+            static constexpr uint32_t MIN_DRAWS_PER_BUFFER = 256;
+
+            // Records draws [firstDraw, firstDraw + drawCount) into commandBuffer, from any thread. Inherits
+            // nothing but the render pass: bind pipeline, descriptor sets, vertex buffers and dynamic state first.
+            using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount)>;
+
+            AveParallelRecorder(VkDevice device, uint32_t queueFamily, AveThreadPool& threadPool);
+            ~AveParallelRecorder();
+
+            AveParallelRecorder(const AveParallelRecorder&) = delete;
+            AveParallelRecorder& operator=(const AveParallelRecorder&) = delete;
+
+            // Call after the frame's in flight fence was waited on, its secondary buffers are recorded anew
+            void beginFrame(uint32_t frameIndex);
+
+            // Begins the render pass on primary, records drawCount draws through record and ends the render pass.
+            // Once per frame, the frame's secondary buffers are reused by the next call.
+            // Returns once every range is recorded, rethrows the first exception a range threw.
+            void recordRenderPass(VkCommandBuffer primary, const VkRenderPassBeginInfo& renderPassInfo, uint32_t drawCount,
+                const RecordFunction& record);
+
+            // Secondary buffers the last recordRenderPass() used, 0 when it recorded inline
+            uint32_t getLastBufferCount() const { return lastBufferCount_; }
+
+        private:
+            struct FramePool {
+                VkCommandPool pool = VK_NULL_HANDLE;
+                VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            };
+
+            VkCommandBuffer getSecondary(uint32_t job);
+
+            VkDevice device_;
+            uint32_t queueFamily_;
+            AveThreadPool& threadPool;
+            uint32_t maxJobs_;
+            uint32_t currentFrame_ = 0;
+            uint32_t lastBufferCount_ = 0;
+            std::array<std::vector<FramePool>, MAX_FRAMES_IN_FLIGHT> framePools_; // one per job, created on first use
+    };
+}
@@ -1,13 +1,11 @@
 #include "ave_pipeline.hpp"
 
 namespace ave {
-    AvePipeline::AvePipeline(AveDevice &device, const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo &configInfo): aveDevice(device) {
+    AvePipeline::AvePipeline(AveDevice &device, AvePipelineCache &pipelineCache, const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo &configInfo): aveDevice(device), avePipelineCache(pipelineCache) {
         createGraphicsPipeline(vertFilePath, fragFilePath, configInfo);
     }
 
     AvePipeline::~AvePipeline(){
-        vkDestroyShaderModule(aveDevice.device(), vertShaderModule, nullptr);
-        vkDestroyShaderModule(aveDevice.device(), fragShaderModule, nullptr);
         vkDestroyPipeline(aveDevice.device(), graphicsPipeline, nullptr);
     }
 
@@ -68,7 +66,7 @@ namespace ave {
         configInfo.rasterizationInfo.rasterizerDiscardEnable = VK_FALSE;
         configInfo.rasterizationInfo.polygonMode = VK_POLYGON_MODE_FILL;
         configInfo.rasterizationInfo.lineWidth = 1.0f;
-        configInfo.rasterizationInfo.cullMode = 0;//VK_CULL_MODE_BACK_BIT;
+        configInfo.rasterizationInfo.cullMode = VK_CULL_MODE_BACK_BIT; // AveModel's meshlet cone culling relies on this
         configInfo.rasterizationInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
         configInfo.rasterizationInfo.depthBiasEnable = VK_FALSE;
         configInfo.rasterizationInfo.depthBiasConstantFactor = 0.0f; // Optional
@@ -145,38 +143,22 @@ namespace ave {
         configInfo.depthStencilInfo.front = {};  // Optional
         configInfo.depthStencilInfo.back = {};   // Optional
 
-
+        setVertexLayout(configInfo, VertexFormat::Full);
 
     }
 
-    std::vector<char> AvePipeline::readFile(const std::string& filepath){
-        std::ifstream file(filepath, std::ios::ate | std::ios::binary);
-
-        if (!file.is_open()) {
-            throw std::runtime_error("failed to open file!");
-        }
-
-        size_t fileSize = (size_t) file.tellg();
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-
-        file.close();
-
-        return buffer;
+    void AvePipeline::setVertexLayout(PipelineConfigInfo& configInfo, VertexFormat format){
+        const VertexLayoutInfo& layout = getVertexLayout(format);
+        configInfo.bindingDescriptions = {layout.binding, instanceBindingDescription()};
+        configInfo.attributeDescriptions.assign(layout.attributes, layout.attributes + layout.attributeCount);
+        configInfo.attributeDescriptions.insert(configInfo.attributeDescriptions.end(), INSTANCE_ATTRIBUTES.begin(), INSTANCE_ATTRIBUTES.end());
     }
 
     void AvePipeline::createGraphicsPipeline(const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo& configInfo){
 
-        // Shaders
-        auto vertShaderCode = readFile("shaders/shader.vert.spv");
-        auto fragShaderCode = readFile("shaders/shader.frag.spv");
-
-        // VkShaderModule vertShaderModule;
-        createShaderModule(vertShaderCode, &vertShaderModule);
-        // VkShaderModule fragShaderModule;
-        createShaderModule(fragShaderCode, &fragShaderModule);
+        // Shaders, shared with every other pipeline through the cache
+        VkShaderModule vertShaderModule = avePipelineCache.getShaderModule(vertFilePath);
+        VkShaderModule fragShaderModule = avePipelineCache.getShaderModule(fragFilePath);
 
         VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
         vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -194,19 +176,15 @@ namespace ave {
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
-
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
         // vertexInputInfo.vertexBindingDescriptionCount = 0;
         // vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
         // vertexInputInfo.vertexAttributeDescriptionCount = 0;
         // vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(configInfo.bindingDescriptions.size());
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(configInfo.attributeDescriptions.size());
+        vertexInputInfo.pVertexBindingDescriptions = configInfo.bindingDescriptions.data();
+        vertexInputInfo.pVertexAttributeDescriptions = configInfo.attributeDescriptions.data();
 //pipelineconfig...
 
 
@@ -235,26 +213,9 @@ namespace ave {
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
         pipelineInfo.basePipelineIndex = -1; // Optional
 
-        if (vkCreateGraphicsPipelines(aveDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+        if (vkCreateGraphicsPipelines(aveDevice.device(), avePipelineCache.getPipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
 
-        // vkDestroyShaderModule(aveDevice.device(), fragShaderModule, nullptr);
-        // vkDestroyShaderModule(aveDevice.device(), vertShaderModule, nullptr);
-
-    }
-
-    void AvePipeline::createShaderModule(const std::vector<char>& shaderCode, VkShaderModule* shaderModule){
-        VkShaderModuleCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = shaderCode.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
-
-        // VkShaderModule shaderModule;
-        if (vkCreateShaderModule(aveDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create shader module!");
-        }
-
-        // return shaderModule;
     }
-}
\ No newline at end of file
+}
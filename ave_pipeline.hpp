@@ -2,8 +2,7 @@
 
 #include "ave_device.hpp"
 #include "ave_model.hpp"
-
-#include <fstream>
+#include "ave_pipeline_cache.hpp"
 
 namespace ave{
 
@@ -22,6 +21,8 @@ namespace ave{
         VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
         std::vector<VkDynamicState> dynamicStateEnables;
         VkPipelineDynamicStateCreateInfo dynamicStateInfo;
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
         VkPipelineLayout pipelineLayout = nullptr;
         VkRenderPass renderPass = nullptr;
         uint32_t subpass = 0;
@@ -29,7 +30,7 @@ namespace ave{
 
     class AvePipeline {
         public:
-            AvePipeline(AveDevice &device, const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo &configInfo);
+            AvePipeline(AveDevice &device, AvePipelineCache &pipelineCache, const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo &configInfo);
             ~AvePipeline();
 
             AvePipeline(const AvePipeline&) = delete;
@@ -38,17 +39,13 @@ namespace ave{
             void bind(VkCommandBuffer commandBuffer);
 
             static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
+            static void setVertexLayout(PipelineConfigInfo& configInfo, VertexFormat format);
 
         private:
-            static std::vector<char> readFile(const std::string& filepath);
-
             void createGraphicsPipeline(const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo& configInfo);
 
-            void createShaderModule(const std::vector<char>& shaderCode, VkShaderModule* shaderModule);
-
             AveDevice& aveDevice; // potentially memory unsafe, but the device will outlive the pipeline so no risk of dangling ptr
+            AvePipelineCache& avePipelineCache; // owns the shader modules
             VkPipeline graphicsPipeline;
-            VkShaderModule vertShaderModule;
-            VkShaderModule fragShaderModule; // typedef ptrs,
     };
 }
\ No newline at end of file
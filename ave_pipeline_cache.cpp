@@ -0,0 +1,130 @@
+#include "ave_pipeline_cache.hpp"
+#include "ave_mapped_file.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace ave {
+
+    namespace {
+        // 64-bit FNV-1a, SPIR-V blobs are small enough that this never shows up
+        uint64_t hashBytes(const char* data, size_t size) {
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (size_t i = 0; i < size; i++) {
+                hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ull;
+            }
+            return hash ^ size;
+        }
+
+        bool matchesDevice(const char* data, size_t size, const VkPhysicalDeviceProperties& properties) {
+            VkPipelineCacheHeaderVersionOne header;
+            if (size < sizeof(header)) {
+                return false;
+            }
+            std::memcpy(&header, data, sizeof(header));
+            return header.headerSize >= sizeof(header)
+                && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+                && header.vendorID == properties.vendorID
+                && header.deviceID == properties.deviceID
+                && std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        }
+    }
+
+    AvePipelineCache::AvePipelineCache(AveDevice& device, const std::string& filePath) : aveDevice{device}, filePath_{filePath} {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(aveDevice.getPhysicalDevice(), &properties);
+
+        std::unique_ptr<AveMappedFile> file;
+        if (AveMappedFile::exists(filePath_)) {
+            file = std::make_unique<AveMappedFile>(filePath_);
+            warm_ = matchesDevice(file->data(), file->size(), properties);
+            if (!warm_) {
+                std::cout << "pipeline cache " << filePath_ << " was written by another device or driver, starting cold" << std::endl;
+            }
+        }
+
+        VkPipelineCacheCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.initialDataSize = warm_ ? file->size() : 0;
+        createInfo.pInitialData = warm_ ? file->data() : nullptr;
+        if (vkCreatePipelineCache(aveDevice.device(), &createInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+    }
+
+    AvePipelineCache::~AvePipelineCache() {
+        try {
+            save();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl; // losing the cache only costs the next startup
+        }
+
+        for (auto& entry : shaderModules_) {
+            vkDestroyShaderModule(aveDevice.device(), entry.second, nullptr);
+        }
+        vkDestroyPipelineCache(aveDevice.device(), pipelineCache_, nullptr);
+    }
+
+    VkShaderModule AvePipelineCache::getShaderModule(const std::string& spirvPath) {
+        auto known = shaderPaths_.find(spirvPath);
+        if (known != shaderPaths_.end()) {
+            return known->second;
+        }
+
+        if (!AveMappedFile::exists(spirvPath)) {
+            throw std::runtime_error("failed to open file: " + spirvPath);
+        }
+        AveMappedFile file{spirvPath};
+        uint64_t hash = hashBytes(file.data(), file.size());
+
+        auto cached = shaderModules_.find(hash);
+        if (cached == shaderModules_.end()) {
+            // pCode has to be 4 byte aligned, which the page aligned mapping is
+            VkShaderModuleCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            createInfo.codeSize = file.size();
+            createInfo.pCode = reinterpret_cast<const uint32_t*>(file.data());
+
+            VkShaderModule shaderModule;
+            if (vkCreateShaderModule(aveDevice.device(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create shader module!");
+            }
+            cached = shaderModules_.emplace(hash, shaderModule).first;
+        }
+
+        shaderPaths_.emplace(spirvPath, cached->second);
+        return cached->second;
+    }
+
+    void AvePipelineCache::save() {
+        size_t size = 0;
+        if (vkGetPipelineCacheData(aveDevice.device(), pipelineCache_, &size, nullptr) != VK_SUCCESS) {
+            throw std::runtime_error("failed to read pipeline cache data!");
+        }
+        std::vector<char> data(size);
+        if (vkGetPipelineCacheData(aveDevice.device(), pipelineCache_, &size, data.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to read pipeline cache data!");
+        }
+
+        // Written beside the old file and renamed over it, a crash mid write cannot leave a torn cache
+        std::string tempPath = filePath_ + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                throw std::runtime_error("failed to open file for writing: " + tempPath);
+            }
+            file.write(data.data(), static_cast<std::streamsize>(size));
+            if (!file.good()) {
+                throw std::runtime_error("failed to write pipeline cache: " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), filePath_.c_str()) != 0) {
+            throw std::runtime_error("failed to replace pipeline cache: " + filePath_);
+        }
+    }
+}
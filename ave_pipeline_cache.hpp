@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ave_device.hpp"
+
+#include <string>
+#include <unordered_map>
+
+namespace ave {
+
+    // Device wide VkPipelineCache persisted to disk, plus the VkShaderModules every pipeline shares.
+    // The cache blob is only handed back to the driver when its header matches this device's vendor, device
+    // and pipelineCacheUUID, so a driver update or a different GPU starts cold instead of feeding the driver
+    // stale data. It is written back (through a temp file + rename) when the cache is destroyed.
+    //
+    // Shader modules are keyed by a hash of their SPIR-V, so identical code behind different paths is
+    // compiled once, and each path is read from disk only the first time it is asked for.
+    class AvePipelineCache {
+        public:
+            AvePipelineCache(AveDevice& device, const std::string& filePath);
+            ~AvePipelineCache();
+
+            AvePipelineCache(const AvePipelineCache&) = delete;
+            AvePipelineCache& operator=(const AvePipelineCache&) = delete;
+
+            VkPipelineCache getPipelineCache() const { return pipelineCache_; }
+
+            // Owned by the cache, stays valid until it is destroyed
+            VkShaderModule getShaderModule(const std::string& spirvPath);
+
+            // True when the blob on disk was accepted, i.e. pipeline creation should be a warm start
+            bool isWarm() const { return warm_; }
+
+            void save();
+
+        private:
+            AveDevice& aveDevice;
+            std::string filePath_;
+            VkPipelineCache pipelineCache_;
+            bool warm_ = false;
+
+            std::unordered_map<uint64_t, VkShaderModule> shaderModules_; // by SPIR-V hash
+            std::unordered_map<std::string, VkShaderModule> shaderPaths_;
+    };
+}
@@ -0,0 +1,167 @@
+#include "ave_residency.hpp"
+#include "ave_device.hpp"
+
+#include <algorithm>
+
+namespace ave {
+
+    AveResidency::AveResidency(AveDevice& device) : aveDevice{device} {
+        vkGetPhysicalDeviceMemoryProperties(aveDevice.getPhysicalDevice(), &memoryProperties_);
+        for (uint32_t heap = 0; heap < memoryProperties_.memoryHeapCount; heap++) {
+            if (memoryProperties_.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                defaultLimit_ += static_cast<VkDeviceSize>(memoryProperties_.memoryHeaps[heap].size * DEFAULT_LIMIT);
+            }
+        }
+
+        // Core in 1.1, the instance is 1.0 so go through the KHR entry point
+        if (aveDevice.hasMemoryBudget()) {
+            getMemoryProperties2_ = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2>(
+                vkGetInstanceProcAddr(aveDevice.getInstance(), "vkGetPhysicalDeviceMemoryProperties2KHR"));
+        }
+
+        aveDevice.getAllocator().setOutOfMemoryHandler([this](VkDeviceSize size) {
+            // Whatever is recorded for the current frame may still use non idle resources, only idle ones go
+            return release(size, VK_NULL_HANDLE, true, UINT32_MAX) > 0;
+        });
+    }
+
+    AveResidency::~AveResidency() {
+        aveDevice.getAllocator().setOutOfMemoryHandler(nullptr);
+    }
+
+    ResidencyId AveResidency::track(VkDeviceSize size, TrimCallback trim) {
+        ResidencyId id;
+        if (freeIds_.empty()) {
+            id = static_cast<ResidencyId>(resources_.size());
+            resources_.emplace_back();
+        } else {
+            id = freeIds_.back();
+            freeIds_.pop_back();
+        }
+
+        // Counts as used now, a resource that just arrived is about to be drawn
+        Resource& resource = resources_[id];
+        resource.size = size;
+        resource.lastUsedFrame = frame_;
+        resource.trim = std::move(trim);
+        return id;
+    }
+
+    void AveResidency::untrack(ResidencyId id) {
+        resources_[id] = Resource{};
+        freeIds_.push_back(id);
+    }
+
+    void AveResidency::update(VkCommandBuffer commandBuffer) {
+        frame_++;
+
+        VkDeviceSize budget, usage;
+        queryBudget(budget, usage);
+        bool overBudget = usage > budget;
+        if (overBudget != overBudget_) {
+            std::cout << "residency: " << usage / (1024 * 1024) << " of " << budget / (1024 * 1024) << " MiB used, "
+                      << (overBudget ? "trimming least recently used resources" : "back under budget") << std::endl;
+            overBudget_ = overBudget;
+        }
+        if (overBudget) {
+            release(usage - budget, commandBuffer, false, MAX_TRIMS_PER_FRAME);
+        }
+    }
+
+    VkDeviceSize AveResidency::release(VkDeviceSize bytes, VkCommandBuffer commandBuffer, bool idleOnly, uint32_t maxTrims) {
+        // A trim that allocates (a smaller texture) may run out of memory itself, that one just fails
+        if (releasing_) {
+            return 0;
+        }
+        releasing_ = true;
+
+        std::vector<ResidencyId> candidates;
+        for (ResidencyId id = 0; id < resources_.size(); id++) {
+            const Resource& resource = resources_[id];
+            bool idle = resource.lastUsedFrame + MAX_FRAMES_IN_FLIGHT <= frame_;
+            if (resource.trim && resource.size > 0 && (idle || !idleOnly)) {
+                candidates.push_back(id);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [&](ResidencyId a, ResidencyId b) {
+            return resources_[a].lastUsedFrame < resources_[b].lastUsedFrame;
+        });
+
+        VkDeviceSize released = 0;
+        uint32_t trimCount = 0;
+        for (ResidencyId id : candidates) {
+            if (released >= bytes || trimCount == maxTrims) {
+                break;
+            }
+
+            // The callback may track or untrack other resources, look the record up again afterwards
+            bool idle = resources_[id].lastUsedFrame + MAX_FRAMES_IN_FLIGHT <= frame_;
+            TrimCallback trim = resources_[id].trim;
+            VkDeviceSize freed = trim(commandBuffer, idle);
+            if (freed == 0) {
+                continue;
+            }
+
+            Resource& resource = resources_[id];
+            resource.size -= std::min(resource.size, freed);
+            if (resource.size == 0) {
+                evictions_++;
+            } else {
+                trims_++;
+            }
+            released += freed;
+            trimCount++;
+        }
+
+        releasing_ = false;
+        return released;
+    }
+
+    void AveResidency::queryBudget(VkDeviceSize& budget, VkDeviceSize& usage) {
+        // Free space inside our own blocks is available to us, even though the driver counts it as used
+        AllocatorStats allocator = aveDevice.getAllocator().getStats();
+        VkDeviceSize unusedReserve = allocator.bytesReserved - allocator.bytesUsed;
+
+        if (getMemoryProperties2_ != nullptr) {
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+            budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+            VkPhysicalDeviceMemoryProperties2 properties{};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            properties.pNext = &budgetProperties;
+            getMemoryProperties2_(aveDevice.getPhysicalDevice(), &properties);
+
+            budget = 0;
+            usage = 0;
+            for (uint32_t heap = 0; heap < memoryProperties_.memoryHeapCount; heap++) {
+                if (memoryProperties_.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                    budget += static_cast<VkDeviceSize>(budgetProperties.heapBudget[heap] * BUDGET_HEADROOM);
+                    usage += budgetProperties.heapUsage[heap];
+                }
+            }
+            if (limit_ > 0) {
+                budget = std::min(budget, limit_);
+            }
+        } else {
+            // Only our own allocations are visible, host visible ones included
+            budget = limit_ > 0 ? limit_ : defaultLimit_;
+            usage = allocator.bytesReserved;
+        }
+
+        usage -= std::min(usage, unusedReserve);
+    }
+
+    ResidencyStats AveResidency::getStats() {
+        ResidencyStats stats{};
+        queryBudget(stats.budget, stats.usage);
+        for (const Resource& resource : resources_) {
+            if (resource.trim && resource.size > 0) {
+                stats.tracked += resource.size;
+                stats.resourceCount++;
+            }
+        }
+        stats.evictions = evictions_;
+        stats.trims = trims_;
+        stats.driverBudget = getMemoryProperties2_ != nullptr;
+        return stats;
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "ave_allocator.hpp"
+#include "ave_constants.h"
+
+#include <functional>
+#include <vector>
+
+namespace ave {
+
+    class AveDevice;
+
+    using ResidencyId = uint32_t;
+
+    struct ResidencyStats {
+        VkDeviceSize budget;    // device local bytes we plan to stay under
+        VkDeviceSize usage;     // device local bytes counted against it
+        VkDeviceSize tracked;   // bytes held by tracked textures and meshes
+        uint32_t resourceCount; // tracked resources that hold memory
+        uint32_t evictions;     // resources dropped completely since startup
+        uint32_t trims;         // resources shrunk (top mip dropped) since startup
+        bool driverBudget;      // budget comes from VK_EXT_memory_budget rather than a configured limit
+    };
+
+    // Keeps device memory use under a budget by evicting what has not been used for the longest time. The
+    // budget comes from VK_EXT_memory_budget when the device has it (the driver's per heap budget, so other
+    // processes are accounted for), otherwise from a configured limit that defaults to a share of the device
+    // local heaps. Usage is what the driver reports, minus the free space inside the allocator's blocks.
+    //
+    // Owners register each texture or mesh with its size and a trim callback and touch() it whenever a frame
+    // uses it. Once per frame update() compares usage with the budget and, while over, calls trim callbacks in
+    // least recently used order. A resource no frame in flight can still read is `idle` and may drop out
+    // entirely (its owner brings it back on next use), others may only shrink, e.g. a texture losing its top
+    // mip. When an allocation fails outright the allocator asks the residency manager to evict idle resources
+    // before giving up, so large scenes degrade instead of failing in createImage.
+    class AveResidency {
+        public:
+            static constexpr float BUDGET_HEADROOM = 0.9f; // share of the driver's budget we plan to use
+            static constexpr float DEFAULT_LIMIT = 0.8f;   // share of device local heaps without VK_EXT_memory_budget
+            static constexpr uint32_t MAX_TRIMS_PER_FRAME = 4;
+
+            // Releases memory held by the resource and returns the bytes freed, 0 when it has nothing to give.
+            // commandBuffer is the frame's, outside a render pass, VK_NULL_HANDLE when called from an allocation.
+            using TrimCallback = std::function<VkDeviceSize(VkCommandBuffer commandBuffer, bool idle)>;
+
+            AveResidency(AveDevice& device);
+            ~AveResidency();
+
+            AveResidency(const AveResidency&) = delete;
+            AveResidency& operator=(const AveResidency&) = delete;
+
+            ResidencyId track(VkDeviceSize size, TrimCallback trim);
+            void untrack(ResidencyId id);
+            void touch(ResidencyId id) { resources_[id].lastUsedFrame = frame_; }
+            // After the owner brought an evicted resource back or resized it
+            void setSize(ResidencyId id, VkDeviceSize size) { resources_[id].size = size; }
+
+            // Caps the budget, 0 restores the default. Applies on top of VK_EXT_memory_budget when present.
+            void setLimit(VkDeviceSize limit) { limit_ = limit; }
+
+            // Call once per frame after the frame's in flight fence was waited on, before anything is touched.
+            // Trims record their copies into commandBuffer.
+            void update(VkCommandBuffer commandBuffer);
+
+            // Frames counted by update(), for owners that retire memory until frames in flight are done with it
+            uint64_t getFrame() const { return frame_; }
+            bool isOverBudget() const { return overBudget_; }
+            ResidencyStats getStats();
+
+        private:
+            struct Resource {
+                VkDeviceSize size = 0;
+                uint64_t lastUsedFrame = 0;
+                TrimCallback trim; // empty once untracked
+            };
+
+            void queryBudget(VkDeviceSize& budget, VkDeviceSize& usage);
+            // Trims in least recently used order until `bytes` were freed, returns what was freed
+            VkDeviceSize release(VkDeviceSize bytes, VkCommandBuffer commandBuffer, bool idleOnly, uint32_t maxTrims);
+
+            AveDevice& aveDevice;
+            PFN_vkGetPhysicalDeviceMemoryProperties2 getMemoryProperties2_ = nullptr;
+            VkPhysicalDeviceMemoryProperties memoryProperties_;
+            VkDeviceSize defaultLimit_ = 0;
+            VkDeviceSize limit_ = 0;
+
+            std::vector<Resource> resources_;
+            std::vector<ResidencyId> freeIds_;
+            uint64_t frame_ = 0;
+            bool releasing_ = false;
+            bool overBudget_ = false;
+
+            uint32_t evictions_ = 0;
+            uint32_t trims_ = 0;
+    };
+}
@@ -0,0 +1,193 @@
+#include "ave_scene.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ave {
+
+    EntityId AveScene::create(const glm::mat4& local, EntityId parent) {
+        assert((parent == ENTITY_NONE || isAlive(parent)) && "Parent entity does not exist");
+
+        EntityId entity;
+        if (!freeIds_.empty()) {
+            entity = freeIds_.back();
+            freeIds_.pop_back();
+        } else {
+            entity = static_cast<EntityId>(index_.size());
+            index_.push_back(NO_INDEX);
+        }
+
+        // Appending keeps parents ahead of children, only the depth order waits for update()
+        uint32_t index = static_cast<uint32_t>(entity_.size());
+        uint32_t parentIndex = parent == ENTITY_NONE ? NO_INDEX : index_[parent];
+        uint32_t depth = parentIndex == NO_INDEX ? 0 : depth_[parentIndex] + 1;
+        if (index > 0 && depth < depth_.back()) {
+            sorted_ = false;
+        }
+
+        local_.push_back(local);
+        world_.push_back(local);
+        parent_.push_back(parentIndex);
+        depth_.push_back(depth);
+        dirty_.push_back(0);
+        entity_.push_back(entity);
+        index_[entity] = index;
+        markDirty(index);
+        return entity;
+    }
+
+    void AveScene::destroy(EntityId entity) {
+        assert(isAlive(entity) && "Entity does not exist");
+
+        // Descendants come after their ancestors, one forward pass finds the whole subtree
+        if (!sorted_) {
+            sortByDepth();
+        }
+        uint32_t root = index_[entity];
+        std::vector<uint8_t> dead(entity_.size(), 0);
+        dead[root] = 1;
+        for (uint32_t i = root + 1; i < entity_.size(); i++) {
+            dead[i] = parent_[i] != NO_INDEX && dead[parent_[i]];
+        }
+
+        std::vector<uint32_t> order;
+        order.reserve(entity_.size());
+        for (uint32_t i = 0; i < entity_.size(); i++) {
+            if (dead[i]) {
+                index_[entity_[i]] = NO_INDEX;
+                freeIds_.push_back(entity_[i]);
+            } else {
+                order.push_back(i);
+            }
+        }
+        reorder(order);
+    }
+
+    void AveScene::setLocal(EntityId entity, const glm::mat4& local) {
+        uint32_t index = index_[entity];
+        local_[index] = local;
+        markDirty(index);
+    }
+
+    EntityId AveScene::getParent(EntityId entity) const {
+        uint32_t parentIndex = parent_[index_[entity]];
+        return parentIndex == NO_INDEX ? ENTITY_NONE : entity_[parentIndex];
+    }
+
+    void AveScene::setParent(EntityId entity, EntityId parent) {
+        assert(isAlive(entity) && "Entity does not exist");
+        assert((parent == ENTITY_NONE || isAlive(parent)) && "Parent entity does not exist");
+
+        // The subtree is found the same way destroy() finds it, which needs parents ahead of children
+        if (!sorted_) {
+            sortByDepth();
+        }
+        uint32_t root = index_[entity];
+        uint32_t parentIndex = parent == ENTITY_NONE ? NO_INDEX : index_[parent];
+        for (uint32_t ancestor = parentIndex; ancestor != NO_INDEX; ancestor = parent_[ancestor]) {
+            assert(ancestor != root && "An entity cannot be parented to its own subtree");
+        }
+
+        uint32_t depth = parentIndex == NO_INDEX ? 0 : depth_[parentIndex] + 1;
+        if (depth != depth_[root]) {
+            std::vector<uint8_t> inSubtree(entity_.size(), 0);
+            inSubtree[root] = 1;
+            int64_t shift = int64_t{depth} - depth_[root];
+            depth_[root] = depth;
+            for (uint32_t i = root + 1; i < entity_.size(); i++) {
+                inSubtree[i] = parent_[i] != NO_INDEX && inSubtree[parent_[i]];
+                if (inSubtree[i]) {
+                    depth_[i] = static_cast<uint32_t>(depth_[i] + shift);
+                }
+            }
+            sorted_ = false;
+        }
+        parent_[root] = parentIndex;
+        markDirty(root);
+    }
+
+    void AveScene::markDirty(uint32_t index) {
+        dirty_[index] = 1;
+        firstDirty_ = std::min(firstDirty_, index);
+    }
+
+    void AveScene::update() {
+        if (!sorted_) {
+            sortByDepth();
+        }
+
+        changed_.clear();
+        if (firstDirty_ == NO_INDEX) {
+            return;
+        }
+
+        // Parents are final before their children are reached, a dirty parent dirties the child
+        for (uint32_t i = firstDirty_; i < entity_.size(); i++) {
+            uint32_t parent = parent_[i];
+            if (parent != NO_INDEX && dirty_[parent]) {
+                dirty_[i] = 1;
+            }
+            if (dirty_[i]) {
+                world_[i] = parent == NO_INDEX ? local_[i] : world_[parent] * local_[i];
+                changed_.push_back(entity_[i]);
+            }
+        }
+
+        std::fill(dirty_.begin() + firstDirty_, dirty_.end(), 0);
+        firstDirty_ = NO_INDEX;
+    }
+
+    void AveScene::sortByDepth() {
+        // Counting sort, stable, so siblings keep their creation order
+        if (depth_.empty()) {
+            sorted_ = true;
+            return;
+        }
+        uint32_t maxDepth = *std::max_element(depth_.begin(), depth_.end());
+        std::vector<uint32_t> starts(maxDepth + 2, 0);
+        for (uint32_t depth : depth_) {
+            starts[depth + 1]++;
+        }
+        for (size_t d = 1; d < starts.size(); d++) {
+            starts[d] += starts[d - 1];
+        }
+        std::vector<uint32_t> order(entity_.size());
+        for (uint32_t i = 0; i < entity_.size(); i++) {
+            order[starts[depth_[i]]++] = i;
+        }
+        reorder(order);
+        sorted_ = true;
+    }
+
+    void AveScene::reorder(const std::vector<uint32_t>& order) {
+        std::vector<uint32_t> newIndex(entity_.size(), NO_INDEX);
+        for (uint32_t i = 0; i < order.size(); i++) {
+            newIndex[order[i]] = i;
+        }
+
+        auto permute = [&](auto& values) {
+            std::remove_reference_t<decltype(values)> permuted(order.size());
+            for (uint32_t i = 0; i < order.size(); i++) {
+                permuted[i] = values[order[i]];
+            }
+            values.swap(permuted);
+        };
+        permute(local_);
+        permute(world_);
+        permute(parent_);
+        permute(depth_);
+        permute(dirty_);
+        permute(entity_);
+
+        firstDirty_ = NO_INDEX;
+        for (uint32_t i = 0; i < order.size(); i++) {
+            if (parent_[i] != NO_INDEX) {
+                parent_[i] = newIndex[parent_[i]];
+            }
+            index_[entity_[i]] = i;
+            if (dirty_[i]) {
+                firstDirty_ = std::min(firstDirty_, i);
+            }
+        }
+    }
+}
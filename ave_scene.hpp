@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace ave {
+
+    using EntityId = uint32_t;
+
+    static constexpr EntityId ENTITY_NONE = UINT32_MAX;
+
+    // Transform hierarchy of every entity in the scene, stored data oriented: local matrices, world matrices,
+    // parents and dirty flags live in parallel contiguous arrays sorted by depth, so every parent comes before
+    // its children and update() is one forward pass that recomputes only the subtrees under changed entities.
+    // Renderers read world matrices straight from getWorldMatrices(), in the same order.
+    //
+    // EntityIds are stable handles, mapped to the array position on every lookup. Creation appends and
+    // reparenting moves a subtree to another depth (sorting by depth again happens once, in the next update),
+    // destruction compacts the arrays; all are meant for loading and spawning rather than every frame. World
+    // matrices are those of the last update().
+    class AveScene {
+        public:
+            EntityId create(const glm::mat4& local = glm::mat4{1.0f}, EntityId parent = ENTITY_NONE);
+            // Destroys the entity and all of its descendants
+            void destroy(EntityId entity);
+            bool isAlive(EntityId entity) const { return entity < index_.size() && index_[entity] != NO_INDEX; }
+
+            void setLocal(EntityId entity, const glm::mat4& local);
+            const glm::mat4& getLocal(EntityId entity) const { return local_[index_[entity]]; }
+            const glm::mat4& getWorld(EntityId entity) const { return world_[index_[entity]]; }
+            EntityId getParent(EntityId entity) const;
+            // Moves the entity and its descendants under parent (ENTITY_NONE makes it a root). The local matrix is
+            // kept, so the subtree follows its new parent from the next update(). parent must not be in the subtree.
+            void setParent(EntityId entity, EntityId parent);
+
+            // Restores depth order and recomputes the world matrices of changed entities and their descendants
+            void update();
+            // Entities whose world matrix the last update() recomputed, parents first
+            const std::vector<EntityId>& getChanged() const { return changed_; }
+
+            // Dense, depth sorted arrays, valid until the next create, destroy or update
+            size_t size() const { return entity_.size(); }
+            const glm::mat4* getWorldMatrices() const { return world_.data(); }
+            const EntityId* getEntities() const { return entity_.data(); }
+            uint32_t getIndex(EntityId entity) const { return index_[entity]; }
+
+        private:
+            static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+            void markDirty(uint32_t index);
+            void sortByDepth();
+            // Moves the entity at index order[i] to i in every array, order lists survivors only
+            void reorder(const std::vector<uint32_t>& order);
+
+            // Dense, by array position
+            std::vector<glm::mat4> local_;
+            std::vector<glm::mat4> world_;
+            std::vector<uint32_t> parent_; // array position of the parent, NO_INDEX for roots
+            std::vector<uint32_t> depth_;
+            std::vector<uint8_t> dirty_;
+            std::vector<EntityId> entity_;
+
+            std::vector<uint32_t> index_; // by EntityId, NO_INDEX once destroyed
+            std::vector<EntityId> freeIds_;
+            std::vector<EntityId> changed_;
+
+            uint32_t firstDirty_ = NO_INDEX; // update() starts here, nothing before it changed
+            bool sorted_ = true; // by depth; when false, reparenting may also have put children ahead of parents
+    };
+}
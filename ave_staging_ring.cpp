@@ -0,0 +1,108 @@
+#include "ave_staging_ring.hpp"
+#include "ave_device.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ave {
+
+    AveStagingRing::AveStagingRing(AveDevice& device, VkDeviceSize size) : aveDevice{device}, size_{size} {
+        aveDevice.createBuffer(size_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer_, memory_);
+        mapped_ = static_cast<unsigned char*>(memory_.mapped);
+    }
+
+    AveStagingRing::~AveStagingRing() {
+        for (auto& frameTemporaries : temporaries_) {
+            for (auto& temporary : frameTemporaries) {
+                aveDevice.destroyBuffer(temporary.first, temporary.second);
+            }
+        }
+        aveDevice.destroyBuffer(buffer_, memory_);
+    }
+
+    void AveStagingRing::beginFrame(uint32_t frameIndex) {
+        frameEnds_[currentFrame_] = head_;
+
+        // Everything staged during this slot's previous use has been consumed by the GPU
+        release(frameEnds_[frameIndex]);
+        for (auto& temporary : temporaries_[frameIndex]) {
+            aveDevice.destroyBuffer(temporary.first, temporary.second);
+        }
+        temporaries_[frameIndex].clear();
+        currentFrame_ = frameIndex;
+    }
+
+    bool AveStagingRing::allocate(VkDeviceSize size, VkDeviceSize& offset) {
+        uint64_t start = (head_ + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+        if (start % size_ + size > size_) {
+            start += size_ - start % size_; // would straddle the end, skip to the start of the next lap
+        }
+        if (start + size - tail_ > size_) {
+            return false;
+        }
+        head_ = start + size;
+        offset = start % size_;
+        return true;
+    }
+
+    void AveStagingRing::createTemporary(const void* data, VkDeviceSize size, VkBuffer& buffer, AveAllocation& memory) {
+        aveDevice.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory);
+        memcpy(memory.mapped, data, static_cast<size_t>(size));
+        fallbackCount_++;
+    }
+
+    void AveStagingRing::uploadToBuffer(VkCommandBuffer commandBuffer, const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset) {
+        VkBufferCopy copyRegion{};
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = size;
+
+        VkDeviceSize offset;
+        if (allocate(size, offset)) {
+            memcpy(mapped_ + offset, data, static_cast<size_t>(size));
+            copyRegion.srcOffset = offset;
+            vkCmdCopyBuffer(commandBuffer, buffer_, dstBuffer, 1, &copyRegion);
+            return;
+        }
+
+        VkBuffer temporary;
+        AveAllocation temporaryMemory;
+        createTemporary(data, size, temporary, temporaryMemory);
+        temporaries_[currentFrame_].emplace_back(temporary, temporaryMemory);
+        copyRegion.srcOffset = 0;
+        vkCmdCopyBuffer(commandBuffer, temporary, dstBuffer, 1, &copyRegion);
+    }
+
+    void AveStagingRing::uploadToBufferNow(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset) {
+        VkBufferCopy copyRegion{};
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = size;
+
+        uint64_t head = head_;
+        VkDeviceSize offset;
+        if (allocate(size, offset)) {
+            memcpy(mapped_ + offset, data, static_cast<size_t>(size));
+            copyRegion.srcOffset = offset;
+            VkCommandBuffer commandBuffer = aveDevice.beginSingleTimeCommands();
+            vkCmdCopyBuffer(commandBuffer, buffer_, dstBuffer, 1, &copyRegion);
+            aveDevice.endSingleTimeCommands(commandBuffer);
+            if (aveDevice.getUploadBatch() == nullptr) {
+                head_ = head; // the copy has finished and nothing else was staged meanwhile, give the space back
+            }
+            return;
+        }
+
+        VkBuffer temporary;
+        AveAllocation temporaryMemory;
+        createTemporary(data, size, temporary, temporaryMemory);
+        VkCommandBuffer commandBuffer = aveDevice.beginSingleTimeCommands();
+        vkCmdCopyBuffer(commandBuffer, temporary, dstBuffer, 1, &copyRegion);
+        aveDevice.endSingleTimeCommands(commandBuffer);
+        if (aveDevice.getUploadBatch() != nullptr) {
+            aveDevice.getUploadBatch()->deferDestroy(temporary, temporaryMemory);
+        } else {
+            aveDevice.destroyBuffer(temporary, temporaryMemory);
+        }
+    }
+}
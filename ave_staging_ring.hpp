@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ave_allocator.hpp"
+#include "ave_constants.h"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+namespace ave {
+
+    class AveDevice;
+
+    // One persistently mapped host visible buffer that every CPU -> GPU buffer upload goes through.
+    // Space is handed out front to back and wraps around; each allocation belongs to the frame that was
+    // current when it was made and is reclaimed by beginFrame() once that frame's fence has been waited
+    // on again, so steady state uploads cost a memcpy and a vkCmdCopyBuffer and no Vulkan allocations.
+    // Payloads that do not fit (bigger than the free part of the ring) fall back to a temporary buffer
+    // that is destroyed on the same schedule.
+    class AveStagingRing {
+        public:
+            static constexpr VkDeviceSize RING_SIZE = 32 * 1024 * 1024;
+            static constexpr VkDeviceSize RING_ALIGNMENT = 16;
+
+            AveStagingRing(AveDevice& device, VkDeviceSize size = RING_SIZE);
+            ~AveStagingRing();
+
+            AveStagingRing(const AveStagingRing&) = delete;
+            AveStagingRing& operator=(const AveStagingRing&) = delete;
+
+            // Call after the frame's in flight fence was waited on, before recording any upload for it
+            void beginFrame(uint32_t frameIndex);
+
+            // Copies data into the ring and records the copy into commandBuffer. The caller owns the
+            // barriers around it, the staged bytes stay untouched until this frame slot comes around again.
+            void uploadToBuffer(VkCommandBuffer commandBuffer, const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+
+            // Load time path: submits the copy on its own and waits, the ring space is reusable right after.
+            // Inside an upload batch the copy is only recorded and its space is reclaimed on the frame schedule.
+            void uploadToBufferNow(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+
+            // Uploads that could not use the ring since startup
+            uint32_t getFallbackCount() const { return fallbackCount_; }
+
+            // Raw ring access for owners that retire space on their own schedule instead of per frame:
+            // allocate() hands out RING_ALIGNMENT aligned space (false when full), getHead() marks the end of
+            // everything allocated so far, and release(mark) frees all space allocated before that mark.
+            bool allocate(VkDeviceSize size, VkDeviceSize& offset);
+            uint64_t getHead() const { return head_; }
+            void release(uint64_t position) { tail_ = std::max(tail_, position); }
+            VkBuffer getBuffer() const { return buffer_; }
+            unsigned char* getMapped() const { return mapped_; }
+            VkDeviceSize getSize() const { return size_; }
+
+        private:
+            void createTemporary(const void* data, VkDeviceSize size, VkBuffer& buffer, AveAllocation& memory);
+
+            AveDevice& aveDevice;
+            VkBuffer buffer_;
+            AveAllocation memory_;
+            unsigned char* mapped_;
+            VkDeviceSize size_;
+
+            // Positions are running byte counts, the ring offset is position % size_
+            uint64_t head_ = 0;
+            uint64_t tail_ = 0;
+            uint32_t currentFrame_ = 0;
+            std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> frameEnds_{};
+            std::array<std::vector<std::pair<VkBuffer, AveAllocation>>, MAX_FRAMES_IN_FLIGHT> temporaries_;
+            uint32_t fallbackCount_ = 0;
+    };
+}
@@ -15,8 +15,7 @@ namespace ave {
 
     AveSwapChain::~AveSwapChain() {
         vkDestroyImageView(aveDevice.device(), colorImageView, nullptr);
-        vkDestroyImage(aveDevice.device(), colorImage, nullptr);
-        vkFreeMemory(aveDevice.device(), colorImageMemory, nullptr);
+        aveDevice.destroyImage(colorImage, colorImageMemory);
 
         for (auto imageView : swapChainImageViews) {
             vkDestroyImageView(aveDevice.device(), imageView, nullptr);
@@ -30,8 +29,7 @@ namespace ave {
 
         for (int i = 0; i < depthImages.size(); i++) {
             vkDestroyImageView(aveDevice.device(), depthImageViews[i], nullptr);
-            vkDestroyImage(aveDevice.device(), depthImages[i], nullptr);
-            vkFreeMemory(aveDevice.device(), depthImageMemorys[i], nullptr);
+            aveDevice.destroyImage(depthImages[i], depthImageMemorys[i]);
         }
 
         for (auto framebuffer : swapChainFramebuffers) {
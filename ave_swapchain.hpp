@@ -73,14 +73,14 @@ class AveSwapChain {
   VkRenderPass renderPass;
 
   std::vector<VkImage> depthImages;
-  std::vector<VkDeviceMemory> depthImageMemorys;
+  std::vector<AveAllocation> depthImageMemorys;
   std::vector<VkImageView> depthImageViews;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
 
 
   VkImage colorImage;
-  VkDeviceMemory colorImageMemory;
+  AveAllocation colorImageMemory;
   VkImageView colorImageView;
 
   AveDevice &aveDevice;
@@ -0,0 +1,379 @@
+#include "ave_texture_encoder.hpp"
+#include "ave_texture_file.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ave {
+
+    namespace {
+        constexpr size_t LINEAR_TO_SRGB_STEPS = 4096;
+
+        struct SrgbTables {
+            std::array<float, 256> toLinear;
+            std::array<uint8_t, LINEAR_TO_SRGB_STEPS + 1> fromLinear;
+
+            SrgbTables() {
+                for (int i = 0; i < 256; i++) {
+                    float c = i / 255.0f;
+                    toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                }
+                for (size_t i = 0; i <= LINEAR_TO_SRGB_STEPS; i++) {
+                    float l = static_cast<float>(i) / LINEAR_TO_SRGB_STEPS;
+                    float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                    fromLinear[i] = static_cast<uint8_t>(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+                }
+            }
+        };
+
+        const SrgbTables& srgbTables() {
+            static const SrgbTables tables;
+            return tables;
+        }
+
+        // Average of four RGBA float texels
+        inline void average4(const float* a, const float* b, const float* c, const float* d, float* out) {
+#if defined(__SSE2__)
+            __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)), _mm_add_ps(_mm_loadu_ps(c), _mm_loadu_ps(d)));
+            _mm_storeu_ps(out, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+            for (int k = 0; k < 4; k++) {
+                out[k] = (a[k] + b[k] + c[k] + d[k]) * 0.25f;
+            }
+#endif
+        }
+
+        // ---- block compression, every encoder takes one 4x4 block of RGBA8 texels in row order ----
+
+        using Block = std::array<std::array<uint8_t, 4>, 16>;
+
+        int squaredDistance(const uint8_t* a, const uint8_t* b, int channels) {
+            int sum = 0;
+            for (int k = 0; k < channels; k++) {
+                int d = static_cast<int>(a[k]) - static_cast<int>(b[k]);
+                sum += d * d;
+            }
+            return sum;
+        }
+
+        // Endpoints at the extremes of the block's principal axis (power iteration on the covariance)
+        void principalEndpoints(const Block& block, int channels, std::array<float, 4>& low, std::array<float, 4>& high) {
+            std::array<float, 4> mean{};
+            for (const auto& texel : block) {
+                for (int k = 0; k < channels; k++) mean[k] += texel[k] / 16.0f;
+            }
+
+            float covariance[4][4] = {};
+            for (const auto& texel : block) {
+                for (int i = 0; i < channels; i++) {
+                    for (int j = 0; j < channels; j++) {
+                        covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+                    }
+                }
+            }
+
+            std::array<float, 4> axis{1.0f, 1.0f, 1.0f, 1.0f};
+            for (int iteration = 0; iteration < 8; iteration++) {
+                std::array<float, 4> next{};
+                float length = 0.0f;
+                for (int i = 0; i < channels; i++) {
+                    for (int j = 0; j < channels; j++) next[i] += covariance[i][j] * axis[j];
+                    length = std::max(length, std::abs(next[i]));
+                }
+                if (length == 0.0f) break; // flat block, any axis works
+                for (int i = 0; i < channels; i++) axis[i] = next[i] / length;
+            }
+
+            float lowProjection = 1e30f, highProjection = -1e30f;
+            for (const auto& texel : block) {
+                float projection = 0.0f;
+                for (int k = 0; k < channels; k++) projection += (texel[k] - mean[k]) * axis[k];
+                if (projection < lowProjection) {
+                    lowProjection = projection;
+                    for (int k = 0; k < channels; k++) low[k] = texel[k];
+                }
+                if (projection > highProjection) {
+                    highProjection = projection;
+                    for (int k = 0; k < channels; k++) high[k] = texel[k];
+                }
+            }
+
+            // Pull the endpoints in by 1/16 of the range, the interpolated entries then cover the middle better
+            for (int k = 0; k < channels; k++) {
+                float inset = (high[k] - low[k]) / 16.0f;
+                low[k] = std::clamp(low[k] + inset, 0.0f, 255.0f);
+                high[k] = std::clamp(high[k] - inset, 0.0f, 255.0f);
+            }
+        }
+
+        uint16_t packRgb565(const std::array<float, 4>& color) {
+            auto quantize = [](float value, int maximum) { return static_cast<uint16_t>(std::lround(value * maximum / 255.0f)); };
+            return static_cast<uint16_t>((quantize(color[0], 31) << 11) | (quantize(color[1], 63) << 5) | quantize(color[2], 31));
+        }
+
+        std::array<uint8_t, 4> unpackRgb565(uint16_t color) {
+            uint8_t r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+            return {static_cast<uint8_t>((r << 3) | (r >> 2)), static_cast<uint8_t>((g << 2) | (g >> 4)), static_cast<uint8_t>((b << 3) | (b >> 2)), 255};
+        }
+
+        // BC1 color block in four color mode (color0 > color1), also the color half of BC3
+        void encodeColorBlock(const Block& block, uint8_t* out) {
+            std::array<float, 4> low, high;
+            principalEndpoints(block, 3, low, high);
+            uint16_t color0 = packRgb565(high);
+            uint16_t color1 = packRgb565(low);
+            if (color0 < color1) std::swap(color0, color1);
+
+            uint32_t indices = 0;
+            if (color0 != color1) {
+                std::array<std::array<uint8_t, 4>, 4> palette;
+                palette[0] = unpackRgb565(color0);
+                palette[1] = unpackRgb565(color1);
+                for (int k = 0; k < 3; k++) {
+                    palette[2][k] = static_cast<uint8_t>((2 * palette[0][k] + palette[1][k] + 1) / 3);
+                    palette[3][k] = static_cast<uint8_t>((palette[0][k] + 2 * palette[1][k] + 1) / 3);
+                }
+
+                for (int i = 0; i < 16; i++) {
+                    int best = 0, bestError = squaredDistance(block[i].data(), palette[0].data(), 3);
+                    for (int p = 1; p < 4; p++) {
+                        int error = squaredDistance(block[i].data(), palette[p].data(), 3);
+                        if (error < bestError) {
+                            bestError = error;
+                            best = p;
+                        }
+                    }
+                    indices |= static_cast<uint32_t>(best) << (2 * i);
+                }
+            }
+
+            out[0] = color0 & 0xFF;
+            out[1] = color0 >> 8;
+            out[2] = color1 & 0xFF;
+            out[3] = color1 >> 8;
+            for (int k = 0; k < 4; k++) out[4 + k] = (indices >> (8 * k)) & 0xFF;
+        }
+
+        // BC4 style alpha block of BC3, eight level mode (alpha0 > alpha1)
+        void encodeAlphaBlock(const Block& block, uint8_t* out) {
+            uint8_t alpha0 = 0, alpha1 = 255;
+            for (const auto& texel : block) {
+                alpha0 = std::max(alpha0, texel[3]);
+                alpha1 = std::min(alpha1, texel[3]);
+            }
+
+            uint64_t indices = 0;
+            if (alpha0 != alpha1) {
+                int palette[8] = {alpha0, alpha1};
+                for (int p = 1; p < 7; p++) {
+                    palette[p + 1] = ((7 - p) * alpha0 + p * alpha1 + 3) / 7;
+                }
+                for (int i = 0; i < 16; i++) {
+                    int best = 0, bestError = 1 << 30;
+                    for (int p = 0; p < 8; p++) {
+                        int error = std::abs(palette[p] - block[i][3]);
+                        if (error < bestError) {
+                            bestError = error;
+                            best = p;
+                        }
+                    }
+                    indices |= static_cast<uint64_t>(best) << (3 * i);
+                }
+            }
+
+            out[0] = alpha0;
+            out[1] = alpha1;
+            for (int k = 0; k < 6; k++) out[2 + k] = (indices >> (8 * k)) & 0xFF;
+        }
+
+        class BitWriter {
+            public:
+                explicit BitWriter(uint8_t* out) : out_{out} { std::memset(out_, 0, 16); }
+
+                void write(uint32_t value, int bits) {
+                    for (int b = 0; b < bits; b++, position_++) {
+                        if (value & (1u << b)) out_[position_ >> 3] |= static_cast<uint8_t>(1u << (position_ & 7));
+                    }
+                }
+
+            private:
+                uint8_t* out_;
+                int position_ = 0;
+        };
+
+        // BC7 mode 6: RGBA endpoints with 7 bits per channel plus one p-bit each, 4-bit indices
+        void encodeBc7Mode6Block(const Block& block, uint8_t* out) {
+            static const int WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+            std::array<float, 4> low, high;
+            principalEndpoints(block, 4, low, high);
+
+            // Quantize an endpoint to 7 bits + shared p-bit, keeping whichever p-bit reconstructs it closer
+            auto quantize = [](const std::array<float, 4>& color, std::array<uint8_t, 4>& bits7, uint32_t& pBit) {
+                float bestError = 1e30f;
+                for (uint32_t p = 0; p < 2; p++) {
+                    std::array<uint8_t, 4> candidate;
+                    float error = 0.0f;
+                    for (int k = 0; k < 4; k++) {
+                        int q = std::clamp(static_cast<int>(std::lround((color[k] - p) / 2.0f)), 0, 127);
+                        candidate[k] = static_cast<uint8_t>(q);
+                        float d = color[k] - static_cast<float>((q << 1) | p);
+                        error += d * d;
+                    }
+                    if (error < bestError) {
+                        bestError = error;
+                        bits7 = candidate;
+                        pBit = p;
+                    }
+                }
+            };
+
+            std::array<std::array<uint8_t, 4>, 2> endpoints7;
+            uint32_t pBits[2];
+            quantize(low, endpoints7[0], pBits[0]);
+            quantize(high, endpoints7[1], pBits[1]);
+
+            std::array<std::array<uint8_t, 4>, 16> palette;
+            for (int p = 0; p < 16; p++) {
+                for (int k = 0; k < 4; k++) {
+                    int e0 = (endpoints7[0][k] << 1) | pBits[0];
+                    int e1 = (endpoints7[1][k] << 1) | pBits[1];
+                    palette[p][k] = static_cast<uint8_t>(((64 - WEIGHTS[p]) * e0 + WEIGHTS[p] * e1 + 32) >> 6);
+                }
+            }
+
+            int indices[16];
+            for (int i = 0; i < 16; i++) {
+                int best = 0, bestError = 1 << 30;
+                for (int p = 0; p < 16; p++) {
+                    int error = squaredDistance(block[i].data(), palette[p].data(), 4);
+                    if (error < bestError) {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                indices[i] = best;
+            }
+
+            // The first texel's index is stored without its top bit, so it has to be below 8
+            if (indices[0] >= 8) {
+                std::swap(endpoints7[0], endpoints7[1]);
+                std::swap(pBits[0], pBits[1]);
+                for (int& index : indices) index = 15 - index;
+            }
+
+            BitWriter writer{out};
+            writer.write(1u << 6, 7); // mode 6
+            for (int k = 0; k < 4; k++) {
+                writer.write(endpoints7[0][k], 7);
+                writer.write(endpoints7[1][k], 7);
+            }
+            writer.write(pBits[0], 1);
+            writer.write(pBits[1], 1);
+            writer.write(static_cast<uint32_t>(indices[0]), 3);
+            for (int i = 1; i < 16; i++) {
+                writer.write(static_cast<uint32_t>(indices[i]), 4);
+            }
+        }
+    }
+
+    VkFormat AveTextureEncoder::vkFormat(TextureEncoding encoding) {
+        switch (encoding) {
+            case TextureEncoding::RGBA8: return VK_FORMAT_R8G8B8A8_SRGB;
+            case TextureEncoding::BC1: return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+            case TextureEncoding::BC3: return VK_FORMAT_BC3_SRGB_BLOCK;
+            case TextureEncoding::BC7: return VK_FORMAT_BC7_SRGB_BLOCK;
+        }
+        throw std::runtime_error("unknown texture encoding!");
+    }
+
+    std::vector<TextureLevelData> AveTextureEncoder::generateMips(const unsigned char* rgba, uint32_t width, uint32_t height) {
+        const SrgbTables& tables = srgbTables();
+        std::vector<TextureLevelData> levels;
+        levels.push_back({width, height, std::vector<unsigned char>(rgba, rgba + size_t{width} * height * 4)});
+
+        std::vector<float> linear(size_t{width} * height * 4);
+        for (size_t i = 0; i < size_t{width} * height; i++) {
+            for (int k = 0; k < 3; k++) linear[i * 4 + k] = tables.toLinear[rgba[i * 4 + k]];
+            linear[i * 4 + 3] = rgba[i * 4 + 3] / 255.0f;
+        }
+
+        while (width > 1 || height > 1) {
+            uint32_t nextWidth = std::max(1u, width / 2);
+            uint32_t nextHeight = std::max(1u, height / 2);
+            std::vector<float> next(size_t{nextWidth} * nextHeight * 4);
+
+            // 2x2 box filter, odd edges clamp onto the last row/column
+            for (uint32_t y = 0; y < nextHeight; y++) {
+                const float* row0 = &linear[size_t{std::min(2 * y, height - 1)} * width * 4];
+                const float* row1 = &linear[size_t{std::min(2 * y + 1, height - 1)} * width * 4];
+                for (uint32_t x = 0; x < nextWidth; x++) {
+                    size_t x0 = size_t{std::min(2 * x, width - 1)} * 4;
+                    size_t x1 = size_t{std::min(2 * x + 1, width - 1)} * 4;
+                    average4(row0 + x0, row0 + x1, row1 + x0, row1 + x1, &next[(size_t{y} * nextWidth + x) * 4]);
+                }
+            }
+
+            TextureLevelData level{nextWidth, nextHeight, std::vector<unsigned char>(next.size())};
+            for (size_t i = 0; i < next.size(); i += 4) {
+                for (int k = 0; k < 3; k++) {
+                    level.rgba[i + k] = tables.fromLinear[static_cast<size_t>(std::clamp(next[i + k], 0.0f, 1.0f) * LINEAR_TO_SRGB_STEPS + 0.5f)];
+                }
+                level.rgba[i + 3] = static_cast<unsigned char>(std::lround(std::clamp(next[i + 3], 0.0f, 1.0f) * 255.0f));
+            }
+            levels.push_back(std::move(level));
+
+            linear.swap(next);
+            width = nextWidth;
+            height = nextHeight;
+        }
+        return levels;
+    }
+
+    std::vector<unsigned char> AveTextureEncoder::encode(TextureEncoding encoding, const TextureLevelData& level) {
+        if (encoding == TextureEncoding::RGBA8) {
+            return level.rgba;
+        }
+
+        const size_t blockBytes = encoding == TextureEncoding::BC1 ? 8 : 16;
+        const uint32_t blocksWide = (level.width + 3) / 4;
+        const uint32_t blocksHigh = (level.height + 3) / 4;
+        std::vector<unsigned char> encoded(textureLevelSize(vkFormat(encoding), level.width, level.height));
+
+        Block block;
+        for (uint32_t by = 0; by < blocksHigh; by++) {
+            for (uint32_t bx = 0; bx < blocksWide; bx++) {
+                // Blocks hanging over the edge repeat the last texel
+                for (uint32_t i = 0; i < 16; i++) {
+                    uint32_t x = std::min(bx * 4 + i % 4, level.width - 1);
+                    uint32_t y = std::min(by * 4 + i / 4, level.height - 1);
+                    std::memcpy(block[i].data(), &level.rgba[(size_t{y} * level.width + x) * 4], 4);
+                }
+
+                uint8_t* out = &encoded[(size_t{by} * blocksWide + bx) * blockBytes];
+                switch (encoding) {
+                    case TextureEncoding::BC1:
+                        encodeColorBlock(block, out);
+                        break;
+                    case TextureEncoding::BC3:
+                        encodeAlphaBlock(block, out);
+                        encodeColorBlock(block, out + 8);
+                        break;
+                    case TextureEncoding::BC7:
+                        encodeBc7Mode6Block(block, out);
+                        break;
+                    case TextureEncoding::RGBA8:
+                        break;
+                }
+            }
+        }
+        return encoded;
+    }
+}
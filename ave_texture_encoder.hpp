@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace ave {
+
+    // GPU formats the texture cooker can produce, all sRGB
+    enum class TextureEncoding {
+        RGBA8, // uncompressed, 4 bytes per texel
+        BC1,   // 0.5 bytes per texel, alpha is dropped
+        BC3,   // 1 byte per texel, BC1 color plus interpolated alpha
+        BC7,   // 1 byte per texel, mode 6 only (one RGBA endpoint pair with 16 level indices)
+    };
+
+    struct TextureLevelData {
+        uint32_t width;
+        uint32_t height;
+        std::vector<unsigned char> rgba; // sRGB color, linear alpha
+    };
+
+    // CPU side of texture cooking: gamma correct mip generation and block compression
+    class AveTextureEncoder {
+        public:
+            static VkFormat vkFormat(TextureEncoding encoding);
+
+            // Full mip chain down to 1x1, level 0 is the input. Texels are averaged in linear space
+            // and converted back to sRGB, so dark/bright detail does not shift the mean brightness.
+            static std::vector<TextureLevelData> generateMips(const unsigned char* rgba, uint32_t width, uint32_t height);
+
+            // Returns the level in vkFormat(encoding)'s layout, textureLevelSize bytes
+            static std::vector<unsigned char> encode(TextureEncoding encoding, const TextureLevelData& level);
+    };
+}
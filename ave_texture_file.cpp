@@ -0,0 +1,130 @@
+#include "ave_texture_file.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace ave {
+    namespace {
+        uint64_t alignUp(uint64_t value, uint64_t alignment) {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        // Levels down to 1x1, the most an image of this size can have
+        uint32_t maxLevelCount(uint32_t width, uint32_t height) {
+            return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+        }
+    }
+
+    uint64_t textureLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+        uint64_t blocksWide = (uint64_t{width} + 3) / 4;
+        uint64_t blocksHigh = (uint64_t{height} + 3) / 4;
+        switch (format) {
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_R8G8B8A8_UNORM:
+                return uint64_t{width} * height * 4;
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                return blocksWide * blocksHigh * 8;
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+                return blocksWide * blocksHigh * 16;
+            default:
+                throw std::runtime_error("unsupported texture format!");
+        }
+    }
+
+    AveTextureFile::AveTextureFile(const std::string& filePath) : file_{filePath} {
+        if (file_.size() < sizeof(AveTextureHeader)) {
+            throw std::runtime_error("avetex file is truncated: " + filePath);
+        }
+
+        header_ = reinterpret_cast<const AveTextureHeader*>(file_.data());
+
+        if (header_->magic != AVETEX_MAGIC) {
+            throw std::runtime_error("not an avetex file: " + filePath);
+        }
+        if (header_->version != AVETEX_VERSION) {
+            throw std::runtime_error("avetex version mismatch, re-run the cooker: " + filePath);
+        }
+        if (header_->width == 0 || header_->height == 0 || header_->levelCount == 0) {
+            throw std::runtime_error("avetex file has no image: " + filePath);
+        }
+        // Also keeps the level sizes below from shifting the extent by 32 or more
+        if (header_->levelCount > maxLevelCount(header_->width, header_->height)) {
+            throw std::runtime_error("avetex file has more levels than its image: " + filePath);
+        }
+
+        uint64_t levelIndexEnd = header_->levelIndexOffset + uint64_t{header_->levelCount} * sizeof(AveTextureLevel);
+        if (header_->fileSize != file_.size() || levelIndexEnd > file_.size() || header_->dataOffset + header_->dataSize > file_.size()) {
+            throw std::runtime_error("avetex file is truncated: " + filePath);
+        }
+        for (uint32_t i = 0; i < header_->levelCount; i++) {
+            const AveTextureLevel& level = levels()[i];
+            uint64_t expected = textureLevelSize(format(), std::max(1u, header_->width >> i), std::max(1u, header_->height >> i));
+            if (level.size != expected || level.offset % AVETEX_ALIGNMENT != 0 || level.offset + level.size > header_->dataSize) {
+                throw std::runtime_error("avetex level is out of bounds: " + filePath);
+            }
+        }
+    }
+
+    void AveTextureFile::write(
+        const std::string& filePath,
+        VkFormat format,
+        uint32_t width,
+        uint32_t height,
+        const std::vector<std::vector<unsigned char>>& levels) {
+        AveTextureHeader header{};
+        header.magic = AVETEX_MAGIC;
+        header.version = AVETEX_VERSION;
+        header.vkFormat = static_cast<uint32_t>(format);
+        header.width = width;
+        header.height = height;
+        header.levelCount = static_cast<uint32_t>(levels.size());
+        if (levels.empty() || width == 0 || height == 0 || levels.size() > maxLevelCount(width, height)) {
+            throw std::runtime_error("avetex level count does not match the image: " + filePath);
+        }
+
+        std::vector<AveTextureLevel> levelIndex(levels.size());
+        uint64_t offset = 0;
+        for (size_t i = 0; i < levels.size(); i++) {
+            uint64_t expected = textureLevelSize(format, std::max(1u, width >> i), std::max(1u, height >> i));
+            if (levels[i].size() != expected) {
+                throw std::runtime_error("avetex level size does not match its format!");
+            }
+            offset = alignUp(offset, AVETEX_ALIGNMENT);
+            levelIndex[i] = {offset, expected};
+            offset += expected;
+        }
+
+        header.levelIndexOffset = sizeof(AveTextureHeader);
+        header.dataOffset = alignUp(header.levelIndexOffset + levelIndex.size() * sizeof(AveTextureLevel), AVETEX_ALIGNMENT);
+        header.dataSize = offset;
+        header.fileSize = header.dataOffset + header.dataSize;
+
+        std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file for writing: " + filePath);
+        }
+
+        auto writeAt = [&file](uint64_t offset, const void* data, size_t size) {
+            static const char zeros[AVETEX_ALIGNMENT] = {};
+            uint64_t position = static_cast<uint64_t>(file.tellp());
+            file.write(zeros, static_cast<std::streamsize>(offset - position));
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        };
+
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.levelIndexOffset, levelIndex.data(), levelIndex.size() * sizeof(AveTextureLevel));
+        for (size_t i = 0; i < levels.size(); i++) {
+            writeAt(header.dataOffset + levelIndex[i].offset, levels[i].data(), levels[i].size());
+        }
+
+        if (!file.good()) {
+            throw std::runtime_error("failed to write avetex file: " + filePath);
+        }
+    }
+}
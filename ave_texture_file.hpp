@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ave_mapped_file.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ave {
+    // Cooked texture container (.avetex), laid out after KTX2: a fixed header naming the VkFormat, a level
+    // index of byte ranges, then every mip level, largest first. Levels are stored exactly as
+    // vkCmdCopyBufferToImage reads them (tightly packed rows, 4x4 blocks for BC formats), so the whole
+    // chain goes up with one memcpy and one copy command. Little endian.
+    //
+    //   AveTextureHeader | AveTextureLevel[levelCount] | pad | level 0 | pad | level 1 | ...
+    static constexpr uint32_t AVETEX_MAGIC = 0x54455641; // "AVET"
+    static constexpr uint32_t AVETEX_VERSION = 1;
+    static constexpr uint32_t AVETEX_ALIGNMENT = 16;    // covers both texel and block alignment of every format
+
+    struct AveTextureHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vkFormat;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        uint64_t levelIndexOffset;
+        uint64_t dataOffset;
+        uint64_t dataSize;
+        uint64_t fileSize;
+    };
+
+    struct AveTextureLevel {
+        uint64_t offset; // from the start of the level data
+        uint64_t size;
+    };
+
+    // Bytes of one tightly packed level, throws for formats the cooker does not produce
+    uint64_t textureLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
+    class AveTextureFile {
+        public:
+            AveTextureFile(const std::string& filePath);
+
+            AveTextureFile(const AveTextureFile&) = delete;
+            AveTextureFile& operator=(const AveTextureFile&) = delete;
+
+            const AveTextureHeader& header() const { return *header_; }
+            const AveTextureLevel* levels() const { return reinterpret_cast<const AveTextureLevel*>(file_.data() + header_->levelIndexOffset); }
+            const unsigned char* data() const { return reinterpret_cast<const unsigned char*>(file_.data() + header_->dataOffset); }
+
+            VkFormat format() const { return static_cast<VkFormat>(header_->vkFormat); }
+            uint32_t width() const { return header_->width; }
+            uint32_t height() const { return header_->height; }
+            uint32_t levelCount() const { return header_->levelCount; }
+            uint64_t dataSize() const { return header_->dataSize; }
+
+            // levels[i] must hold textureLevelSize(format, width >> i, height >> i) bytes
+            static void write(
+                const std::string& filePath,
+                VkFormat format,
+                uint32_t width,
+                uint32_t height,
+                const std::vector<std::vector<unsigned char>>& levels);
+
+        private:
+            AveMappedFile file_;
+            const AveTextureHeader* header_;
+    };
+}
@@ -0,0 +1,597 @@
+#include "ave_texture_loader.hpp"
+#include "ave_mapped_file.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace ave {
+
+    namespace {
+        // vkCmdCopyBufferToImage wants texel aligned offsets, keep every image on its own 16 bytes
+        constexpr VkDeviceSize UPLOAD_ALIGNMENT = 16;
+
+        const unsigned char PLACEHOLDER_PIXEL[4] = {255, 255, 255, 255};
+
+        bool hasExtension(const std::string& filePath, const std::string& extension) {
+            return filePath.size() >= extension.size() && filePath.compare(filePath.size() - extension.size(), extension.size(), extension) == 0;
+        }
+
+        VkImageView createTextureView(VkDevice device, VkImage image, VkFormat format, uint32_t mipLevels) {
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = format;
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = mipLevels;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            VkImageView imageView;
+            if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create texture image view!");
+            }
+            return imageView;
+        }
+    }
+
+    AveTextureLoader::AveTextureLoader(AveDevice& device, AveThreadPool& threadPool) : aveDevice{device}, threadPool{threadPool} {
+        // Without linear blits PNG/JPG textures stay at one level, cooked textures bring their own mips
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(aveDevice.getPhysicalDevice(), TEXTURE_FORMAT, &formatProperties);
+        canBlitMips_ = formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+        aveDevice.createBuffer(UPLOAD_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uploadBuffer_, uploadBufferMemory_);
+        uploadMapped_ = static_cast<unsigned char*>(uploadBufferMemory_.mapped);
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = aveDevice.getCommandPool();
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(aveDevice.device(), &allocInfo, &batch_.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate texture upload command buffer!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(aveDevice.device(), &fenceInfo, nullptr, &batch_.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture upload fence!");
+        }
+
+        createPlaceholder();
+    }
+
+    AveTextureLoader::~AveTextureLoader() {
+        {
+            // Decode jobs hold `this`, let them finish before tearing anything down
+            std::unique_lock<std::mutex> lock{decodedMutex_};
+            decodesDone_.wait(lock, [this]() { return decodesInFlight_ == 0; });
+            decoded_.clear();
+        }
+
+        if (batch_.inFlight) {
+            vkWaitForFences(aveDevice.device(), 1, &batch_.fence, VK_TRUE, UINT64_MAX);
+            retireBatch();
+        }
+
+        auto destroyTexture = [&](Texture& texture) {
+            if (texture.view != VK_NULL_HANDLE) {
+                aveDevice.getDescriptorAllocator().invalidateImageView(texture.view);
+                vkDestroyImageView(aveDevice.device(), texture.view, nullptr);
+            }
+            if (texture.image != VK_NULL_HANDLE) aveDevice.destroyImage(texture.image, texture.memory);
+        };
+        AveBindlessTextures& bindlessTextures = aveDevice.getBindlessTextures();
+        for (Texture& texture : textures_) {
+            if (texture.residency != UINT32_MAX) {
+                aveDevice.getResidency().untrack(texture.residency);
+            }
+            if (texture.resident) {
+                bindlessTextures.free(texture.slot);
+            }
+            destroyTexture(texture);
+        }
+        bindlessTextures.free(placeholder_.slot);
+        destroyTexture(placeholder_);
+        destroyRetired(true);
+
+        vkDestroyFence(aveDevice.device(), batch_.fence, nullptr);
+        vkFreeCommandBuffers(aveDevice.device(), aveDevice.getCommandPool(), 1, &batch_.commandBuffer);
+        aveDevice.destroyBuffer(uploadBuffer_, uploadBufferMemory_);
+    }
+
+    TextureHandle AveTextureLoader::load(const std::string& filePath) {
+        TextureHandle handle = static_cast<TextureHandle>(textures_.size());
+        textures_.push_back(Texture{filePath});
+        textures_.back().slot = placeholder_.slot;
+        queueDecode(handle);
+        return handle;
+    }
+
+    void AveTextureLoader::queueDecode(TextureHandle handle) {
+        {
+            std::lock_guard<std::mutex> lock{decodedMutex_};
+            decodesInFlight_++;
+        }
+        std::string filePath = textures_[handle].filePath;
+        threadPool.submit([this, handle, filePath]() { decode(handle, filePath); });
+    }
+
+    TextureSlot AveTextureLoader::getSlot(TextureHandle handle) {
+        Texture& texture = textures_[handle];
+        AveResidency& residency = aveDevice.getResidency();
+        if (texture.residency != UINT32_MAX) {
+            residency.touch(texture.residency);
+        }
+        if (texture.evicted && residency.getFrame() >= texture.reloadFrame) {
+            texture.evicted = false;
+            queueDecode(handle);
+        }
+        return texture.slot;
+    }
+
+    void AveTextureLoader::decode(TextureHandle handle, std::string filePath) {
+        DecodedImage image{handle};
+        std::string error;
+        try {
+            if (hasExtension(filePath, ".avetex")) {
+                // Already in its GPU format, the mapping stays alive until the bytes are in the upload buffer
+                auto file = std::make_shared<AveTextureFile>(filePath);
+                image.format = file->format();
+                image.width = file->width();
+                image.height = file->height();
+                image.levels.assign(file->levels(), file->levels() + file->levelCount());
+                image.data = std::shared_ptr<const unsigned char>(file, file->data());
+            } else {
+                AveMappedFile file{filePath};
+                int width, height, channels;
+                stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+                    &width, &height, &channels, STBI_rgb_alpha);
+                if (pixels == nullptr) {
+                    error = "failed to load texture image " + filePath + "!";
+                } else {
+                    image.format = TEXTURE_FORMAT;
+                    image.width = static_cast<uint32_t>(width);
+                    image.height = static_cast<uint32_t>(height);
+                    image.levels.push_back({0, uint64_t{image.width} * image.height * 4});
+                    image.data = std::shared_ptr<const unsigned char>(pixels, stbi_image_free);
+                }
+            }
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+
+        std::lock_guard<std::mutex> lock{decodedMutex_};
+        if (image.data != nullptr) {
+            decoded_.push_back(image);
+        } else {
+            decodeErrors_.push_back(error);
+        }
+        decodesInFlight_--;
+        decodesDone_.notify_all();
+    }
+
+    void AveTextureLoader::update() {
+        if (batch_.inFlight) {
+            VkResult status = vkGetFenceStatus(aveDevice.device(), batch_.fence);
+            if (status == VK_NOT_READY) {
+                return; // the upload buffer is still being read
+            }
+            if (status != VK_SUCCESS) {
+                throw std::runtime_error("failed to wait for texture upload!");
+            }
+            retireBatch();
+        }
+        destroyRetired(false);
+        if (aveDevice.getUploadBatch() != nullptr) {
+            return; // the placeholder pixel in the upload buffer has not been copied yet
+        }
+
+        std::vector<DecodedImage> decoded;
+        {
+            std::lock_guard<std::mutex> lock{decodedMutex_};
+            if (!decodeErrors_.empty()) {
+                std::string error = decodeErrors_.front();
+                decodeErrors_.erase(decodeErrors_.begin());
+                throw std::runtime_error(error);
+            }
+            decoded.swap(decoded_);
+        }
+
+        if (!decoded.empty()) {
+            submitDecoded(decoded);
+        }
+    }
+
+    void AveTextureLoader::submitDecoded(std::vector<DecodedImage>& decoded) {
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(batch_.commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin texture upload command buffer!");
+        }
+
+        std::vector<DecodedImage> leftovers;
+        VkDeviceSize uploadOffset = 0;
+        for (DecodedImage& image : decoded) {
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties(aveDevice.getPhysicalDevice(), image.format, &formatProperties);
+            if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+                throw std::runtime_error("texture format is not supported by the device: " + textures_[image.handle].filePath);
+            }
+
+            VkDeviceSize imageSize = image.size();
+            VkBuffer source = uploadBuffer_;
+            VkDeviceSize sourceOffset = (uploadOffset + UPLOAD_ALIGNMENT - 1) & ~(UPLOAD_ALIGNMENT - 1);
+
+            if (imageSize > UPLOAD_BUFFER_SIZE) {
+                VkBuffer stagingBuffer;
+                AveAllocation stagingBufferMemory;
+                aveDevice.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+                memcpy(stagingBufferMemory.mapped, image.data.get(), static_cast<size_t>(imageSize));
+                batch_.dedicatedStaging.emplace_back(stagingBuffer, stagingBufferMemory);
+                source = stagingBuffer;
+                sourceOffset = 0;
+            } else if (sourceOffset + imageSize > UPLOAD_BUFFER_SIZE) {
+                leftovers.push_back(std::move(image)); // next batch
+                continue;
+            } else {
+                memcpy(uploadMapped_ + sourceOffset, image.data.get(), static_cast<size_t>(imageSize));
+                uploadOffset = sourceOffset + imageSize;
+            }
+
+            Texture& texture = textures_[image.handle];
+            texture.format = image.format;
+            texture.width = image.width;
+            texture.height = image.height;
+            texture.mipLevels = static_cast<uint32_t>(image.levels.size());
+            if (texture.mipLevels == 1 && canBlitMips_) {
+                texture.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(image.width, image.height)))) + 1;
+            }
+            try {
+                aveDevice.createImage(image.width, image.height, texture.mipLevels, VK_SAMPLE_COUNT_1_BIT, texture.format, VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    texture.image, texture.memory);
+            } catch (const AveOutOfDeviceMemory& error) {
+                // Idle textures were already evicted to make room, keep the placeholder and try again later
+                std::cout << "texture loader: no device memory for " << texture.filePath << " (" << error.size / 1024 << " KB), "
+                          << "keeping the placeholder" << std::endl;
+                texture.evicted = true;
+                texture.reloadFrame = aveDevice.getResidency().getFrame() + OUT_OF_MEMORY_RETRY_FRAMES;
+                continue;
+            }
+            recordUpload(batch_.commandBuffer, texture, source, sourceOffset, image);
+            batch_.textures.push_back(image.handle);
+            image.data.reset(); // frees the stbi pixels / unmaps the .avetex
+        }
+
+        if (vkEndCommandBuffer(batch_.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record texture upload command buffer!");
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch_.commandBuffer;
+        vkResetFences(aveDevice.device(), 1, &batch_.fence);
+        if (vkQueueSubmit(aveDevice.graphicsQueue(), 1, &submitInfo, batch_.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit texture upload!");
+        }
+        batch_.inFlight = true;
+
+        if (!leftovers.empty()) {
+            std::lock_guard<std::mutex> lock{decodedMutex_};
+            decoded_.insert(decoded_.begin(), leftovers.begin(), leftovers.end());
+        }
+    }
+
+    void AveTextureLoader::retireBatch() {
+        for (TextureHandle handle : batch_.textures) {
+            Texture& texture = textures_[handle];
+
+            texture.view = createTextureView(aveDevice.device(), texture.image, texture.format, texture.mipLevels);
+            texture.slot = aveDevice.getBindlessTextures().allocate(texture.view);
+            texture.resident = true;
+            residentCount_++;
+
+            AveResidency& residency = aveDevice.getResidency();
+            if (texture.residency == UINT32_MAX) {
+                texture.residency = residency.track(texture.memory.size,
+                    [this, handle](VkCommandBuffer commandBuffer, bool idle) { return trim(handle, commandBuffer, idle); });
+            } else {
+                residency.setSize(texture.residency, texture.memory.size);
+                residency.touch(texture.residency);
+            }
+        }
+        batch_.textures.clear();
+
+        for (auto& staging : batch_.dedicatedStaging) {
+            aveDevice.destroyBuffer(staging.first, staging.second);
+        }
+        batch_.dedicatedStaging.clear();
+        batch_.inFlight = false;
+    }
+
+    void AveTextureLoader::recordUpload(VkCommandBuffer commandBuffer, Texture& texture, VkBuffer buffer, VkDeviceSize offset, const DecodedImage& image) {
+        const uint32_t uploadedLevels = static_cast<uint32_t>(image.levels.size());
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image = texture.image;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = texture.mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier);
+
+        // Every level the image brought along goes up in a single copy
+        std::vector<VkBufferImageCopy> regions(uploadedLevels);
+        for (uint32_t i = 0; i < uploadedLevels; i++) {
+            VkBufferImageCopy& region = regions[i];
+            region.bufferOffset = offset + image.levels[i].offset;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = i;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {std::max(1u, image.width >> i), std::max(1u, image.height >> i), 1};
+        }
+        vkCmdCopyBufferToImage(commandBuffer, buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(regions.size()), regions.data());
+
+        // Uploaded levels no blit reads from are done
+        uint32_t finishedLevels = texture.mipLevels > uploadedLevels ? uploadedLevels - 1 : uploadedLevels;
+        if (finishedLevels > 0) {
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = finishedLevels;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier);
+        }
+        if (finishedLevels == texture.mipLevels) {
+            return;
+        }
+
+        // Rest of the mip chain by successive linear blits, each level goes to SHADER_READ_ONLY once it has been read
+        barrier.subresourceRange.levelCount = 1;
+        int32_t mipWidth = static_cast<int32_t>(std::max(1u, image.width >> (uploadedLevels - 1)));
+        int32_t mipHeight = static_cast<int32_t>(std::max(1u, image.height >> (uploadedLevels - 1)));
+
+        for (uint32_t i = uploadedLevels; i < texture.mipLevels; i++) {
+            barrier.subresourceRange.baseMipLevel = i - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier);
+
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = {0, 0, 0};
+            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = i - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount = 1;
+            blit.dstOffsets[0] = {0, 0, 0};
+            blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = i;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount = 1;
+
+            vkCmdBlitImage(commandBuffer,
+                texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &blit,
+                VK_FILTER_LINEAR);
+
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier);
+
+            if (mipWidth > 1) mipWidth /= 2;
+            if (mipHeight > 1) mipHeight /= 2;
+        }
+
+        barrier.subresourceRange.baseMipLevel = texture.mipLevels - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier);
+    }
+
+    VkDeviceSize AveTextureLoader::trim(TextureHandle handle, VkCommandBuffer commandBuffer, bool idle) {
+        Texture& texture = textures_[handle];
+        if (!texture.resident) {
+            return 0;
+        }
+
+        if (idle) {
+            // No frame in flight samples it, draws recorded from now on get the placeholder's slot
+            VkDeviceSize size = texture.memory.size;
+            aveDevice.getBindlessTextures().free(texture.slot);
+            texture.slot = placeholder_.slot;
+            aveDevice.getDescriptorAllocator().invalidateImageView(texture.view);
+            vkDestroyImageView(aveDevice.device(), texture.view, nullptr);
+            aveDevice.destroyImage(texture.image, texture.memory);
+            texture.view = VK_NULL_HANDLE;
+            texture.image = VK_NULL_HANDLE;
+            texture.resident = false;
+            texture.evicted = true;
+            texture.reloadFrame = 0;
+            residentCount_--;
+            return size;
+        }
+
+        if (commandBuffer == VK_NULL_HANDLE || texture.mipLevels < 2 || std::max(texture.width, texture.height) / 2 < MIN_TRIMMED_SIZE) {
+            return 0;
+        }
+        return dropTopMip(texture, commandBuffer);
+    }
+
+    VkDeviceSize AveTextureLoader::dropTopMip(Texture& texture, VkCommandBuffer commandBuffer) {
+        // Level i of the smaller image is level i + 1 of the current one, so every level is a plain copy
+        uint32_t width = std::max(1u, texture.width >> 1);
+        uint32_t height = std::max(1u, texture.height >> 1);
+        uint32_t mipLevels = texture.mipLevels - 1;
+
+        VkImage image;
+        AveAllocation memory;
+        try {
+            aveDevice.createImage(width, height, mipLevels, VK_SAMPLE_COUNT_1_BIT, texture.format, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                image, memory);
+        } catch (const AveOutOfDeviceMemory&) {
+            return 0;
+        }
+
+        std::array<VkImageMemoryBarrier, 2> barriers{};
+        for (VkImageMemoryBarrier& barrier : barriers) {
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.levelCount = mipLevels;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+        }
+        barriers[0].image = texture.image;
+        barriers[0].subresourceRange.baseMipLevel = 1;
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barriers[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barriers[1].image = image;
+        barriers[1].subresourceRange.baseMipLevel = 0;
+        barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[1].srcAccessMask = 0;
+        barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr,
+            0, nullptr,
+            static_cast<uint32_t>(barriers.size()), barriers.data());
+
+        std::vector<VkImageCopy> regions(mipLevels);
+        for (uint32_t i = 0; i < mipLevels; i++) {
+            VkImageCopy& region = regions[i];
+            region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i + 1, 0, 1};
+            region.srcOffset = {0, 0, 0};
+            region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1};
+            region.dstOffset = {0, 0, 0};
+            region.extent = {std::max(1u, width >> i), std::max(1u, height >> i), 1};
+        }
+        vkCmdCopyImage(commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(regions.size()), regions.data());
+
+        barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+            0, nullptr,
+            0, nullptr,
+            1, &barriers[1]);
+
+        // Frames in flight may still sample the old image through its slot, the new view gets a slot of its own
+        AveBindlessTextures& bindlessTextures = aveDevice.getBindlessTextures();
+        VkDeviceSize freed = texture.memory.size > memory.size ? texture.memory.size - memory.size : 0;
+        retired_.push_back({texture.image, texture.memory, texture.view, aveDevice.getResidency().getFrame() + MAX_FRAMES_IN_FLIGHT});
+        bindlessTextures.free(texture.slot);
+        texture.image = image;
+        texture.memory = memory;
+        texture.view = createTextureView(aveDevice.device(), image, texture.format, mipLevels);
+        texture.slot = bindlessTextures.allocate(texture.view);
+        texture.width = width;
+        texture.height = height;
+        texture.mipLevels = mipLevels;
+        return freed;
+    }
+
+    void AveTextureLoader::destroyRetired(bool all) {
+        uint64_t frame = aveDevice.getResidency().getFrame();
+        auto done = std::remove_if(retired_.begin(), retired_.end(), [&](RetiredImage& retired) {
+            if (!all && retired.frame > frame) {
+                return false;
+            }
+            aveDevice.getDescriptorAllocator().invalidateImageView(retired.view);
+            vkDestroyImageView(aveDevice.device(), retired.view, nullptr);
+            aveDevice.destroyImage(retired.image, retired.memory);
+            return true;
+        });
+        retired_.erase(done, retired_.end());
+    }
+
+    void AveTextureLoader::createPlaceholder() {
+        // Goes through the regular upload path as a single time command, so it joins the startup upload batch
+        // when one is open. The view is valid right away, the pixel lands before any frame is submitted.
+        DecodedImage image{0, nullptr, TEXTURE_FORMAT, 1, 1, {{0, sizeof(PLACEHOLDER_PIXEL)}}};
+        placeholder_.format = TEXTURE_FORMAT;
+        placeholder_.mipLevels = 1;
+        aveDevice.createImage(1, 1, 1, VK_SAMPLE_COUNT_1_BIT, TEXTURE_FORMAT, VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            placeholder_.image, placeholder_.memory);
+        memcpy(uploadMapped_, PLACEHOLDER_PIXEL, sizeof(PLACEHOLDER_PIXEL));
+
+        VkCommandBuffer commandBuffer = aveDevice.beginSingleTimeCommands();
+        recordUpload(commandBuffer, placeholder_, uploadBuffer_, 0, image);
+        aveDevice.endSingleTimeCommands(commandBuffer);
+
+        placeholder_.view = createTextureView(aveDevice.device(), placeholder_.image, placeholder_.format, 1);
+        placeholder_.slot = aveDevice.getBindlessTextures().allocate(placeholder_.view);
+        placeholder_.resident = true;
+    }
+}
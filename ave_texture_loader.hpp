@@ -0,0 +1,133 @@
+#pragma once
+
+#include "ave_device.hpp"
+#include "ave_texture_file.hpp"
+#include "ave_thread_pool.hpp"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ave {
+
+    using TextureHandle = uint32_t;
+
+    // Streams textures in without blocking the frame loop. load() queues the PNG/JPG decode (or the .avetex
+    // map) on the thread pool and returns at once; update() (main thread, once per frame) copies every
+    // decoded image into one shared upload buffer and records copies plus mip generation into a single
+    // submit guarded by a fence. Cooked .avetex files carry their whole mip chain in the final GPU format,
+    // so they go up with one copy and no blits.
+    // A texture turns resident once that fence signals and gets a slot in the device's AveBindlessTextures,
+    // until then getSlot() hands out the slot of a 1x1 white placeholder so shaders always sample something valid.
+    //
+    // Resident textures are tracked by the device's AveResidency and touched by getSlot(). Over budget
+    // they lose their top mip level, or are dropped back to the placeholder once no frame in flight uses them;
+    // a dropped texture is decoded again the next time its slot is asked for. A texture that does not fit in
+    // device memory at all stays on the placeholder and is retried after OUT_OF_MEMORY_RETRY_FRAMES.
+    class AveTextureLoader {
+        public:
+            static constexpr VkDeviceSize UPLOAD_BUFFER_SIZE = 64 * 1024 * 1024;
+            static constexpr VkFormat TEXTURE_FORMAT = VK_FORMAT_R8G8B8A8_SRGB; // of decoded PNG/JPG files
+            static constexpr uint32_t MIN_TRIMMED_SIZE = 64; // trimming stops before the top level gets smaller
+            static constexpr uint64_t OUT_OF_MEMORY_RETRY_FRAMES = 240;
+
+            AveTextureLoader(AveDevice& device, AveThreadPool& threadPool);
+            ~AveTextureLoader();
+
+            AveTextureLoader(const AveTextureLoader&) = delete;
+            AveTextureLoader& operator=(const AveTextureLoader&) = delete;
+
+            TextureHandle load(const std::string& filePath);
+
+            // Retires the in flight upload if its fence signaled and submits whatever finished decoding since.
+            // Throws if a queued file failed to decode or its format cannot be sampled on this device.
+            void update();
+
+            bool isResident(TextureHandle handle) const { return textures_[handle].resident; }
+            // Bindless slot to sample this frame, changes when the texture turns resident or is trimmed so look it
+            // up every frame. Marks the texture used, call while recording the frame that samples it.
+            TextureSlot getSlot(TextureHandle handle);
+            uint32_t getMipLevels(TextureHandle handle) const { return textures_[handle].mipLevels; }
+
+            // Textures queued but not yet resident
+            size_t pendingCount() const { return textures_.size() - residentCount_; }
+
+        private:
+            struct Texture {
+                std::string filePath;
+                VkImage image = VK_NULL_HANDLE;
+                AveAllocation memory;
+                VkImageView view = VK_NULL_HANDLE;
+                TextureSlot slot = 0;
+                VkFormat format = TEXTURE_FORMAT;
+                uint32_t width = 0;
+                uint32_t height = 0;
+                uint32_t mipLevels = 1;
+                bool resident = false;
+                bool evicted = false;    // decoded again on next use
+                uint64_t reloadFrame = 0; // residency frame an evicted texture may come back at
+                ResidencyId residency = UINT32_MAX;
+            };
+
+            // An image replaced by a trimmed copy, frames in flight may still sample it
+            struct RetiredImage {
+                VkImage image;
+                AveAllocation memory;
+                VkImageView view;
+                uint64_t frame; // residency frame from which it can be destroyed
+            };
+
+            struct DecodedImage {
+                TextureHandle handle;
+                std::shared_ptr<const unsigned char> data; // stbi pixels, or points into the mapped .avetex
+                VkFormat format;
+                uint32_t width;
+                uint32_t height;
+                std::vector<AveTextureLevel> levels; // byte ranges in data, missing levels are blitted
+
+                VkDeviceSize size() const { return levels.back().offset + levels.back().size; }
+            };
+
+            struct UploadBatch {
+                VkFence fence = VK_NULL_HANDLE;
+                VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+                std::vector<TextureHandle> textures;
+                // Images too large for the shared upload buffer get their own staging buffer for one batch
+                std::vector<std::pair<VkBuffer, AveAllocation>> dedicatedStaging;
+                bool inFlight = false;
+            };
+
+            void decode(TextureHandle handle, std::string filePath);
+            void submitDecoded(std::vector<DecodedImage>& decoded);
+            void retireBatch();
+            void recordUpload(VkCommandBuffer commandBuffer, Texture& texture, VkBuffer buffer, VkDeviceSize offset, const DecodedImage& image);
+            void createPlaceholder();
+            void queueDecode(TextureHandle handle);
+            VkDeviceSize trim(TextureHandle handle, VkCommandBuffer commandBuffer, bool idle);
+            VkDeviceSize dropTopMip(Texture& texture, VkCommandBuffer commandBuffer);
+            void destroyRetired(bool all);
+
+            AveDevice& aveDevice;
+            AveThreadPool& threadPool;
+
+            std::vector<Texture> textures_;
+            size_t residentCount_ = 0;
+            Texture placeholder_;
+            bool canBlitMips_;
+
+            VkBuffer uploadBuffer_;
+            AveAllocation uploadBufferMemory_;
+            unsigned char* uploadMapped_;
+            UploadBatch batch_;
+            std::vector<RetiredImage> retired_;
+
+            // Written by decode jobs
+            std::mutex decodedMutex_;
+            std::condition_variable decodesDone_;
+            std::vector<DecodedImage> decoded_;
+            std::vector<std::string> decodeErrors_;
+            size_t decodesInFlight_ = 0;
+    };
+}
@@ -0,0 +1,63 @@
+#include "ave_thread_pool.hpp"
+
+#include <algorithm>
+
+namespace ave {
+
+    AveThreadPool::AveThreadPool(unsigned threadCount) {
+        if (threadCount == 0) {
+            threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+        workers_.reserve(threadCount);
+        for (unsigned i = 0; i < threadCount; i++) {
+            workers_.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    AveThreadPool::~AveThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            stopping_ = true;
+        }
+        jobAvailable_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void AveThreadPool::submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            jobs_.push_back(std::move(job));
+        }
+        jobAvailable_.notify_one();
+    }
+
+    void AveThreadPool::waitIdle() {
+        std::unique_lock<std::mutex> lock{mutex_};
+        idle_.wait(lock, [this]() { return jobs_.empty() && runningJobs_ == 0; });
+    }
+
+    void AveThreadPool::workerLoop() {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while (true) {
+            jobAvailable_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) {
+                return; // stopping, queued jobs are drained first
+            }
+
+            std::function<void()> job = std::move(jobs_.front());
+            jobs_.pop_front();
+            runningJobs_++;
+
+            lock.unlock();
+            job();
+            lock.lock();
+
+            runningJobs_--;
+            if (jobs_.empty() && runningJobs_ == 0) {
+                idle_.notify_all();
+            }
+        }
+    }
+}
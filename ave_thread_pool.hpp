@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ave {
+    // Fixed set of worker threads draining a FIFO of jobs. Jobs must not throw; catch inside the job
+    // and hand the error back to whoever is waiting for its result.
+    class AveThreadPool {
+        public:
+            // threadCount 0 uses every core but one, leaving the main thread to record frames
+            explicit AveThreadPool(unsigned threadCount = 0);
+            ~AveThreadPool();
+
+            AveThreadPool(const AveThreadPool&) = delete;
+            AveThreadPool& operator=(const AveThreadPool&) = delete;
+
+            void submit(std::function<void()> job);
+
+            // Blocks until the queue is empty and no job is running
+            void waitIdle();
+
+            size_t threadCount() const { return workers_.size(); }
+
+        private:
+            void workerLoop();
+
+            std::vector<std::thread> workers_;
+            std::deque<std::function<void()>> jobs_;
+            std::mutex mutex_;
+            std::condition_variable jobAvailable_;
+            std::condition_variable idle_;
+            size_t runningJobs_ = 0;
+            bool stopping_ = false;
+    };
+}
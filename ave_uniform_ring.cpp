@@ -0,0 +1,38 @@
+#include "ave_uniform_ring.hpp"
+#include "ave_device.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ave {
+
+    AveUniformRing::AveUniformRing(AveDevice& device, VkDeviceSize frameSize) : aveDevice{device} {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(aveDevice.getPhysicalDevice(), &properties);
+        alignment_ = std::max<VkDeviceSize>(1, properties.limits.minUniformBufferOffsetAlignment);
+        frameSize_ = (frameSize + alignment_ - 1) / alignment_ * alignment_;
+
+        aveDevice.createBuffer(frameSize_ * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer_, memory_);
+        mapped_ = static_cast<unsigned char*>(memory_.mapped);
+    }
+
+    AveUniformRing::~AveUniformRing() {
+        aveDevice.destroyBuffer(buffer_, memory_);
+    }
+
+    void AveUniformRing::beginFrame(uint32_t frameIndex) {
+        frameIndex_ = frameIndex;
+        head_ = frameIndex * frameSize_;
+    }
+
+    uint32_t AveUniformRing::push(const void* data, VkDeviceSize size) {
+        VkDeviceSize offset = (head_ + alignment_ - 1) / alignment_ * alignment_;
+        if (offset + size > (frameIndex_ + 1) * frameSize_) {
+            throw std::runtime_error("uniform ring out of space for this frame!");
+        }
+        memcpy(mapped_ + offset, data, static_cast<size_t>(size));
+        head_ = offset + size;
+        return static_cast<uint32_t>(offset);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ave_allocator.hpp"
+#include "ave_constants.h"
+
+namespace ave {
+
+    class AveDevice;
+
+    // Per frame bump allocator for per object shader data. One persistently mapped buffer is split into
+    // MAX_FRAMES_IN_FLIGHT slices; each draw copies its data into the current frame's slice and binds it
+    // with a dynamic offset into a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC descriptor, so objects cost
+    // bytes in the ring instead of buffers and descriptor sets of their own. A slice is reused by
+    // beginFrame() once the frame's fence was waited on.
+    class AveUniformRing {
+        public:
+            static constexpr VkDeviceSize FRAME_SIZE = 4 * 1024 * 1024; // 16k objects at 256 byte alignment
+
+            AveUniformRing(AveDevice& device, VkDeviceSize frameSize = FRAME_SIZE);
+            ~AveUniformRing();
+
+            AveUniformRing(const AveUniformRing&) = delete;
+            AveUniformRing& operator=(const AveUniformRing&) = delete;
+
+            void beginFrame(uint32_t frameIndex);
+
+            // Copies data into this frame's slice, returns the dynamic offset to bind it with. Throws when the slice is full.
+            uint32_t push(const void* data, VkDeviceSize size);
+            template<typename T>
+            uint32_t push(const T& value) { return push(&value, sizeof(T)); }
+
+            // Write into the descriptor with offset 0 and the per object size as range
+            VkBuffer getBuffer() const { return buffer_; }
+            VkDeviceSize getUsed() const { return head_ - frameIndex_ * frameSize_; } // bytes pushed this frame
+
+        private:
+            AveDevice& aveDevice;
+            VkBuffer buffer_;
+            AveAllocation memory_;
+            unsigned char* mapped_;
+            VkDeviceSize frameSize_;
+            VkDeviceSize alignment_;
+
+            uint32_t frameIndex_ = 0;
+            VkDeviceSize head_ = 0; // absolute offset into the buffer
+    };
+}
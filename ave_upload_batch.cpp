@@ -0,0 +1,74 @@
+#include "ave_upload_batch.hpp"
+#include "ave_device.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+namespace ave {
+
+    AveUploadBatch::AveUploadBatch(AveDevice& device) : aveDevice{device} {
+        if (aveDevice.getUploadBatch() != nullptr) {
+            throw std::runtime_error("upload batch already open!");
+        }
+        commandBuffer_ = aveDevice.beginSingleTimeCommands();
+        aveDevice.setUploadBatch(this);
+        queueUploadsAtStart_ = aveDevice.getUploadQueue().getUploadCount();
+        queueSubmitsAtStart_ = aveDevice.getUploadQueue().getSubmitCount();
+    }
+
+    AveUploadBatch::~AveUploadBatch() {
+        if (isOpen()) {
+            submit();
+        }
+    }
+
+    void AveUploadBatch::endOperation() {
+        // Each scope used to be its own submit followed by a wait, keep later scopes behind earlier ones
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer_, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+            1, &barrier, 0, nullptr, 0, nullptr);
+        operations_++;
+    }
+
+    void AveUploadBatch::deferDestroy(VkBuffer buffer, const AveAllocation& memory) {
+        deferred_.emplace_back(buffer, memory);
+    }
+
+    void AveUploadBatch::submit() {
+        aveDevice.setUploadBatch(nullptr);
+        aveDevice.getUploadQueue().flush();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        aveDevice.endSingleTimeCommands(commandBuffer_); // one submit, one fence wait
+        auto end = std::chrono::high_resolution_clock::now();
+        commandBuffer_ = VK_NULL_HANDLE;
+
+        for (auto& buffer : deferred_) {
+            aveDevice.destroyBuffer(buffer.first, buffer.second);
+        }
+        deferred_.clear();
+
+        // What each avoided submit would have cost at the very least: an empty submission's round trip
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        VkFence fence;
+        if (vkCreateFence(aveDevice.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload batch fence!");
+        }
+        auto probeStart = std::chrono::high_resolution_clock::now();
+        vkQueueSubmit(aveDevice.graphicsQueue(), 0, nullptr, fence);
+        vkWaitForFences(aveDevice.device(), 1, &fence, VK_TRUE, UINT64_MAX);
+        auto probeEnd = std::chrono::high_resolution_clock::now();
+        vkDestroyFence(aveDevice.device(), fence, nullptr);
+
+        AveUploadQueue& uploadQueue = aveDevice.getUploadQueue();
+        stats_.operations = operations_ + (uploadQueue.getUploadCount() - queueUploadsAtStart_);
+        stats_.submits = 1 + (uploadQueue.getSubmitCount() - queueSubmitsAtStart_);
+        stats_.milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(end - start).count();
+        float roundTrip = std::chrono::duration<float, std::chrono::milliseconds::period>(probeEnd - probeStart).count();
+        stats_.savedMilliseconds = stats_.operations > stats_.submits ? (stats_.operations - stats_.submits) * roundTrip : 0.0f;
+    }
+}
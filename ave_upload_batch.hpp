@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ave_allocator.hpp"
+
+#include <utility>
+#include <vector>
+
+namespace ave {
+
+    class AveDevice;
+
+    struct UploadBatchStats {
+        uint32_t operations;      // single time command scopes plus upload queue copies folded into this batch
+        uint32_t submits;         // queue submissions it took, the batch's own one included
+        float milliseconds;       // submit to fence wait of the batch
+        float savedMilliseconds;  // estimate: avoided submits times one measured empty submit round trip
+    };
+
+    // Collects the one-off initialization work of a loading phase (layout transitions, buffer and image copies,
+    // mip blits) into a single graphics submit with a single fence wait. While a batch is open,
+    // AveDevice::beginSingleTimeCommands hands out the batch's command buffer and endSingleTimeCommands only
+    // records a barrier that keeps the old "previous operation finished" ordering, so the existing helpers
+    // batch without changes. Nothing recorded executes before submit(), resources that used to be freed right
+    // after their copy have to go through deferDestroy().
+    class AveUploadBatch {
+        public:
+            AveUploadBatch(AveDevice& device);
+            ~AveUploadBatch(); // submits if still open
+
+            AveUploadBatch(const AveUploadBatch&) = delete;
+            AveUploadBatch& operator=(const AveUploadBatch&) = delete;
+
+            VkCommandBuffer getCommandBuffer() const { return commandBuffer_; }
+            // Called by AveDevice::endSingleTimeCommands
+            void endOperation();
+            // Destroys the buffer once the batch has executed
+            void deferDestroy(VkBuffer buffer, const AveAllocation& memory);
+
+            // Also flushes the upload queue so copies queued during the phase go out with it
+            void submit();
+            bool isOpen() const { return commandBuffer_ != VK_NULL_HANDLE; }
+            const UploadBatchStats& getStats() const { return stats_; }
+
+        private:
+            AveDevice& aveDevice;
+            VkCommandBuffer commandBuffer_ = VK_NULL_HANDLE;
+            std::vector<std::pair<VkBuffer, AveAllocation>> deferred_;
+            uint32_t operations_ = 0;
+            uint32_t queueUploadsAtStart_;
+            uint32_t queueSubmitsAtStart_;
+            UploadBatchStats stats_{};
+    };
+}
@@ -0,0 +1,235 @@
+#include "ave_upload_queue.hpp"
+#include "ave_device.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace ave {
+
+    AveUploadQueue::AveUploadQueue(AveDevice& device, uint32_t transferFamily, VkQueue transferQueue, uint32_t graphicsFamily)
+        : aveDevice{device}, transferFamily_{transferFamily}, graphicsFamily_{graphicsFamily}, transferQueue_{transferQueue},
+          staging_{device, STAGING_SIZE} {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = transferFamily_;
+
+        if (vkCreateCommandPool(aveDevice.device(), &poolInfo, nullptr, &commandPool_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload command pool!");
+        }
+    }
+
+    AveUploadQueue::~AveUploadQueue() {
+        flush();
+        retire(UINT64_MAX);
+        for (Batch& batch : spare_) {
+            vkDestroyFence(aveDevice.device(), batch.fence, nullptr);
+        }
+        vkDestroyCommandPool(aveDevice.device(), commandPool_, nullptr); // frees the batches' command buffers
+    }
+
+    UploadToken AveUploadQueue::uploadBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset,
+            VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+        if (size == 0) {
+            return 0;
+        }
+
+        VkDeviceSize stagingOffset = 0;
+        bool staged = staging_.allocate(size, stagingOffset);
+        if (!staged && size <= staging_.getSize()) {
+            // The ring is full of copies still in flight, submit what is recorded and retire until it fits
+            flush();
+            while (!staged && !inFlight_.empty()) {
+                retire(inFlight_.front().token);
+                staged = staging_.allocate(size, stagingOffset);
+            }
+        }
+        if (open_.commandBuffer == VK_NULL_HANDLE) {
+            beginBatch();
+        }
+
+        VkBufferCopy copyRegion{};
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = size;
+        if (staged) {
+            memcpy(staging_.getMapped() + stagingOffset, data, static_cast<size_t>(size));
+            copyRegion.srcOffset = stagingOffset;
+            vkCmdCopyBuffer(open_.commandBuffer, staging_.getBuffer(), dstBuffer, 1, &copyRegion);
+        } else {
+            VkBuffer temporary;
+            AveAllocation temporaryMemory;
+            aveDevice.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, temporary, temporaryMemory);
+            memcpy(temporaryMemory.mapped, data, static_cast<size_t>(size));
+            open_.temporaries.emplace_back(temporary, temporaryMemory);
+            vkCmdCopyBuffer(open_.commandBuffer, temporary, dstBuffer, 1, &copyRegion);
+        }
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.buffer = dstBuffer;
+        barrier.offset = dstOffset;
+        barrier.size = size;
+        if (usesTransferQueue()) {
+            // Release half of the ownership transfer, the acquire half goes on the graphics queue
+            barrier.srcQueueFamilyIndex = transferFamily_;
+            barrier.dstQueueFamilyIndex = graphicsFamily_;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            vkCmdPipelineBarrier(open_.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                0, 0, nullptr, 1, &barrier, 0, nullptr);
+            barrier.srcAccessMask = 0;
+        } else {
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        }
+        barrier.dstAccessMask = dstAccess;
+        open_.acquires.push_back(barrier);
+        open_.dstStages |= dstStage;
+        uploadCount_++;
+        return open_.token;
+    }
+
+    void AveUploadQueue::flush() {
+        if (open_.commandBuffer == VK_NULL_HANDLE) {
+            return;
+        }
+
+        if (vkEndCommandBuffer(open_.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record upload command buffer!");
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &open_.commandBuffer;
+        if (vkQueueSubmit(transferQueue_, 1, &submitInfo, open_.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+
+        submitCount_++;
+        open_.stagingEnd = staging_.getHead();
+        inFlight_.push_back(std::move(open_));
+        open_ = Batch{};
+    }
+
+    void AveUploadQueue::beginFrame(uint32_t frameIndex) {
+        completedToken_ = std::max(completedToken_, frameTokens_[frameIndex]);
+        currentFrame_ = frameIndex;
+    }
+
+    void AveUploadQueue::update(VkCommandBuffer graphicsCommandBuffer) {
+        retire(0);
+        recordAcquires(graphicsCommandBuffer);
+        frameTokens_[currentFrame_] = retiredToken_;
+        flush();
+    }
+
+    void AveUploadQueue::wait(UploadToken token) {
+        if (isComplete(token)) {
+            return;
+        }
+        if (open_.commandBuffer != VK_NULL_HANDLE && open_.token <= token) {
+            flush();
+        }
+        retire(token);
+
+        VkCommandBuffer commandBuffer = aveDevice.beginSingleTimeCommands();
+        recordAcquires(commandBuffer);
+        aveDevice.endSingleTimeCommands(commandBuffer);
+
+        // The one-off submit has finished, but earlier tokens may have been acquired by frames whose fence has not
+        // signaled yet, those complete with the current frame
+        bool framesPending = false;
+        for (UploadToken frameToken : frameTokens_) {
+            framesPending |= frameToken > completedToken_;
+        }
+        if (framesPending) {
+            frameTokens_[currentFrame_] = retiredToken_;
+        } else {
+            completedToken_ = retiredToken_;
+        }
+    }
+
+    void AveUploadQueue::wait(UploadToken token, VkCommandBuffer graphicsCommandBuffer) {
+        if (isComplete(token) || token <= frameTokens_[currentFrame_]) {
+            return;
+        }
+        if (open_.commandBuffer != VK_NULL_HANDLE && open_.token <= token) {
+            flush();
+        }
+        retire(token);
+        recordAcquires(graphicsCommandBuffer);
+        frameTokens_[currentFrame_] = retiredToken_;
+    }
+
+    void AveUploadQueue::beginBatch() {
+        if (spare_.empty()) {
+            Batch batch;
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandPool = commandPool_;
+            allocInfo.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(aveDevice.device(), &allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate upload command buffer!");
+            }
+
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(aveDevice.device(), &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create upload fence!");
+            }
+            spare_.push_back(std::move(batch));
+        }
+
+        open_ = std::move(spare_.back());
+        spare_.pop_back();
+        open_.token = nextToken_++;
+
+        // The pool allows per buffer resets, beginning a retired command buffer resets it implicitly
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(open_.commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin upload command buffer!");
+        }
+    }
+
+    void AveUploadQueue::retire(UploadToken waitFor) {
+        while (!inFlight_.empty()) {
+            Batch& batch = inFlight_.front();
+            if (batch.token <= waitFor) {
+                vkWaitForFences(aveDevice.device(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+            } else if (vkGetFenceStatus(aveDevice.device(), batch.fence) != VK_SUCCESS) {
+                break; // batches finish in submission order, later ones are not done either
+            }
+
+            staging_.release(batch.stagingEnd);
+            for (auto& temporary : batch.temporaries) {
+                aveDevice.destroyBuffer(temporary.first, temporary.second);
+            }
+            pendingAcquires_.insert(pendingAcquires_.end(), batch.acquires.begin(), batch.acquires.end());
+            pendingStages_ |= batch.dstStages;
+            retiredToken_ = batch.token;
+
+            vkResetFences(aveDevice.device(), 1, &batch.fence);
+            batch.temporaries.clear();
+            batch.acquires.clear();
+            batch.dstStages = 0;
+            spare_.push_back(std::move(batch));
+            inFlight_.pop_front();
+        }
+    }
+
+    void AveUploadQueue::recordAcquires(VkCommandBuffer graphicsCommandBuffer) {
+        if (!pendingAcquires_.empty()) {
+            vkCmdPipelineBarrier(graphicsCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, pendingStages_,
+                0, 0, nullptr, static_cast<uint32_t>(pendingAcquires_.size()), pendingAcquires_.data(), 0, nullptr);
+            pendingAcquires_.clear();
+            pendingStages_ = 0;
+        }
+    }
+}
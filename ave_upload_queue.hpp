@@ -0,0 +1,103 @@
+#pragma once
+
+#include "ave_constants.h"
+#include "ave_staging_ring.hpp"
+
+#include <array>
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace ave {
+
+    class AveDevice;
+
+    // Completion token of an upload, tokens grow monotonically and 0 means "nothing to wait for"
+    using UploadToken = uint64_t;
+
+    // Asynchronous buffer uploads for load time data. Copies are recorded into a batch that goes to the
+    // dedicated transfer queue when the device has one (the graphics queue otherwise) with a fence per
+    // batch, so nothing on the CPU or the graphics queue waits for them.
+    //
+    // With a separate transfer family the destination buffers change queue family ownership: the batch
+    // releases them after the copy and update() records the matching acquire barriers into the frame's
+    // graphics command buffer once the batch's fence has signaled. With a shared family the same spot gets
+    // a plain transfer -> consumer barrier. A token only reports complete once the fence of the frame that
+    // recorded that barrier has signaled, so "complete" holds for any command buffer, including one-off
+    // submits that may run ahead of a frame still being recorded.
+    class AveUploadQueue {
+        public:
+            static constexpr VkDeviceSize STAGING_SIZE = 32 * 1024 * 1024;
+
+            AveUploadQueue(AveDevice& device, uint32_t transferFamily, VkQueue transferQueue, uint32_t graphicsFamily);
+            ~AveUploadQueue();
+
+            AveUploadQueue(const AveUploadQueue&) = delete;
+            AveUploadQueue& operator=(const AveUploadQueue&) = delete;
+
+            // Queues a copy of data into dstBuffer, which graphics work will then access at dstStage/dstAccess.
+            // data is copied out before this returns. The copy is submitted by the next flush()/update().
+            UploadToken uploadBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset,
+                VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+            // Submits the batch being recorded, if any
+            void flush();
+
+            // Call after the frame's in flight fence was waited on, completes the tokens that frame acquired
+            void beginFrame(uint32_t frameIndex);
+
+            // Main thread, once per frame and outside a render pass: retires finished batches and records their
+            // acquire barriers into commandBuffer, then submits whatever was queued since the last call
+            void update(VkCommandBuffer graphicsCommandBuffer);
+
+            bool isComplete(UploadToken token) const { return token <= completedToken_; }
+
+            // Blocks until the token's batch finished and records the barriers update() has not recorded yet on a
+            // one-off graphics submit. Commands submitted after this may use the data, so call it between frames:
+            // barriers already in a frame command buffer that is still being recorded would come too late.
+            void wait(UploadToken token);
+            // Same, but records the barriers into the frame's command buffer (after update(), outside a render
+            // pass) for commands recorded after them in it
+            void wait(UploadToken token, VkCommandBuffer graphicsCommandBuffer);
+
+            bool usesTransferQueue() const { return transferFamily_ != graphicsFamily_; }
+            uint32_t getUploadCount() const { return uploadCount_; }
+            uint32_t getSubmitCount() const { return submitCount_; }
+
+        private:
+            struct Batch {
+                VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+                VkFence fence = VK_NULL_HANDLE;
+                UploadToken token = 0;
+                uint64_t stagingEnd = 0;
+                VkPipelineStageFlags dstStages = 0;
+                std::vector<VkBufferMemoryBarrier> acquires;
+                std::vector<std::pair<VkBuffer, AveAllocation>> temporaries; // payloads larger than the ring
+            };
+
+            void beginBatch();
+            void retire(UploadToken waitFor); // waits for batches up to waitFor, polls the rest
+            void recordAcquires(VkCommandBuffer graphicsCommandBuffer);
+
+            AveDevice& aveDevice;
+            uint32_t transferFamily_;
+            uint32_t graphicsFamily_;
+            VkQueue transferQueue_;
+            VkCommandPool commandPool_;
+            AveStagingRing staging_;
+
+            Batch open_;                    // being recorded, commandBuffer is null when there is none
+            std::deque<Batch> inFlight_;    // submission order
+            std::vector<Batch> spare_;      // retired, command buffer and fence ready for reuse
+
+            UploadToken nextToken_ = 1;
+            UploadToken retiredToken_ = 0;  // fence signaled, barriers not recorded yet
+            UploadToken completedToken_ = 0;
+            uint32_t currentFrame_ = 0;
+            std::array<UploadToken, MAX_FRAMES_IN_FLIGHT> frameTokens_{}; // acquired by the frame's command buffer
+            VkPipelineStageFlags pendingStages_ = 0;
+            std::vector<VkBufferMemoryBarrier> pendingAcquires_;
+            uint32_t uploadCount_ = 0;
+            uint32_t submitCount_ = 0;
+    };
+}
@@ -0,0 +1,116 @@
+#include "ave_vertex_layout.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace ave {
+
+    namespace {
+        bool inUnitRange(float value) {
+            return value >= 0.0f && value <= 1.0f;
+        }
+
+        // Bits of a float word with -0.0f replaced by 0.0f, so words that compare equal as floats hash the same
+        uint32_t canonicalZero(uint32_t word) {
+            return word == 0x80000000u ? 0u : word;
+        }
+
+        float signNotZero(float value) {
+            return value >= 0.0f ? 1.0f : -1.0f;
+        }
+
+        // Octahedral normal encoding (Meyer et al. 2010), the inverse lives in shader_packed.vert
+        glm::vec2 encodeOctahedral(glm::vec3 n) {
+            float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+            if (l1 == 0.0f) {
+                return glm::vec2{0.0f}; // degenerate normals decode to +z
+            }
+            n /= l1;
+            if (n.z < 0.0f) {
+                return glm::vec2{(1.0f - std::abs(n.y)) * signNotZero(n.x), (1.0f - std::abs(n.x)) * signNotZero(n.y)};
+            }
+            return glm::vec2{n.x, n.y};
+        }
+    }
+
+    size_t hashVertex(const Vertex& vertex) {
+        // xxHash32's stripe loop: four independent 32-bit lanes, one 16-byte stripe at a time, so the lanes
+        // map onto one SSE register. The lanes are folded into 64 bits and finished with splitmix64.
+        constexpr uint32_t PRIME1 = 2654435761u;
+        constexpr uint32_t PRIME2 = 2246822519u;
+        constexpr size_t STRIPE_COUNT = (sizeof(Vertex) / sizeof(uint32_t) + 3) / 4;
+
+        uint32_t words[STRIPE_COUNT * 4] = {};
+        std::memcpy(words, &vertex, sizeof(Vertex));
+
+        uint32_t lanes[4] = {PRIME1 + PRIME2, PRIME2, 0, 0 - PRIME1};
+        for (size_t stripe = 0; stripe < STRIPE_COUNT; stripe++) {
+            for (size_t lane = 0; lane < 4; lane++) {
+                uint32_t acc = lanes[lane] + canonicalZero(words[stripe * 4 + lane]) * PRIME2;
+                lanes[lane] = ((acc << 13) | (acc >> 19)) * PRIME1;
+            }
+        }
+
+        uint64_t hash = (static_cast<uint64_t>(lanes[0] ^ ((lanes[1] << 7) | (lanes[1] >> 25))) << 32)
+                      | (lanes[2] ^ ((lanes[3] << 18) | (lanes[3] >> 14)));
+        hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+        hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+        hash ^= hash >> 31;
+        return static_cast<size_t>(hash);
+    }
+
+    bool canPackVertices(const Vertex* vertices, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const Vertex& vertex = vertices[i];
+            if (!inUnitRange(vertex.texCoord.x) || !inUnitRange(vertex.texCoord.y)) return false;
+            if (!inUnitRange(vertex.color.x) || !inUnitRange(vertex.color.y) || !inUnitRange(vertex.color.z)) return false;
+        }
+        return true;
+    }
+
+    glm::mat4 packVertices(const Vertex* vertices, size_t count, std::vector<PackedVertex>& packed) {
+        glm::vec3 lo{std::numeric_limits<float>::max()};
+        glm::vec3 hi{std::numeric_limits<float>::lowest()};
+        for (size_t i = 0; i < count; i++) {
+            lo = glm::min(lo, vertices[i].pos);
+            hi = glm::max(hi, vertices[i].pos);
+        }
+        if (count == 0) {
+            lo = hi = glm::vec3{0.0f};
+        }
+
+        glm::vec3 center = (lo + hi) * 0.5f;
+        glm::vec3 halfExtent = (hi - lo) * 0.5f;
+        float scale = std::max(halfExtent.x, std::max(halfExtent.y, halfExtent.z));
+        if (scale <= 0.0f) {
+            scale = 1.0f;
+        }
+        float invScale = 1.0f / scale;
+
+        packed.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            const Vertex& vertex = vertices[i];
+            PackedVertex& out = packed[i];
+
+            glm::vec3 local = (vertex.pos - center) * invScale;
+            out.pos[0] = glm::packHalf1x16(local.x);
+            out.pos[1] = glm::packHalf1x16(local.y);
+            out.pos[2] = glm::packHalf1x16(local.z);
+            out.pos[3] = glm::packHalf1x16(1.0f);
+
+            uint32_t normal = glm::packSnorm2x16(encodeOctahedral(vertex.normal));
+            uint32_t color = glm::packUnorm4x8(glm::vec4{vertex.color, 1.0f});
+            uint32_t texCoord = glm::packUnorm2x16(vertex.texCoord);
+            std::memcpy(out.normal, &normal, sizeof(out.normal));
+            std::memcpy(out.color, &color, sizeof(out.color));
+            std::memcpy(out.texCoord, &texCoord, sizeof(out.texCoord));
+        }
+
+        return glm::scale(glm::translate(glm::mat4{1.0f}, center), glm::vec3{scale});
+    }
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+namespace ave {
+
+    // Vertex formats a mesh can be uploaded in, chosen per mesh at load/cook time. Stored in .avemesh files, append only.
+    enum class VertexFormat : uint32_t {
+        Full = 0,   // Vertex, 44 bytes
+        Packed = 1, // PackedVertex, 20 bytes
+    };
+    static constexpr uint32_t VERTEX_FORMAT_COUNT = 2;
+
+    struct Vertex {
+        glm::vec3 pos;
+        glm::vec3 normal;
+        glm::vec3 color;
+        glm::vec2 texCoord;
+
+        static VkVertexInputBindingDescription getBindingDescription();
+        static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
+
+        Vertex operator+(const Vertex& other){
+            return {pos+other.pos, color+other.color};
+        }
+        Vertex operator-(const Vertex& other){
+            return {pos - other.pos, color - other.color};
+        }
+        Vertex operator/(float f){
+            return {pos / f, color / f};
+        }
+        Vertex operator*(float f){
+            return {pos * f, color * f};
+        }
+
+        bool operator==(const Vertex& other) const {
+            return pos == other.pos && normal == other.normal && color == other.color && texCoord == other.texCoord;
+        }
+    };
+    static_assert(sizeof(Vertex) == 11 * sizeof(float), "Vertex is hashed as 11 packed floats");
+
+    // Hash over all of a vertex's attribute words, consistent with operator== (-0 and +0 hash the same)
+    size_t hashVertex(const Vertex& vertex);
+
+    struct Vertex_hash {
+        size_t operator()(Vertex const& vertex) const {
+            return hashVertex(vertex);
+        }
+    };
+
+    // Quantized vertex. Positions are half floats inside the mesh's [-1, 1] quantization box and are brought
+    // back to object space by the per-mesh dequant matrix, which the model folds into its model matrix.
+    struct PackedVertex {
+        uint16_t pos[4];      // R16G16B16A16_SFLOAT, w is always 1
+        int16_t normal[2];    // R16G16_SNORM, octahedral encoded
+        uint8_t color[4];     // R8G8B8A8_UNORM, a is always 255
+        uint16_t texCoord[2]; // R16G16_UNORM, so uvs must lie in [0, 1]
+    };
+    static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+    // Compile time attribute table per vertex type, one binding at binding 0
+    template <typename V>
+    struct VertexLayout;
+
+    template <>
+    struct VertexLayout<Vertex> {
+        static constexpr VertexFormat format = VertexFormat::Full;
+        static constexpr std::array<VkVertexInputAttributeDescription, 4> attributes = {{
+            {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, pos)},
+            {1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal)},
+            {2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)},
+            {3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, texCoord)},
+        }};
+    };
+
+    template <>
+    struct VertexLayout<PackedVertex> {
+        static constexpr VertexFormat format = VertexFormat::Packed;
+        static constexpr std::array<VkVertexInputAttributeDescription, 4> attributes = {{
+            {0, 0, VK_FORMAT_R16G16B16A16_SFLOAT, offsetof(PackedVertex, pos)},
+            {1, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal)},
+            {2, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, color)},
+            {3, 0, VK_FORMAT_R16G16_UNORM, offsetof(PackedVertex, texCoord)},
+        }};
+    };
+
+    template <typename V>
+    constexpr VkVertexInputBindingDescription vertexBindingDescription() {
+        return {0, static_cast<uint32_t>(sizeof(V)), VK_VERTEX_INPUT_RATE_VERTEX};
+    }
+
+    // Per instance stream at binding 1, read by every pipeline. Models that are not instanced draw one default
+    // instance (identity transform, white, INSTANCE_MATERIAL_DEFAULT) that AveGeometryPool::bind() binds.
+    static constexpr uint32_t INSTANCE_BINDING = 1;
+    static constexpr uint32_t INSTANCE_MATERIAL_DEFAULT = UINT32_MAX; // sample the draw's own texture slot
+
+    struct InstanceData {
+        glm::mat4 transform{1.0f}; // world space, applied after the model matrix
+        glm::vec4 color{1.0f};     // multiplies the texture
+        uint32_t material = INSTANCE_MATERIAL_DEFAULT; // bindless texture slot
+        uint32_t padding[3] = {};
+    };
+    static_assert(sizeof(InstanceData) == 96, "InstanceData is read as a 96 byte vertex stream");
+
+    // Locations 4-9, after the vertex attributes of every format
+    static constexpr std::array<VkVertexInputAttributeDescription, 6> INSTANCE_ATTRIBUTES = {{
+        {4, INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, transform)},
+        {5, INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, transform) + 16},
+        {6, INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, transform) + 32},
+        {7, INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, transform) + 48},
+        {8, INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, color)},
+        {9, INSTANCE_BINDING, VK_FORMAT_R32_UINT, offsetof(InstanceData, material)},
+    }};
+
+    constexpr VkVertexInputBindingDescription instanceBindingDescription() {
+        return {INSTANCE_BINDING, static_cast<uint32_t>(sizeof(InstanceData)), VK_VERTEX_INPUT_RATE_INSTANCE};
+    }
+
+    // Runtime view of a VertexLayout, for code that only knows the mesh's VertexFormat
+    struct VertexLayoutInfo {
+        VertexFormat format;
+        VkVertexInputBindingDescription binding;
+        const VkVertexInputAttributeDescription* attributes;
+        uint32_t attributeCount;
+
+        uint32_t stride() const { return binding.stride; }
+    };
+
+    template <typename V>
+    constexpr VertexLayoutInfo makeVertexLayoutInfo() {
+        return {VertexLayout<V>::format, vertexBindingDescription<V>(), VertexLayout<V>::attributes.data(), static_cast<uint32_t>(VertexLayout<V>::attributes.size())};
+    }
+
+    static constexpr std::array<VertexLayoutInfo, VERTEX_FORMAT_COUNT> VERTEX_LAYOUTS = {{
+        makeVertexLayoutInfo<Vertex>(),
+        makeVertexLayoutInfo<PackedVertex>(),
+    }};
+    static_assert(VERTEX_LAYOUTS[static_cast<uint32_t>(VertexFormat::Full)].format == VertexFormat::Full, "VERTEX_LAYOUTS is indexed by VertexFormat");
+    static_assert(VERTEX_LAYOUTS[static_cast<uint32_t>(VertexFormat::Packed)].format == VertexFormat::Packed, "VERTEX_LAYOUTS is indexed by VertexFormat");
+
+    inline const VertexLayoutInfo& getVertexLayout(VertexFormat format) {
+        return VERTEX_LAYOUTS[static_cast<uint32_t>(format)];
+    }
+
+    inline VkVertexInputBindingDescription Vertex::getBindingDescription() {
+        return vertexBindingDescription<Vertex>();
+    }
+
+    inline std::array<VkVertexInputAttributeDescription, 4> Vertex::getAttributeDescriptions() {
+        return VertexLayout<Vertex>::attributes;
+    }
+
+    // Packed vertices need uvs and colors in [0, 1]; meshes that wrap uvs stay in the full format
+    bool canPackVertices(const Vertex* vertices, size_t count);
+
+    // Quantizes vertices into PackedVertex and returns the dequant matrix that maps packed positions back to
+    // object space. The scale is uniform so normals can keep using the upper 3x3 of the model matrix.
+    glm::mat4 packVertices(const Vertex* vertices, size_t count, std::vector<PackedVertex>& packed);
+}
@@ -0,0 +1,205 @@
+#include "ave_vertex_welder.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace ave {
+
+    namespace {
+        constexpr u_int32_t EMPTY_SLOT = ~0u;
+
+        // Linear probing table of vertex indices, grown at half load so its size follows the number of unique
+        // vertices rather than the input. Slots keep the upper half of the hash, which both rejects most
+        // mismatches without touching the vertex array and picks the bucket, so growing needs no rehashing.
+        class WeldTable {
+            public:
+                WeldTable() {
+                    slots_.assign(INITIAL_CAPACITY, Slot{0, EMPTY_SLOT});
+                    mask_ = INITIAL_CAPACITY - 1;
+                }
+
+                template <typename Equal>
+                u_int32_t find(uint64_t hash, Equal equal) const {
+                    uint32_t tag = static_cast<uint32_t>(hash >> 32);
+                    for (size_t i = tag & mask_;; i = (i + 1) & mask_) {
+                        const Slot& slot = slots_[i];
+                        if (slot.vertex == EMPTY_SLOT) return EMPTY_SLOT;
+                        if (slot.tag == tag && equal(slot.vertex)) return slot.vertex;
+                    }
+                }
+
+                void insert(uint64_t hash, u_int32_t vertex) {
+                    if ((size_ + 1) * 2 > slots_.size()) {
+                        grow();
+                    }
+                    place(Slot{static_cast<uint32_t>(hash >> 32), vertex});
+                    size_++;
+                }
+
+            private:
+                static constexpr size_t INITIAL_CAPACITY = 1024;
+
+                struct Slot {
+                    uint32_t tag;
+                    u_int32_t vertex;
+                };
+
+                void place(const Slot& slot) {
+                    size_t i = slot.tag & mask_;
+                    while (slots_[i].vertex != EMPTY_SLOT) i = (i + 1) & mask_;
+                    slots_[i] = slot;
+                }
+
+                void grow() {
+                    std::vector<Slot> old(slots_.size() * 2, Slot{0, EMPTY_SLOT});
+                    old.swap(slots_);
+                    mask_ = slots_.size() - 1;
+                    for (const Slot& slot : old) {
+                        if (slot.vertex != EMPTY_SLOT) place(slot);
+                    }
+                }
+
+                std::vector<Slot> slots_;
+                size_t mask_;
+                size_t size_ = 0;
+        };
+
+        bool sameAttributes(const Vertex& a, const Vertex& b) {
+            return a.normal == b.normal && a.color == b.color && a.texCoord == b.texCoord;
+        }
+
+        // Rebuilds vertices in remap order, keeping the first occurrence of each welded vertex
+        void compactVertices(std::vector<Vertex>& vertices, const std::vector<u_int32_t>& remap, size_t uniqueCount) {
+            std::vector<Vertex> welded;
+            welded.reserve(uniqueCount);
+            for (size_t i = 0; i < vertices.size(); i++) {
+                if (remap[i] == welded.size()) {
+                    welded.push_back(vertices[i]);
+                }
+            }
+            vertices.swap(welded);
+        }
+    }
+
+    size_t AveVertexWelder::generateRemap(
+        const Vertex* vertices,
+        size_t count,
+        std::vector<u_int32_t>& remap,
+        float positionEpsilon) {
+        remap.resize(count);
+        WeldTable table;
+        u_int32_t uniqueCount = 0;
+
+        if (positionEpsilon <= 0.0f) {
+            for (size_t i = 0; i < count; i++) {
+                uint64_t hash = hashVertex(vertices[i]);
+                u_int32_t match = table.find(hash, [&](u_int32_t other) { return vertices[other] == vertices[i]; });
+                if (match == EMPTY_SLOT) {
+                    table.insert(hash, static_cast<u_int32_t>(i));
+                    remap[i] = uniqueCount++;
+                } else {
+                    remap[i] = remap[match];
+                }
+            }
+            return uniqueCount;
+        }
+
+        // Positions are hashed by grid cell. With cells of 2 * epsilon every match lies in the vertex's own
+        // cell or the neighbour on the nearer side along each axis, so 8 lookups cover it.
+        const float cellSize = positionEpsilon * 2.0f;
+
+        for (size_t i = 0; i < count; i++) {
+            const Vertex& vertex = vertices[i];
+            Vertex attributes = vertex;
+            attributes.pos = glm::vec3{0.0f};
+            const uint64_t attributeHash = hashVertex(attributes);
+            auto cellHash = [&](const glm::vec3& cell) {
+                // splitmix64 finalizer over the attribute hash and the cell coordinates
+                uint64_t hash = attributeHash
+                    + static_cast<uint64_t>(static_cast<int64_t>(cell.x)) * 0x9E3779B97F4A7C15ull
+                    + static_cast<uint64_t>(static_cast<int64_t>(cell.y)) * 0xC2B2AE3D27D4EB4Full
+                    + static_cast<uint64_t>(static_cast<int64_t>(cell.z)) * 0x165667B19E3779F9ull;
+                hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+                hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+                return hash ^ (hash >> 31);
+            };
+            glm::vec3 scaled = vertex.pos / cellSize;
+            glm::vec3 cell = glm::floor(scaled);
+            glm::vec3 towards{0.0f};
+            for (int k = 0; k < 3; k++) {
+                towards[k] = scaled[k] - cell[k] < 0.5f ? -1.0f : 1.0f;
+            }
+
+            auto near = [&](u_int32_t other) {
+                glm::vec3 delta = glm::abs(vertices[other].pos - vertex.pos);
+                return delta.x <= positionEpsilon && delta.y <= positionEpsilon && delta.z <= positionEpsilon
+                    && sameAttributes(vertices[other], vertex);
+            };
+
+            u_int32_t match = EMPTY_SLOT;
+            for (int corner = 0; corner < 8 && match == EMPTY_SLOT; corner++) {
+                glm::vec3 neighbour = cell;
+                for (int k = 0; k < 3; k++) {
+                    if (corner & (1 << k)) neighbour[k] += towards[k];
+                }
+                match = table.find(cellHash(neighbour), near);
+            }
+
+            if (match == EMPTY_SLOT) {
+                table.insert(cellHash(cell), static_cast<u_int32_t>(i));
+                remap[i] = uniqueCount++;
+            } else {
+                remap[i] = remap[match];
+            }
+        }
+        return uniqueCount;
+    }
+
+    WeldStats AveVertexWelder::weld(
+        std::vector<Vertex>& vertices,
+        std::vector<u_int32_t>& indices,
+        float positionEpsilon) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        WeldStats stats{};
+        stats.verticesIn = vertices.size();
+
+        for (u_int32_t index : indices) {
+            if (index >= vertices.size()) {
+                throw std::runtime_error("failed to weld vertices, index out of range!");
+            }
+        }
+
+        std::vector<u_int32_t> remap;
+        size_t uniqueCount = generateRemap(vertices.data(), vertices.size(), remap, positionEpsilon);
+        for (u_int32_t& index : indices) {
+            index = remap[index];
+        }
+        compactVertices(vertices, remap, uniqueCount);
+
+        stats.verticesOut = vertices.size();
+        stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+        return stats;
+    }
+
+    WeldStats AveVertexWelder::weldTriangleSoup(
+        std::vector<Vertex>& vertices,
+        std::vector<u_int32_t>& indices,
+        float positionEpsilon) {
+        if (vertices.size() % 3 != 0) {
+            throw std::runtime_error("failed to weld triangle soup, vertex count is not a multiple of 3!");
+        }
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        WeldStats stats{};
+        stats.verticesIn = vertices.size();
+
+        size_t uniqueCount = generateRemap(vertices.data(), vertices.size(), indices, positionEpsilon);
+        compactVertices(vertices, indices, uniqueCount);
+
+        stats.verticesOut = vertices.size();
+        stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+        return stats;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ave_vertex_layout.hpp"
+
+#include <vector>
+
+namespace ave {
+
+    struct WeldStats {
+        size_t verticesIn = 0;
+        size_t verticesOut = 0;
+        double seconds = 0.0;
+    };
+
+    // Merges duplicate vertices with an open addressing table keyed by hashVertex. Any mesh source can
+    // use it: loaders with split attribute streams, procedural generators emitting triangle soups.
+    // With a positionEpsilon > 0, vertices whose positions differ by at most epsilon per axis and whose
+    // other attributes match exactly are merged into the first one seen.
+    class AveVertexWelder {
+        public:
+            // remap[i] receives the index vertex i moves to in the welded vertex array. Returns the welded
+            // vertex count; welded vertices keep the order of their first occurrence.
+            static size_t generateRemap(
+                const Vertex* vertices,
+                size_t count,
+                std::vector<u_int32_t>& remap,
+                float positionEpsilon = 0.0f);
+
+            // Welds an indexed mesh in place
+            static WeldStats weld(
+                std::vector<Vertex>& vertices,
+                std::vector<u_int32_t>& indices,
+                float positionEpsilon = 0.0f);
+
+            // Welds an unindexed triangle list (every 3 vertices form a triangle) and fills indices
+            static WeldStats weldTriangleSoup(
+                std::vector<Vertex>& vertices,
+                std::vector<u_int32_t>& indices,
+                float positionEpsilon = 0.0f);
+    };
+}
@@ -0,0 +1,127 @@
+// Frustum culling throughput of AveBoundsCuller: the scalar loop against the SSE and AVX2 paths (whichever this
+// CPU has) at 100k and 1M spheres scattered around a camera. Every path must return exactly the scalar list.
+// Usage: bench_cull [--objects N] [--runs N]
+
+#include "../ave_bounds_culler.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Sphere {
+        glm::vec3 center;
+        float radius;
+    };
+
+    std::vector<Sphere> makeScene(uint32_t objectCount) {
+        std::mt19937 rng{1234};
+        std::uniform_real_distribution<float> position{-500.0f, 500.0f};
+        std::uniform_real_distribution<float> radius{0.1f, 5.0f};
+        std::vector<Sphere> spheres(objectCount);
+        for (Sphere& sphere : spheres) {
+            sphere.center = glm::vec3{position(rng), position(rng), position(rng) * 0.1f};
+            sphere.radius = radius(rng);
+        }
+        return spheres;
+    }
+
+    // The per object test everything else uses, spheres this close to a plane may round either way
+    uint32_t checkScalar(const std::vector<Sphere>& spheres, const std::vector<uint32_t>& reference, const ave::AveFrustum& frustum) {
+        std::vector<char> visible(spheres.size(), 0);
+        for (uint32_t index : reference) {
+            visible[index] = 1;
+        }
+        uint32_t mismatches = 0;
+        for (size_t i = 0; i < spheres.size(); i++) {
+            if (frustum.intersectsSphere(spheres[i].center, spheres[i].radius) == (visible[i] != 0)) {
+                continue;
+            }
+            float margin = 1e30f;
+            for (const glm::vec4& plane : frustum.planes) {
+                margin = std::min(margin, glm::dot(glm::vec3{plane}, spheres[i].center) + plane.w + spheres[i].radius);
+            }
+            if (std::abs(margin) > 1e-3f) {
+                mismatches++;
+            }
+        }
+        return mismatches;
+    }
+
+    // Best of runs, milliseconds for one cull of the whole set
+    double timeCull(const ave::AveBoundsCuller& culler, const ave::AveFrustum& frustum, ave::AveBoundsCuller::Path path,
+            int runs, std::vector<uint32_t>& visible) {
+        double bestSeconds = 1e30;
+        for (int run = 0; run < runs; run++) {
+            auto startTime = std::chrono::high_resolution_clock::now();
+            culler.cull(frustum, visible, path);
+            double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+            bestSeconds = std::min(bestSeconds, seconds);
+        }
+        return bestSeconds * 1000.0;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<uint32_t> objectCounts = {100000, 1000000};
+    int runs = 20;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--objects") objectCounts = {static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10))};
+        else if (arg == "--runs") runs = std::atoi(argv[i + 1]);
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3{-200.0f, -150.0f, 40.0f}, glm::vec3{50.0f, 20.0f, 0.0f}, glm::vec3{0.0f, 0.0f, 1.0f});
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 600.0f);
+    proj[1][1] *= -1;
+    ave::AveFrustum frustum = ave::AveFrustum::fromMatrix(proj * view);
+
+    std::vector<ave::AveBoundsCuller::Path> paths = {ave::AveBoundsCuller::Path::Scalar};
+    ave::AveBoundsCuller::Path best = ave::AveBoundsCuller::bestPath();
+    if (best != ave::AveBoundsCuller::Path::Scalar) paths.push_back(ave::AveBoundsCuller::Path::Sse);
+    if (best == ave::AveBoundsCuller::Path::Avx2) paths.push_back(ave::AveBoundsCuller::Path::Avx2);
+
+    bool failed = false;
+    ave::AveBoundsCuller culler;
+    std::vector<uint32_t> reference;
+    std::vector<uint32_t> visible;
+    for (uint32_t objectCount : objectCounts) {
+        std::vector<Sphere> spheres = makeScene(objectCount);
+        culler.clear();
+        culler.reserve(objectCount);
+        for (const Sphere& sphere : spheres) {
+            culler.add(sphere.center, sphere.radius);
+        }
+
+        double scalarMs = 0.0;
+        for (ave::AveBoundsCuller::Path path : paths) {
+            double ms = timeCull(culler, frustum, path, runs, visible);
+            if (path == ave::AveBoundsCuller::Path::Scalar) {
+                reference = visible;
+                scalarMs = ms;
+                if (uint32_t mismatches = checkScalar(spheres, reference, frustum)) {
+                    std::printf("scalar path disagrees with AveFrustum::intersectsSphere on %u spheres\n", mismatches);
+                    failed = true;
+                }
+            }
+            bool matches = visible == reference;
+            failed = failed || !matches;
+            std::printf("%-7s %8u objects %8zu visible  %8.3f ms  %8.1f Mobjects/s  %5.2fx%s\n", ave::AveBoundsCuller::pathName(path),
+                objectCount, visible.size(), ms, objectCount / ms / 1e3, scalarMs / ms, matches ? "" : "  MISMATCH");
+        }
+    }
+
+    if (failed) {
+        std::printf("FAILED: culling paths disagree\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,447 @@
+// Checks shaders/cull.comp against cullReference and times both. Headless, prefers a CPU device so it runs
+// on lavapipe. Scatters objects over random meshes (a share of them removed), culls them on the device in
+// compact and uncompacted mode and compares the visible sets; spheres within EPSILON of a plane may go
+// either way. Usage: bench_gpu_cull [--objects N] [--runs N]
+
+#include "../ave_gpu_cull_layout.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    constexpr uint32_t MESH_COUNT = 64;
+    constexpr uint32_t WORKGROUP_SIZE = 64;
+    constexpr float EPSILON = 1e-3f;
+
+    struct Buffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        VkDeviceSize size = 0;
+    };
+
+    struct Context {
+        VkInstance instance = VK_NULL_HANDLE;
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        VkDevice device = VK_NULL_HANDLE;
+        uint32_t queueFamily = 0;
+        VkQueue queue = VK_NULL_HANDLE;
+        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkShaderModule shaderModule = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        Buffer buffers[4]; // meshes, object meshes, instances, output: the bindings of cull.comp
+    };
+
+    void check(VkResult result, const char* what) {
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error(std::string("failed to ") + what + "!");
+        }
+    }
+
+    void createDevice(Context& context) {
+        VkApplicationInfo appInfo{};
+        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.pApplicationName = "bench_gpu_cull";
+        appInfo.apiVersion = VK_API_VERSION_1_0;
+        VkInstanceCreateInfo instanceInfo{};
+        instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        instanceInfo.pApplicationInfo = &appInfo;
+        check(vkCreateInstance(&instanceInfo, nullptr, &context.instance), "create instance");
+
+        uint32_t deviceCount = 0;
+        vkEnumeratePhysicalDevices(context.instance, &deviceCount, nullptr);
+        std::vector<VkPhysicalDevice> devices(deviceCount);
+        vkEnumeratePhysicalDevices(context.instance, &deviceCount, devices.data());
+        if (devices.empty()) {
+            throw std::runtime_error("failed to find a vulkan device!");
+        }
+        context.physicalDevice = devices[0];
+        for (VkPhysicalDevice device : devices) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(device, &properties);
+            if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU) {
+                context.physicalDevice = device;
+            }
+        }
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(context.physicalDevice, &properties);
+        std::printf("device: %s\n", properties.deviceName);
+
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(context.physicalDevice, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(context.physicalDevice, &familyCount, families.data());
+        auto compute = std::find_if(families.begin(), families.end(), [](const VkQueueFamilyProperties& family) {
+            return (family.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+        });
+        if (compute == families.end()) {
+            throw std::runtime_error("failed to find a compute queue family!");
+        }
+        context.queueFamily = static_cast<uint32_t>(compute - families.begin());
+
+        float priority = 1.0f;
+        VkDeviceQueueCreateInfo queueInfo{};
+        queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueInfo.queueFamilyIndex = context.queueFamily;
+        queueInfo.queueCount = 1;
+        queueInfo.pQueuePriorities = &priority;
+        VkDeviceCreateInfo deviceInfo{};
+        deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        deviceInfo.queueCreateInfoCount = 1;
+        deviceInfo.pQueueCreateInfos = &queueInfo;
+        check(vkCreateDevice(context.physicalDevice, &deviceInfo, nullptr, &context.device), "create logical device");
+        vkGetDeviceQueue(context.device, context.queueFamily, 0, &context.queue);
+    }
+
+    // Host visible and coherent, so results are read straight back without staging
+    void createBuffer(Context& context, Buffer& buffer, VkDeviceSize size) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        check(vkCreateBuffer(context.device, &bufferInfo, nullptr, &buffer.buffer), "create buffer");
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(context.device, buffer.buffer, &requirements);
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(context.physicalDevice, &memoryProperties);
+        VkMemoryPropertyFlags wanted = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        uint32_t memoryType = 0;
+        while (memoryType < memoryProperties.memoryTypeCount &&
+                (!(requirements.memoryTypeBits & (1u << memoryType)) ||
+                 (memoryProperties.memoryTypes[memoryType].propertyFlags & wanted) != wanted)) {
+            memoryType++;
+        }
+        if (memoryType == memoryProperties.memoryTypeCount) {
+            throw std::runtime_error("failed to find host visible memory!");
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = memoryType;
+        check(vkAllocateMemory(context.device, &allocInfo, nullptr, &buffer.memory), "allocate buffer memory");
+        vkBindBufferMemory(context.device, buffer.buffer, buffer.memory, 0);
+        check(vkMapMemory(context.device, buffer.memory, 0, size, 0, &buffer.mapped), "map buffer memory");
+        buffer.size = size;
+    }
+
+    VkShaderModule loadShader(VkDevice device, const std::string& path) {
+        std::ifstream file{path, std::ios::ate | std::ios::binary};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + path);
+        }
+        std::vector<char> code(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(code.data(), code.size());
+
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = code.size();
+        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+        VkShaderModule shaderModule;
+        check(vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule), "create shader module");
+        return shaderModule;
+    }
+
+    void createPipeline(Context& context, uint32_t objectCount) {
+        VkDescriptorSetLayoutBinding bindings[4]{};
+        for (uint32_t i = 0; i < 4; i++) {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = 4;
+        layoutInfo.pBindings = bindings;
+        check(vkCreateDescriptorSetLayout(context.device, &layoutInfo, nullptr, &context.setLayout), "create descriptor set layout");
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.size = sizeof(ave::GpuCullPushConstants);
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &context.setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        check(vkCreatePipelineLayout(context.device, &pipelineLayoutInfo, nullptr, &context.pipelineLayout), "create pipeline layout");
+
+        context.shaderModule = loadShader(context.device, "shaders/cull.comp.spv");
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = context.shaderModule;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = context.pipelineLayout;
+        check(vkCreateComputePipelines(context.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &context.pipeline), "create culling pipeline");
+
+        createBuffer(context, context.buffers[0], sizeof(ave::GpuCullMesh) * MESH_COUNT);
+        createBuffer(context, context.buffers[1], sizeof(uint32_t) * objectCount);
+        createBuffer(context, context.buffers[2], sizeof(ave::InstanceData) * objectCount);
+        createBuffer(context, context.buffers[3], ave::GPU_CULL_COMMAND_OFFSET + sizeof(VkDrawIndexedIndirectCommand) * objectCount);
+
+        VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4};
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        check(vkCreateDescriptorPool(context.device, &poolInfo, nullptr, &context.descriptorPool), "create descriptor pool");
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = context.descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &context.setLayout;
+        check(vkAllocateDescriptorSets(context.device, &allocInfo, &context.descriptorSet), "allocate descriptor set");
+
+        VkDescriptorBufferInfo bufferInfos[4];
+        VkWriteDescriptorSet writes[4]{};
+        for (uint32_t i = 0; i < 4; i++) {
+            bufferInfos[i] = {context.buffers[i].buffer, 0, VK_WHOLE_SIZE};
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = context.descriptorSet;
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[i].pBufferInfo = &bufferInfos[i];
+        }
+        vkUpdateDescriptorSets(context.device, 4, writes, 0, nullptr);
+
+        VkCommandPoolCreateInfo commandPoolInfo{};
+        commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        commandPoolInfo.queueFamilyIndex = context.queueFamily;
+        check(vkCreateCommandPool(context.device, &commandPoolInfo, nullptr, &context.commandPool), "create command pool");
+        VkCommandBufferAllocateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        bufferInfo.commandPool = context.commandPool;
+        bufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        bufferInfo.commandBufferCount = 1;
+        check(vkAllocateCommandBuffers(context.device, &bufferInfo, &context.commandBuffer), "allocate command buffer");
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        check(vkCreateFence(context.device, &fenceInfo, nullptr, &context.fence), "create fence");
+    }
+
+    void destroy(Context& context) {
+        for (Buffer& buffer : context.buffers) {
+            vkDestroyBuffer(context.device, buffer.buffer, nullptr);
+            vkFreeMemory(context.device, buffer.memory, nullptr);
+        }
+        vkDestroyFence(context.device, context.fence, nullptr);
+        vkDestroyCommandPool(context.device, context.commandPool, nullptr);
+        vkDestroyDescriptorPool(context.device, context.descriptorPool, nullptr);
+        vkDestroyPipeline(context.device, context.pipeline, nullptr);
+        vkDestroyShaderModule(context.device, context.shaderModule, nullptr);
+        vkDestroyPipelineLayout(context.device, context.pipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(context.device, context.setLayout, nullptr);
+        vkDestroyDevice(context.device, nullptr);
+        vkDestroyInstance(context.instance, nullptr);
+    }
+
+    // Same commands AveGpuCulling::cull records, submitted and waited for. Returns milliseconds.
+    double dispatch(Context& context, const ave::GpuCullPushConstants& constants) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        vkResetCommandPool(context.device, context.commandPool, 0);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        check(vkBeginCommandBuffer(context.commandBuffer, &beginInfo), "begin command buffer");
+
+        VkBuffer output = context.buffers[3].buffer;
+        vkCmdFillBuffer(context.commandBuffer, output, 0, sizeof(uint32_t), 0);
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = output;
+        barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(context.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            0, nullptr, 1, &barrier, 0, nullptr);
+
+        vkCmdBindPipeline(context.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, context.pipeline);
+        vkCmdBindDescriptorSets(context.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, context.pipelineLayout, 0, 1,
+            &context.descriptorSet, 0, nullptr);
+        vkCmdPushConstants(context.commandBuffer, context.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(context.commandBuffer, (constants.objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+        // Results are read on the host
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(context.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+            0, nullptr, 1, &barrier, 0, nullptr);
+        check(vkEndCommandBuffer(context.commandBuffer), "record command buffer");
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &context.commandBuffer;
+        check(vkQueueSubmit(context.queue, 1, &submitInfo, context.fence), "submit culling");
+        check(vkWaitForFences(context.device, 1, &context.fence, VK_TRUE, UINT64_MAX), "wait for culling");
+        vkResetFences(context.device, 1, &context.fence);
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count() * 1000.0;
+    }
+
+    // Signed distance of an object's world sphere to the frustum, negative outside
+    float sphereMargin(const ave::GpuCullMesh& mesh, const ave::InstanceData& instance, const ave::AveFrustum& frustum) {
+        glm::vec3 center = glm::vec3{instance.transform * glm::vec4{glm::vec3{mesh.boundingSphere}, 1.0f}};
+        float scale = std::max({glm::length(glm::vec3{instance.transform[0]}), glm::length(glm::vec3{instance.transform[1]}),
+            glm::length(glm::vec3{instance.transform[2]})});
+        float margin = 1e30f;
+        for (const glm::vec4& plane : frustum.planes) {
+            margin = std::min(margin, glm::dot(glm::vec3{plane}, center) + plane.w + mesh.boundingSphere.w * scale);
+        }
+        return margin;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t objectCount = 100000;
+    int runs = 10;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--objects") objectCount = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (arg == "--runs") runs = std::atoi(argv[i + 1]);
+    }
+
+    // A scene a fair share of which is outside the view, with scaled and rotated objects and holes left by removals
+    std::mt19937 rng{1234};
+    std::uniform_real_distribution<float> unit{0.0f, 1.0f};
+    std::vector<ave::GpuCullMesh> meshes(MESH_COUNT);
+    for (uint32_t i = 0; i < MESH_COUNT; i++) {
+        meshes[i] = {i * 3000, 300 + i * 6, static_cast<int32_t>(i * 1000), 0,
+            glm::vec4{unit(rng) - 0.5f, unit(rng) - 0.5f, unit(rng) - 0.5f, 0.2f + unit(rng)}};
+    }
+    std::vector<uint32_t> objectMeshes(objectCount);
+    std::vector<ave::InstanceData> instances(objectCount);
+    for (uint32_t i = 0; i < objectCount; i++) {
+        objectMeshes[i] = unit(rng) < 0.05f ? ave::CULL_OBJECT_EMPTY : static_cast<uint32_t>(rng() % MESH_COUNT);
+        glm::vec3 position{unit(rng) * 200.0f - 100.0f, unit(rng) * 200.0f - 100.0f, unit(rng) * 20.0f - 10.0f};
+        glm::mat4 transform = glm::translate(glm::mat4{1.0f}, position);
+        transform = glm::rotate(transform, unit(rng) * 6.28f, glm::vec3{0.0f, 0.0f, 1.0f});
+        instances[i].transform = glm::scale(transform, glm::vec3{0.5f + unit(rng) * 2.0f});
+        instances[i].material = ave::INSTANCE_MATERIAL_DEFAULT;
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3{-60.0f, -40.0f, 15.0f}, glm::vec3{20.0f, 10.0f, 0.0f}, glm::vec3{0.0f, 0.0f, 1.0f});
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 120.0f);
+    proj[1][1] *= -1;
+    ave::AveFrustum frustum = ave::AveFrustum::fromMatrix(proj * view);
+
+    std::vector<VkDrawIndexedIndirectCommand> reference;
+    double cpuMs = 1e30;
+    for (int run = 0; run < runs; run++) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        ave::cullReference(meshes.data(), objectMeshes.data(), instances.data(), objectCount, frustum, reference);
+        cpuMs = std::min(cpuMs, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count() * 1000.0);
+    }
+
+    std::vector<char> referenceVisible(objectCount, 0);
+    for (const VkDrawIndexedIndirectCommand& command : reference) {
+        referenceVisible[command.firstInstance] = 1;
+    }
+
+    Context context;
+    uint32_t failures = 0;
+    try {
+        createDevice(context);
+        createPipeline(context, objectCount);
+        std::memcpy(context.buffers[0].mapped, meshes.data(), sizeof(ave::GpuCullMesh) * MESH_COUNT);
+        std::memcpy(context.buffers[1].mapped, objectMeshes.data(), sizeof(uint32_t) * objectCount);
+        std::memcpy(context.buffers[2].mapped, instances.data(), sizeof(ave::InstanceData) * objectCount);
+
+        ave::GpuCullPushConstants constants{};
+        std::copy(frustum.planes.begin(), frustum.planes.end(), constants.planes);
+        constants.objectCount = objectCount;
+
+        const unsigned char* output = static_cast<const unsigned char*>(context.buffers[3].mapped);
+        const VkDrawIndexedIndirectCommand* commands = reinterpret_cast<const VkDrawIndexedIndirectCommand*>(
+            output + ave::GPU_CULL_COMMAND_OFFSET);
+
+        for (uint32_t compact = 0; compact < 2; compact++) {
+            constants.compact = compact;
+            double gpuMs = 1e30;
+            for (int run = 0; run < runs; run++) {
+                gpuMs = std::min(gpuMs, dispatch(context, constants));
+            }
+
+            // Visible set the device produced, with its commands checked against the meshes on the way
+            uint32_t drawCount = compact ? *reinterpret_cast<const uint32_t*>(output) : objectCount;
+            std::vector<char> visible(objectCount, 0);
+            uint32_t visibleCount = 0;
+            for (uint32_t i = 0; i < drawCount; i++) {
+                const VkDrawIndexedIndirectCommand& command = commands[i];
+                if (command.instanceCount == 0) {
+                    continue;
+                }
+                uint32_t object = command.firstInstance;
+                bool valid = object < objectCount && (compact || object == i) && objectMeshes[object] != ave::CULL_OBJECT_EMPTY &&
+                    !visible[object] && command.instanceCount == 1;
+                if (valid) {
+                    const ave::GpuCullMesh& mesh = meshes[objectMeshes[object]];
+                    valid = command.indexCount == mesh.indexCount && command.firstIndex == mesh.firstIndex &&
+                        command.vertexOffset == mesh.vertexOffset;
+                }
+                if (!valid) {
+                    std::fprintf(stderr, "bad command %u for object %u\n", i, object);
+                    failures++;
+                    continue;
+                }
+                visible[object] = 1;
+                visibleCount++;
+            }
+
+            uint32_t borderline = 0;
+            for (uint32_t object = 0; object < objectCount; object++) {
+                if (visible[object] == referenceVisible[object]) {
+                    continue;
+                }
+                if (std::abs(sphereMargin(meshes[objectMeshes[object]], instances[object], frustum)) < EPSILON) {
+                    borderline++;
+                } else {
+                    std::fprintf(stderr, "object %u: device %s, reference %s\n", object,
+                        visible[object] ? "visible" : "culled", referenceVisible[object] ? "visible" : "culled");
+                    failures++;
+                }
+            }
+
+            std::printf("%-12s %8u objects %8u visible (reference %zu, %u borderline)  gpu %8.2f ms  cpu %8.2f ms\n",
+                compact ? "compact" : "uncompacted", objectCount, visibleCount, reference.size(), borderline, gpuMs, cpuMs);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    destroy(context);
+    if (failures > 0) {
+        std::printf("FAILED: %u mismatches\n", failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+// OBJ importer throughput: MB/s and vertices/s on the viking room and on a synthetic scan sized file.
+// Usage: bench_obj_loader [--synthetic-mb N] [--threads N] [--runs N]
+
+#include "../ave_obj_loader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+    const std::string SYNTHETIC_PATH = "/tmp/ave_bench_synthetic.obj";
+
+    // Writes a displaced grid with positions, uvs and normals until the file reaches roughly targetBytes
+    void writeSyntheticObj(const std::string& path, size_t targetBytes) {
+        // ~75 bytes of v/vt/vn per grid point and ~2 faces of ~40 bytes each
+        size_t side = 2;
+        while ((side * side) * 155 < targetBytes) side++;
+
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (file == nullptr) {
+            throw std::runtime_error("failed to create synthetic obj!");
+        }
+
+        std::fprintf(file, "# synthetic grid %zux%zu\no synthetic\n", side, side);
+        for (size_t y = 0; y < side; y++) {
+            for (size_t x = 0; x < side; x++) {
+                float u = static_cast<float>(x) / (side - 1);
+                float v = static_cast<float>(y) / (side - 1);
+                std::fprintf(file, "v %.6f %.6f %.6f\n", u - 0.5f, v - 0.5f, 0.05f * std::sin(u * 40.0f) * std::cos(v * 40.0f));
+            }
+        }
+        for (size_t y = 0; y < side; y++) {
+            for (size_t x = 0; x < side; x++) {
+                std::fprintf(file, "vt %.6f %.6f\n", static_cast<float>(x) / (side - 1), static_cast<float>(y) / (side - 1));
+            }
+        }
+        for (size_t i = 0; i < side * side; i++) {
+            std::fprintf(file, "vn 0.000000 0.000000 1.000000\n");
+        }
+        for (size_t y = 0; y + 1 < side; y++) {
+            for (size_t x = 0; x + 1 < side; x++) {
+                size_t a = y * side + x + 1;
+                size_t b = a + 1;
+                size_t c = a + side;
+                size_t d = c + 1;
+                std::fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, b, b, b, d, d, d);
+                std::fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, d, d, d, c, c, c);
+            }
+        }
+        std::fclose(file);
+    }
+
+    void runBenchmark(const std::string& name, const std::string& path, unsigned threads, int runs) {
+        ave::ObjLoadStats best{};
+        double bestSeconds = 1e30;
+
+        for (int run = 0; run < runs; run++) {
+            std::vector<ave::Vertex> vertices;
+            std::vector<u_int32_t> indices;
+            ave::ObjLoadStats stats{};
+            ave::AveObjLoader::load(path, vertices, indices, &stats, threads);
+            if (stats.totalSeconds() < bestSeconds) {
+                bestSeconds = stats.totalSeconds();
+                best = stats;
+            }
+        }
+
+        double megabytes = best.fileBytes / (1024.0 * 1024.0);
+        std::printf("%-12s threads=%-3u %8.2f MB  %9zu verts  %9zu tris  parse %7.2f ms  merge %7.2f ms  %8.1f MB/s  %7.2f Mverts/s\n",
+            name.c_str(), best.threadCount, megabytes, best.vertexCount, best.triangleCount,
+            best.parseSeconds * 1000.0, best.mergeSeconds * 1000.0,
+            megabytes / bestSeconds, best.vertexCount / bestSeconds / 1e6);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t syntheticMegabytes = 256;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    int runs = 3;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--synthetic-mb") syntheticMegabytes = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (arg == "--threads") threads = static_cast<unsigned>(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (arg == "--runs") runs = std::atoi(argv[i + 1]);
+    }
+
+    try {
+        runBenchmark("viking_room", ave::MODEL_PATH, 1, runs);
+        runBenchmark("viking_room", ave::MODEL_PATH, threads, runs);
+
+        std::cout << "writing " << syntheticMegabytes << " MB synthetic obj to " << SYNTHETIC_PATH << std::endl;
+        writeSyntheticObj(SYNTHETIC_PATH, syntheticMegabytes * 1024 * 1024);
+        runBenchmark("synthetic", SYNTHETIC_PATH, 1, runs);
+        runBenchmark("synthetic", SYNTHETIC_PATH, threads, runs);
+        std::remove(SYNTHETIC_PATH.c_str());
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,325 @@
+// Command recording throughput: one render pass of N draws recorded inline on one thread against
+// AveParallelRecorder with a growing number of threads, then with texture decodes queued on a shared pool against
+// a pool of its own. Fails if a list long enough to split is recorded into a single secondary buffer.
+// Headless, prefers a CPU device so it runs on lavapipe.
+// Draws are only recorded, never submitted, so no pipeline is bound; each one pushes 64 bytes and draws.
+// Usage: bench_record [--draws N] [--runs N]
+
+#include "../ave_parallel_recorder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr uint32_t EXTENT = 64;
+    constexpr unsigned DECODES_PER_THREAD = 4; // long jobs queued per worker each frame in the busy runs
+    constexpr double DECODE_MS = 2.0;          // about a 512x512 PNG decode
+
+    struct Context {
+        VkInstance instance = VK_NULL_HANDLE;
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        VkDevice device = VK_NULL_HANDLE;
+        uint32_t queueFamily = 0;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer primary = VK_NULL_HANDLE;
+    };
+
+    void check(VkResult result, const char* what) {
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error(std::string("failed to ") + what + "!");
+        }
+    }
+
+    void createDevice(Context& context) {
+        VkApplicationInfo appInfo{};
+        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.pApplicationName = "bench_record";
+        appInfo.apiVersion = VK_API_VERSION_1_0;
+        VkInstanceCreateInfo instanceInfo{};
+        instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        instanceInfo.pApplicationInfo = &appInfo;
+        check(vkCreateInstance(&instanceInfo, nullptr, &context.instance), "create instance");
+
+        uint32_t deviceCount = 0;
+        vkEnumeratePhysicalDevices(context.instance, &deviceCount, nullptr);
+        std::vector<VkPhysicalDevice> devices(deviceCount);
+        vkEnumeratePhysicalDevices(context.instance, &deviceCount, devices.data());
+        if (devices.empty()) {
+            throw std::runtime_error("failed to find a vulkan device!");
+        }
+        context.physicalDevice = devices[0];
+        for (VkPhysicalDevice device : devices) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(device, &properties);
+            if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU) {
+                context.physicalDevice = device;
+            }
+        }
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(context.physicalDevice, &properties);
+        std::printf("device: %s\n", properties.deviceName);
+
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(context.physicalDevice, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(context.physicalDevice, &familyCount, families.data());
+        auto graphics = std::find_if(families.begin(), families.end(), [](const VkQueueFamilyProperties& family) {
+            return (family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        });
+        if (graphics == families.end()) {
+            throw std::runtime_error("failed to find a graphics queue family!");
+        }
+        context.queueFamily = static_cast<uint32_t>(graphics - families.begin());
+
+        float priority = 1.0f;
+        VkDeviceQueueCreateInfo queueInfo{};
+        queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueInfo.queueFamilyIndex = context.queueFamily;
+        queueInfo.queueCount = 1;
+        queueInfo.pQueuePriorities = &priority;
+        VkDeviceCreateInfo deviceInfo{};
+        deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        deviceInfo.queueCreateInfoCount = 1;
+        deviceInfo.pQueueCreateInfos = &queueInfo;
+        check(vkCreateDevice(context.physicalDevice, &deviceInfo, nullptr, &context.device), "create logical device");
+    }
+
+    // Single color attachment pass and a framebuffer for it, the shape the app's secondaries inherit
+    void createTarget(Context& context) {
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = VK_FORMAT_R8G8B8A8_UNORM;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        VkAttachmentReference colorReference{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorReference;
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = 1;
+        renderPassInfo.pAttachments = &colorAttachment;
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        check(vkCreateRenderPass(context.device, &renderPassInfo, nullptr, &context.renderPass), "create render pass");
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        imageInfo.extent = {EXTENT, EXTENT, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        check(vkCreateImage(context.device, &imageInfo, nullptr, &context.image), "create image");
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(context.device, context.image, &requirements);
+        uint32_t memoryType = 0;
+        while (!(requirements.memoryTypeBits & (1u << memoryType))) {
+            memoryType++;
+        }
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = memoryType;
+        check(vkAllocateMemory(context.device, &allocInfo, nullptr, &context.memory), "allocate image memory");
+        vkBindImageMemory(context.device, context.image, context.memory, 0);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = context.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+        check(vkCreateImageView(context.device, &viewInfo, nullptr, &context.view), "create image view");
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = context.renderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = &context.view;
+        framebufferInfo.width = EXTENT;
+        framebufferInfo.height = EXTENT;
+        framebufferInfo.layers = 1;
+        check(vkCreateFramebuffer(context.device, &framebufferInfo, nullptr, &context.framebuffer), "create framebuffer");
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = 64;
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushConstantRange;
+        check(vkCreatePipelineLayout(context.device, &layoutInfo, nullptr, &context.pipelineLayout), "create pipeline layout");
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = context.queueFamily;
+        check(vkCreateCommandPool(context.device, &poolInfo, nullptr, &context.commandPool), "create command pool");
+        VkCommandBufferAllocateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        bufferInfo.commandPool = context.commandPool;
+        bufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        bufferInfo.commandBufferCount = 1;
+        check(vkAllocateCommandBuffers(context.device, &bufferInfo, &context.primary), "allocate primary command buffer");
+    }
+
+    void destroy(Context& context) {
+        vkDestroyCommandPool(context.device, context.commandPool, nullptr);
+        vkDestroyPipelineLayout(context.device, context.pipelineLayout, nullptr);
+        vkDestroyFramebuffer(context.device, context.framebuffer, nullptr);
+        vkDestroyImageView(context.device, context.view, nullptr);
+        vkDestroyImage(context.device, context.image, nullptr);
+        vkFreeMemory(context.device, context.memory, nullptr);
+        vkDestroyRenderPass(context.device, context.renderPass, nullptr);
+        vkDestroyDevice(context.device, nullptr);
+        vkDestroyInstance(context.instance, nullptr);
+    }
+
+    // Per draw what the app records: a per object constant block and an indexed-sized draw
+    void recordDraws(const Context& context, VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount) {
+        float constants[16] = {};
+        for (uint32_t i = firstDraw; i < firstDraw + drawCount; i++) {
+            constants[0] = static_cast<float>(i);
+            vkCmdPushConstants(commandBuffer, context.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), constants);
+            vkCmdDraw(commandBuffer, 36, 1, 0, 0);
+        }
+    }
+
+    // Best of runs, milliseconds to record the whole primary buffer
+    template <typename Record>
+    double timeRecording(const Context& context, int runs, Record record) {
+        double bestSeconds = 1e30;
+        for (int run = 0; run < runs; run++) {
+            vkResetCommandPool(context.device, context.commandPool, 0);
+            auto startTime = std::chrono::high_resolution_clock::now();
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            check(vkBeginCommandBuffer(context.primary, &beginInfo), "begin primary command buffer");
+            record(static_cast<uint32_t>(run % ave::MAX_FRAMES_IN_FLIGHT));
+            check(vkEndCommandBuffer(context.primary), "record primary command buffer");
+
+            double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+            bestSeconds = std::min(bestSeconds, seconds);
+        }
+        return bestSeconds * 1000.0;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t drawCount = 20000;
+    int runs = 20;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--draws") drawCount = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (arg == "--runs") runs = std::atoi(argv[i + 1]);
+    }
+
+    Context context;
+    bool failed = false;
+    try {
+        createDevice(context);
+        createTarget(context);
+
+        VkClearValue clearValue{};
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = context.renderPass;
+        renderPassInfo.framebuffer = context.framebuffer;
+        renderPassInfo.renderArea.extent = {EXTENT, EXTENT};
+        renderPassInfo.clearValueCount = 1;
+        renderPassInfo.pClearValues = &clearValue;
+
+        double inlineMs = timeRecording(context, runs, [&](uint32_t) {
+            vkCmdBeginRenderPass(context.primary, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            recordDraws(context, context.primary, 0, drawCount);
+            vkCmdEndRenderPass(context.primary);
+        });
+        std::printf("%-10s %2u threads %8u draws  %8.2f ms  %7.2f Mdraws/s\n", "inline", 1u, drawCount, inlineMs, drawCount / inlineMs / 1e3);
+
+        unsigned cores = std::max(2u, std::thread::hardware_concurrency());
+        std::vector<unsigned> threadCounts;
+        for (unsigned threads = 2; threads < cores; threads *= 2) {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(cores);
+
+        for (unsigned threads : threadCounts) {
+            ave::AveThreadPool threadPool{threads - 1};
+            ave::AveParallelRecorder recorder{context.device, context.queueFamily, threadPool};
+            double parallelMs = timeRecording(context, runs, [&](uint32_t frame) {
+                recorder.beginFrame(frame);
+                recorder.recordRenderPass(context.primary, renderPassInfo, drawCount, [&](VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t count) {
+                    recordDraws(context, commandBuffer, firstDraw, count);
+                });
+            });
+            std::printf("%-10s %2u threads %8u draws  %8.2f ms  %7.2f Mdraws/s  %5.2fx  (%u secondaries)\n", "parallel", threads, drawCount,
+                parallelMs, drawCount / parallelMs / 1e3, inlineMs / parallelMs, recorder.getLastBufferCount());
+            // Enough draws for two ranges must be split, or the speedups above measured the inline fallback
+            if (drawCount >= 2 * ave::AveParallelRecorder::MIN_DRAWS_PER_BUFFER && recorder.getLastBufferCount() < 2) {
+                std::printf("FAILED: %u draws were recorded into %u secondary buffers\n", drawCount, recorder.getLastBufferCount());
+                failed = true;
+            }
+        }
+
+        // Texture decodes queued every frame: recording on the decoders' pool waits behind them in its FIFO, on a
+        // pool of its own it only shares the cores
+        auto decode = []() {
+            auto start = std::chrono::high_resolution_clock::now();
+            while (std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() < DECODE_MS) {
+            }
+        };
+        for (bool shared : {true, false}) {
+            ave::AveThreadPool decodePool{cores - 1};
+            ave::AveThreadPool recordingPool{cores - 1};
+            ave::AveParallelRecorder recorder{context.device, context.queueFamily, shared ? decodePool : recordingPool};
+            double busyMs = timeRecording(context, runs, [&](uint32_t frame) {
+                for (unsigned job = 0; job < (cores - 1) * DECODES_PER_THREAD; job++) {
+                    decodePool.submit(decode);
+                }
+                recorder.beginFrame(frame);
+                recorder.recordRenderPass(context.primary, renderPassInfo, drawCount, [&](VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t count) {
+                    recordDraws(context, commandBuffer, firstDraw, count);
+                });
+            });
+            decodePool.waitIdle();
+            std::printf("%-10s %2u threads %8u draws  %8.2f ms  %7.2f Mdraws/s  %5.2fx  (%s pool, decodes queued)\n", "busy", cores, drawCount,
+                busyMs, drawCount / busyMs / 1e3, inlineMs / busyMs, shared ? "shared" : "own");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    destroy(context);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
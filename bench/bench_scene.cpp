@@ -0,0 +1,149 @@
+// Transform hierarchy updates of AveScene: a random forest of entities is reparented and partly destroyed, then
+// every world matrix must equal its parent's world times its local. Times update() after 1% of the locals
+// changed and after all of them did.
+// Usage: bench_scene [--entities N] [--runs N]
+
+#include "../ave_scene.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    glm::mat4 randomLocal(std::mt19937& rng) {
+        std::uniform_real_distribution<float> offset{-2.0f, 2.0f};
+        std::uniform_real_distribution<float> angle{0.0f, 6.2831853f};
+        std::uniform_real_distribution<float> scale{0.5f, 1.5f};
+        glm::mat4 local = glm::translate(glm::mat4{1.0f}, glm::vec3{offset(rng), offset(rng), offset(rng)});
+        local = glm::rotate(local, angle(rng), glm::normalize(glm::vec3{offset(rng), offset(rng), 1.0f}));
+        return glm::scale(local, glm::vec3{scale(rng)});
+    }
+
+    bool inSubtree(const ave::AveScene& scene, ave::EntityId entity, ave::EntityId root) {
+        for (; entity != ave::ENTITY_NONE; entity = scene.getParent(entity)) {
+            if (entity == root) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Entities whose world matrix is not parent world * local, or that come before their parent in the arrays
+    uint32_t checkWorlds(const ave::AveScene& scene) {
+        uint32_t mismatches = 0;
+        for (size_t i = 0; i < scene.size(); i++) {
+            ave::EntityId entity = scene.getEntities()[i];
+            ave::EntityId parent = scene.getParent(entity);
+            glm::mat4 expected = parent == ave::ENTITY_NONE ? scene.getLocal(entity) : scene.getWorld(parent) * scene.getLocal(entity);
+            float error = 0.0f;
+            for (int column = 0; column < 4; column++) {
+                for (int row = 0; row < 4; row++) {
+                    float value = expected[column][row];
+                    error = std::max(error, std::abs(scene.getWorld(entity)[column][row] - value) / std::max(1.0f, std::abs(value)));
+                }
+            }
+            if (error > 1e-4f || (parent != ave::ENTITY_NONE && scene.getIndex(parent) > i)) {
+                mismatches++;
+            }
+        }
+        return mismatches;
+    }
+
+    // Roots, children of earlier entities, then reparenting and destruction in random order
+    void buildScene(ave::AveScene& scene, std::vector<ave::EntityId>& alive, uint32_t entityCount, std::mt19937& rng) {
+        for (uint32_t i = 0; i < entityCount; i++) {
+            ave::EntityId parent = alive.empty() || rng() % 8 == 0 ? ave::ENTITY_NONE : alive[rng() % alive.size()];
+            alive.push_back(scene.create(randomLocal(rng), parent));
+        }
+        scene.update();
+
+        for (uint32_t i = 0; i < entityCount / 20; i++) {
+            ave::EntityId entity = alive[rng() % alive.size()];
+            ave::EntityId parent = rng() % 4 == 0 ? ave::ENTITY_NONE : alive[rng() % alive.size()];
+            if (parent == ave::ENTITY_NONE || !inSubtree(scene, parent, entity)) {
+                scene.setParent(entity, parent);
+            }
+        }
+        for (uint32_t i = 0; i < entityCount / 50; i++) {
+            scene.destroy(alive[rng() % alive.size()]);
+            alive.erase(std::remove_if(alive.begin(), alive.end(), [&](ave::EntityId entity) { return !scene.isAlive(entity); }),
+                alive.end());
+        }
+        scene.update();
+    }
+
+    // Best of runs, milliseconds for update() after `changes` locals were set
+    double timeUpdate(ave::AveScene& scene, const std::vector<ave::EntityId>& alive, uint32_t changes, int runs, std::mt19937& rng) {
+        double bestSeconds = 1e30;
+        for (int run = 0; run < runs; run++) {
+            for (uint32_t i = 0; i < changes; i++) {
+                ave::EntityId entity = alive[rng() % alive.size()];
+                scene.setLocal(entity, scene.getLocal(entity));
+            }
+            auto startTime = std::chrono::high_resolution_clock::now();
+            scene.update();
+            double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+            bestSeconds = std::min(bestSeconds, seconds);
+        }
+        return bestSeconds * 1000.0;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t entityCount = 100000;
+    int runs = 20;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--entities") entityCount = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (arg == "--runs") runs = std::atoi(argv[i + 1]);
+    }
+
+    bool failed = false;
+
+    // A root created after a child leaves the scene unsorted, destroying everything must still update
+    {
+        ave::AveScene scene;
+        ave::EntityId a = scene.create();
+        scene.create(glm::mat4{1.0f}, a);
+        ave::EntityId c = scene.create();
+        scene.destroy(a);
+        scene.destroy(c);
+        scene.update();
+        if (scene.size() != 0 || !scene.getChanged().empty()) {
+            std::printf("empty scene: %zu entities, %zu changed\n", scene.size(), scene.getChanged().size());
+            failed = true;
+        }
+    }
+
+    std::mt19937 rng{1234};
+    ave::AveScene scene;
+    std::vector<ave::EntityId> alive;
+    buildScene(scene, alive, entityCount, rng);
+    uint32_t mismatches = checkWorlds(scene);
+    failed = failed || mismatches > 0;
+    std::printf("%8zu entities after reparenting and destroying, %u wrong world matrices\n", scene.size(), mismatches);
+
+    for (uint32_t changes : {static_cast<uint32_t>(alive.size() / 100), static_cast<uint32_t>(alive.size())}) {
+        double ms = timeUpdate(scene, alive, changes, runs, rng);
+        std::printf("update  %8u locals changed  %8zu recomputed  %8.3f ms\n", changes, scene.getChanged().size(), ms);
+    }
+    mismatches = checkWorlds(scene);
+    if (mismatches > 0) {
+        std::printf("%u wrong world matrices after the timed updates\n", mismatches);
+        failed = true;
+    }
+
+    if (failed) {
+        std::printf("FAILED: scene hierarchy is inconsistent\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
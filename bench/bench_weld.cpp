@@ -0,0 +1,131 @@
+// Vertex welding throughput: std::unordered_map<Vertex, u_int32_t, Vertex_hash> against AveVertexWelder,
+// on the viking room and a synthetic grid, both expanded to triangle soups first. Vertices that differ only
+// in the sign of zero components must weld, with and without a position epsilon.
+// Usage: bench_weld [--grid N] [--runs N]
+
+#include "../ave_obj_loader.hpp"
+#include "../ave_vertex_welder.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+namespace {
+    std::vector<ave::Vertex> expandToSoup(const std::vector<ave::Vertex>& vertices, const std::vector<u_int32_t>& indices) {
+        std::vector<ave::Vertex> soup;
+        soup.reserve(indices.size());
+        for (u_int32_t index : indices) {
+            soup.push_back(vertices[index]);
+        }
+        return soup;
+    }
+
+    // side x side displaced grid, each quad emitted as two triangles of fresh vertices
+    std::vector<ave::Vertex> makeGridSoup(size_t side) {
+        auto gridVertex = [&](size_t x, size_t y) {
+            float u = static_cast<float>(x) / (side - 1);
+            float v = static_cast<float>(y) / (side - 1);
+            ave::Vertex vertex{};
+            vertex.pos = {u - 0.5f, v - 0.5f, 0.05f * std::sin(u * 40.0f) * std::cos(v * 40.0f)};
+            vertex.normal = {0.0f, 0.0f, 1.0f};
+            vertex.color = {1.0f, 1.0f, 1.0f};
+            vertex.texCoord = {u, v};
+            return vertex;
+        };
+
+        std::vector<ave::Vertex> soup;
+        soup.reserve((side - 1) * (side - 1) * 6);
+        for (size_t y = 0; y + 1 < side; y++) {
+            for (size_t x = 0; x + 1 < side; x++) {
+                soup.insert(soup.end(), {gridVertex(x, y), gridVertex(x + 1, y), gridVertex(x + 1, y + 1)});
+                soup.insert(soup.end(), {gridVertex(x, y), gridVertex(x + 1, y + 1), gridVertex(x, y + 1)});
+            }
+        }
+        return soup;
+    }
+
+    size_t weldWithUnorderedMap(const std::vector<ave::Vertex>& soup, std::vector<u_int32_t>& indices) {
+        std::unordered_map<ave::Vertex, u_int32_t, ave::Vertex_hash> unique;
+        unique.reserve(soup.size() / 2);
+        indices.resize(soup.size());
+        for (size_t i = 0; i < soup.size(); i++) {
+            indices[i] = unique.emplace(soup[i], static_cast<u_int32_t>(unique.size())).first->second;
+        }
+        return unique.size();
+    }
+
+    // The same vertex with every zero component as +0 and as -0, which operator== treats as equal
+    bool weldsSignedZeros() {
+        ave::Vertex positive{};
+        positive.normal = {0.0f, 0.0f, 1.0f};
+        positive.color = {1.0f, 1.0f, 1.0f};
+        ave::Vertex negative = positive;
+        negative.pos = {-0.0f, -0.0f, -0.0f};
+        negative.normal = {-0.0f, -0.0f, 1.0f};
+        negative.texCoord = {-0.0f, -0.0f};
+
+        std::vector<ave::Vertex> vertices{positive, negative};
+        std::vector<u_int32_t> remap;
+        return ave::AveVertexWelder::generateRemap(vertices.data(), vertices.size(), remap) == 1
+            && ave::AveVertexWelder::generateRemap(vertices.data(), vertices.size(), remap, 1e-5f) == 1;
+    }
+
+    template <typename Weld>
+    void runBenchmark(const std::string& name, const std::string& method, const std::vector<ave::Vertex>& soup, int runs, Weld weld) {
+        double bestSeconds = 1e30;
+        size_t uniqueCount = 0;
+        for (int run = 0; run < runs; run++) {
+            std::vector<u_int32_t> indices;
+            auto startTime = std::chrono::high_resolution_clock::now();
+            uniqueCount = weld(soup, indices);
+            double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+            bestSeconds = std::min(bestSeconds, seconds);
+        }
+
+        std::printf("%-12s %-16s %9zu -> %9zu verts  %8.2f ms  %7.2f Mverts/s\n",
+            name.c_str(), method.c_str(), soup.size(), uniqueCount, bestSeconds * 1000.0, soup.size() / bestSeconds / 1e6);
+    }
+
+    void runAll(const std::string& name, const std::vector<ave::Vertex>& soup, int runs) {
+        runBenchmark(name, "unordered_map", soup, runs, weldWithUnorderedMap);
+        runBenchmark(name, "welder", soup, runs, [](const std::vector<ave::Vertex>& vertices, std::vector<u_int32_t>& remap) {
+            return ave::AveVertexWelder::generateRemap(vertices.data(), vertices.size(), remap);
+        });
+        runBenchmark(name, "welder eps=1e-5", soup, runs, [](const std::vector<ave::Vertex>& vertices, std::vector<u_int32_t>& remap) {
+            return ave::AveVertexWelder::generateRemap(vertices.data(), vertices.size(), remap, 1e-5f);
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t gridSide = 1024;
+    int runs = 3;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--grid") gridSide = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (arg == "--runs") runs = std::atoi(argv[i + 1]);
+    }
+
+    if (!weldsSignedZeros()) {
+        std::printf("FAILED: vertices differing only in signed zeros were not welded\n");
+        return EXIT_FAILURE;
+    }
+
+    try {
+        std::vector<ave::Vertex> vertices;
+        std::vector<u_int32_t> indices;
+        ave::AveObjLoader::load(ave::MODEL_PATH, vertices, indices);
+        runAll("viking_room", expandToSoup(vertices, indices), runs);
+        runAll("grid", makeGridSoup(std::max<size_t>(gridSide, 2)), runs);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,18 +1,29 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 // Find long lost songs... Japanese and taiwanese 1
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 fragPos;
 layout(location = 3) in vec3 normal;
+layout(location = 4) in vec4 fragInstanceColor;
+layout(location = 5) flat in uint fragMaterial;
 
 
 layout(location = 0) out vec4 outColor;
 
 
-layout(binding = 1) uniform sampler2D texSampler;
+// Bindless texture table, indexed by the draw's material
+layout(set = 1, binding = 0) uniform sampler textureSampler;
+layout(set = 1, binding = 1) uniform texture2D textures[];
+
+layout(push_constant) uniform Material {
+    uint textureSlot;
+} material;
 
 void main() {
-    // outColor = texture(texSampler, fragTexCoord);
+    // Instances may pick their own texture, which can differ between neighbouring invocations
+    uint textureSlot = fragMaterial == 0xFFFFFFFFu ? material.textureSlot : fragMaterial;
+    vec3 albedo = texture(sampler2D(textures[nonuniformEXT(textureSlot)], textureSampler), fragTexCoord).rgb * fragInstanceColor.rgb;
 
     vec3 lightColor = vec3(1.0, 1.0, 1.0);
     vec3 lightPos = vec3(1.0, 1.0, 1.0);
@@ -27,7 +38,7 @@ void main() {
     float diff = max(dot(norm, lightDir), 0.0);
     vec3 diffuse = diff * lightColor;
 
-    vec3 result = (diffuse*0.7) * vec3(1.0, 0.0, 0.0);
+    vec3 result = (diffuse*0.7) * albedo;
 
     outColor = vec4(result, 1.0);
 }
\ No newline at end of file
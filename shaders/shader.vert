@@ -11,20 +11,30 @@ layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec3 inColor;
 layout(location = 3) in vec2 inTexCoord;
 
+// Per instance stream (InstanceData), a single default instance for models that are not instanced
+layout(location = 4) in mat4 instanceTransform; // locations 4-7
+layout(location = 8) in vec4 instanceColor;
+layout(location = 9) in uint instanceMaterial;
+
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 fragPos;
 layout(location = 3) out vec3 normal;
+layout(location = 4) out vec4 fragInstanceColor;
+layout(location = 5) flat out uint fragMaterial;
 
 
 void main() {
-    fragPos = vec3(ubo.model * vec4(inPosition, 1.0));
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    mat4 model = instanceTransform * ubo.model;
+    fragPos = vec3(model * vec4(inPosition, 1.0));
+    gl_Position = ubo.proj * ubo.view * vec4(fragPos, 1.0);
 
     bvec3 bozo = bvec3(inNormal.x != 0.0, inNormal.y != 0.0, inNormal.z != 0.0);
 
     fragColor = clamp((inNormal + vec3(bozo)*3.0)/4.0, vec3(0.0), vec3(1.0));
     fragTexCoord = inTexCoord;
-    normal =  vec3(ubo.model * vec4(inNormal, 0.0));
+    normal =  vec3(model * vec4(inNormal, 0.0));
+    fragInstanceColor = instanceColor;
+    fragMaterial = instanceMaterial;
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#version 450
+
+// PackedVertex variant of shader.vert. Positions arrive in the mesh's quantization box,
+// ubo.model already contains the dequant matrix.
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout(location = 0) in vec4 inPosition;   // R16G16B16A16_SFLOAT
+layout(location = 1) in vec2 inNormalOct;  // R16G16_SNORM
+layout(location = 2) in vec4 inColor;      // R8G8B8A8_UNORM
+layout(location = 3) in vec2 inTexCoord;   // R16G16_UNORM
+
+// Per instance stream (InstanceData), a single default instance for models that are not instanced
+layout(location = 4) in mat4 instanceTransform; // locations 4-7
+layout(location = 8) in vec4 instanceColor;
+layout(location = 9) in uint instanceMaterial;
+
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragPos;
+layout(location = 3) out vec3 normal;
+layout(location = 4) out vec4 fragInstanceColor;
+layout(location = 5) flat out uint fragMaterial;
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    vec3 inNormal = decodeOctahedral(inNormalOct);
+
+    mat4 model = instanceTransform * ubo.model;
+    fragPos = vec3(model * vec4(inPosition.xyz, 1.0));
+    gl_Position = ubo.proj * ubo.view * vec4(fragPos, 1.0);
+
+    bvec3 bozo = bvec3(inNormal.x != 0.0, inNormal.y != 0.0, inNormal.z != 0.0);
+
+    fragColor = clamp((inNormal + vec3(bozo)*3.0)/4.0, vec3(0.0), vec3(1.0));
+    fragTexCoord = inTexCoord;
+    normal =  vec3(model * vec4(inNormal, 0.0));
+    fragInstanceColor = instanceColor;
+    fragMaterial = instanceMaterial;
+}
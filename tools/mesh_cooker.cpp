@@ -0,0 +1,63 @@
+// Offline mesh cooker: source mesh -> optimized .avemesh (see ave_mesh_file.hpp for the layout).
+// Usage: mesh_cooker [--full] <input.obj> <output.avemesh>
+// Meshes are stored as PackedVertex when they allow it, --full keeps the fp32 Vertex layout.
+
+#include "../ave_obj_loader.hpp"
+#include "../ave_mesh_file.hpp"
+#include "../ave_mesh_optimizer.hpp"
+#include "../ave_mesh_simplifier.hpp"
+#include "../ave_vertex_welder.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char** argv) {
+    bool forceFull = argc == 4 && std::strcmp(argv[1], "--full") == 0;
+    if (argc != 3 && !forceFull) {
+        std::cerr << "usage: " << argv[0] << " [--full] <input.obj> <output.avemesh>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const char* inputPath = argv[argc - 2];
+    const char* outputPath = argv[argc - 1];
+
+    try {
+        std::vector<ave::Vertex> vertices;
+        std::vector<u_int32_t> indices;
+        ave::ObjLoadStats stats{};
+        ave::AveObjLoader::load(inputPath, vertices, indices, &stats);
+        ave::AveVertexWelder::weld(vertices, indices);
+
+        ave::MeshOptimizationReport report = ave::AveMeshOptimizer::optimizeMesh(vertices, indices);
+        std::cout << "ACMR " << report.before.acmr << " -> " << report.after.acmr
+                  << ", ATVR " << report.before.atvr << " -> " << report.after.atvr
+                  << ", vertices " << report.verticesBefore << " -> " << report.verticesAfter << std::endl;
+
+        std::vector<ave::AveMeshSubmesh> submeshes(1);
+        submeshes[0].firstIndex = 0;
+        submeshes[0].indexCount = static_cast<uint32_t>(indices.size());
+
+        std::vector<ave::Meshlet> meshlets;
+        std::vector<ave::MeshLod> lods = ave::AveMeshSimplifier::buildLodChain(vertices, indices, &meshlets);
+        for (size_t i = 0; i < lods.size(); i++) {
+            // Meshlets fill up to MESHLET_MAX_TRIANGLES unless the mesh runs out of connected triangles,
+            // a low average means AveMeshlets::cull and the draw ranges have far more work than needed
+            float trianglesPerMeshlet = lods[i].meshletCount > 0 ? lods[i].indexCount / 3.0f / lods[i].meshletCount : 0.0f;
+            std::cout << "LOD" << i << ": " << lods[i].indexCount / 3 << " triangles, " << lods[i].meshletCount
+                      << " meshlets (" << trianglesPerMeshlet << " triangles each), error " << lods[i].error << std::endl;
+        }
+
+        bool packed = !forceFull && ave::canPackVertices(vertices.data(), vertices.size());
+        ave::VertexFormat format = packed ? ave::VertexFormat::Packed : ave::VertexFormat::Full;
+        ave::AveMeshFile::write(outputPath, vertices, indices, submeshes, lods, meshlets, format);
+
+        std::cout << inputPath << " -> " << outputPath << ": " << vertices.size() << " vertices, "
+                  << lods[0].indexCount / 3 << " triangles, " << (packed ? "packed" : "full") << " vertices ("
+                  << ave::getVertexLayout(format).stride() << " bytes each)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+// Offline texture cooker: source image -> mip mapped, block compressed .avetex (see ave_texture_file.hpp for the layout).
+// Usage: texture_cooker [--format rgba8|bc1|bc3|bc7] <input.png> <output.avetex>
+// Defaults to bc7. bc1 drops alpha, pick bc3 or bc7 for textures that need it.
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include "../ave_texture_encoder.hpp"
+#include "../ave_texture_file.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+    bool parseEncoding(const std::string& name, ave::TextureEncoding& encoding) {
+        if (name == "rgba8") encoding = ave::TextureEncoding::RGBA8;
+        else if (name == "bc1") encoding = ave::TextureEncoding::BC1;
+        else if (name == "bc3") encoding = ave::TextureEncoding::BC3;
+        else if (name == "bc7") encoding = ave::TextureEncoding::BC7;
+        else return false;
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    ave::TextureEncoding encoding = ave::TextureEncoding::BC7;
+    bool valid = argc == 3 || (argc == 5 && std::strcmp(argv[1], "--format") == 0 && parseEncoding(argv[2], encoding));
+    if (!valid) {
+        std::cerr << "usage: " << argv[0] << " [--format rgba8|bc1|bc3|bc7] <input.png> <output.avetex>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const char* inputPath = argv[argc - 2];
+    const char* outputPath = argv[argc - 1];
+
+    try {
+        int texWidth, texHeight, texChannels;
+        stbi_uc* pixels = stbi_load(inputPath, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error(std::string("failed to load texture image: ") + inputPath);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<ave::TextureLevelData> mips = ave::AveTextureEncoder::generateMips(pixels, texWidth, texHeight);
+        stbi_image_free(pixels);
+
+        std::vector<std::vector<unsigned char>> levels;
+        size_t sourceBytes = 0, cookedBytes = 0;
+        for (const ave::TextureLevelData& mip : mips) {
+            levels.push_back(ave::AveTextureEncoder::encode(encoding, mip));
+            sourceBytes += mip.rgba.size();
+            cookedBytes += levels.back().size();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        ave::AveTextureFile::write(outputPath, ave::AveTextureEncoder::vkFormat(encoding), texWidth, texHeight, levels);
+
+        std::cout << inputPath << " -> " << outputPath << ": " << texWidth << "x" << texHeight << ", "
+                  << levels.size() << " levels, " << sourceBytes / 1024 << " KiB -> " << cookedBytes / 1024
+                  << " KiB in " << seconds * 1000.0 << " ms" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}